@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# Compare cold and warm launches of the games on the disk image. Before
+# every launch the image is remounted and the page cache dropped. A cold
+# launch then starts the game straight away. A warm launch first reads it
+# ahead with vgc_prefetch, the way main_screen does for the highlighted
+# title. Run as root once startup.sh has mounted the image. vgc_prefetch
+# is built with:
+#
+#   gcc -O2 -pthread src/vgc_prefetch.c -o vgc_prefetch
+
+# Set paths
+DISK_IMAGE="storage_vgc.img"
+MOUNT_POINT="./mount"
+PREFETCH="./vgc_prefetch"
+LOOP_DEVICE=$(losetup -j $DISK_IMAGE | awk -F: '{print $1}')
+RUNS=${1:-5} # Launches of each kind per game
+
+if [ -z "$LOOP_DEVICE" ] || ! mountpoint -q $MOUNT_POINT; then
+    echo "Disk image is not mounted; run startup.sh first."
+    exit 1
+fi
+if [ ! -x "$PREFETCH" ]; then
+    echo "$PREFETCH not found; build it first."
+    exit 1
+fi
+
+# Remount the image with nothing of it in the page cache
+fresh_mount() {
+    umount $MOUNT_POINT || exit 1
+    sync
+    echo 3 > /proc/sys/vm/drop_caches
+    mount $LOOP_DEVICE $MOUNT_POINT || exit 1
+}
+
+# Milliseconds one headless launch of $1 took
+launch_ms() {
+    $PREFETCH -t "$1" | awk '{ print $(NF - 1) }'
+}
+
+printf "%-24s %12s %12s %14s\n" "Game" "Cold (ms)" "Warm (ms)" "Prefetch (ms)"
+for GAME in $MOUNT_POINT/game_*; do
+    # Executables only, not plugins or sources
+    case "$(basename $GAME)" in
+        *.*) continue ;;
+    esac
+    [ -x "$GAME" ] || continue
+
+    COLD=""
+    WARM=""
+    PREFETCHED=""
+    for RUN in $(seq $RUNS); do
+        fresh_mount
+        COLD="$COLD $(launch_ms $GAME)"
+
+        fresh_mount
+        PREFETCHED="$PREFETCHED $($PREFETCH $GAME $GAME.so | awk '{ print $(NF - 1) }')"
+        WARM="$WARM $(launch_ms $GAME)"
+    done
+
+    echo "$(basename $GAME) $COLD | $WARM | $PREFETCHED" | awk -v runs=$RUNS '{
+        n = 0
+        for (i = 2; i <= NF; i++) {
+            if ($i == "|") { n++; continue }
+            sum[n] += $i
+        }
+        printf "%-24s %12.3f %12.3f %14.3f\n", $1, sum[0] / runs, sum[1] / runs, sum[2] / runs
+    }'
+done
@@ -0,0 +1,493 @@
+#ifndef ARENA_ENGINE_H
+#define ARENA_ENGINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vgc_random.h"
+#include "work_pool.h"
+
+// Snake arena: many snakes, players and bots, on one shared board.
+//
+// A single occupancy grid holds, for every cell, the snake covering it,
+// food or nothing. A tick runs in three phases; the first two are split
+// into chunks of snakes that run on the cores of a work pool (work_pool.h):
+//
+// 1. plan: every snake picks a direction (bots steer themselves, players
+//    keep the one they were given) and, when the cell ahead is free or
+//    food, claims it by raising the cell's claim to its own key. Only
+//    reads the grid.
+// 2. move: a snake whose key is still the cell's claim moves there and
+//    eats what it finds. One that ran into a wall or a body, or lost a
+//    head-on race for a cell, dies, and its body turns into food. Each cell
+//    is written by exactly one snake.
+// 3. settle, on one thread: dead bots respawn and food is topped up with
+//    the arena's own random generator.
+//
+// Keys are unique per snake and tick, and their order is reshuffled every
+// tick so no snake always wins. Which snake takes a contested cell depends
+// only on the keys, never on which thread got there first, so a seeded
+// arena plays out bit for bit the same on any number of threads.
+//
+// All per-cell and per-snake arrays are allocated once, in arenaInit().
+
+#define ARENA_FREE -1
+#define ARENA_FOOD -2
+#define ARENA_MAX_SNAKES 65536  // Snake indices fit the low 16 bits of a key
+#define ARENA_SIGHT 6           // How far ahead bots look for food
+#define ARENA_SPAWN_TRIES 32    // Random cells tried per spawn
+#define ARENA_CHUNK_MIN 64      // Fewer snakes per task cost more than they save
+#define ARENA_CHUNKS_PER_THREAD 4
+
+typedef struct {
+    int32_t head;         // Ring position of the head in the snake's body
+    int32_t length;
+    int32_t alive;
+    int32_t bot;          // Steers itself
+    int32_t direction;    // 'w', 'a', 's' or 'd'
+    int32_t target;       // Cell claimed this tick, -1 when blocked
+    int32_t eaten;        // Food eaten since it spawned
+    int32_t reserved;
+    VgcRandom rng;        // The bot's own choices
+} ArenaSnake;
+
+typedef struct Arena Arena;
+
+// A run of snakes handled by one task, with what it changed
+typedef struct {
+    Arena* arena;
+    int first, last;      // Snakes first .. last - 1
+    int food;             // Food made minus food eaten
+    int deaths;
+} ArenaChunk;
+
+struct Arena {
+    int rows, cols, cells;
+    int count;            // Snakes, alive or not
+    int max_length;       // Longer snakes eat without growing
+    int32_t* grid;        // Per cell: snake index, ARENA_FREE or ARENA_FOOD
+    int32_t* bodies;      // Ring of cells per snake, max_length each
+    ArenaSnake* snakes;
+    uint64_t* claims;     // Per cell: highest key that claimed it
+    int food;
+    int food_target;
+    uint64_t tick;
+    unsigned long deaths;
+    VgcRandom rng;        // Spawns and food; seed before arenaPopulate()
+    WorkPool* pool;       // NULL runs every phase on the calling thread
+    ArenaChunk* chunks;
+    int chunk_count;
+};
+
+static inline int32_t* arenaBody(const Arena* arena, int id) {
+    return arena->bodies + (size_t)id * arena->max_length;
+}
+
+static inline int arenaHeadCell(const Arena* arena, int id) {
+    return arenaBody(arena, id)[arena->snakes[id].head];
+}
+
+// Cell next to 'cell' in 'direction', or -1 past the border
+static inline int arenaStep(const Arena* arena, int cell, int direction) {
+    int row = cell / arena->cols, col = cell % arena->cols;
+    switch (direction) {
+        case 'w': return row > 0 ? cell - arena->cols : -1;
+        case 's': return row + 1 < arena->rows ? cell + arena->cols : -1;
+        case 'a': return col > 0 ? cell - 1 : -1;
+        case 'd': return col + 1 < arena->cols ? cell + 1 : -1;
+    }
+    return -1;
+}
+
+static inline int arenaReverse(int direction) {
+    switch (direction) {
+        case 'w': return 's';
+        case 's': return 'w';
+        case 'a': return 'd';
+        case 'd': return 'a';
+    }
+    return 0;
+}
+
+// Claim key of snake 'id' in 'tick': the tick on top, so older claims
+// always lose, then a per-tick shuffle, then the index to break ties
+static inline uint64_t arenaKey(uint64_t tick, int id) {
+    uint64_t mix = tick * 0x9e3779b97f4a7c15ull ^ (uint64_t)id * 0xbf58476d1ce4e5b9ull;
+    mix ^= mix >> 29;
+    mix *= 0x94d049bb133111ebull;
+    return tick << 32 | (mix >> 48) << 16 | (uint64_t)id;
+}
+
+// Raise the cell's claim to 'key' unless a higher one is there already
+static inline void arenaClaim(uint64_t* claim, uint64_t key) {
+    uint64_t seen = __atomic_load_n(claim, __ATOMIC_RELAXED);
+    while (seen < key
+           && !__atomic_compare_exchange_n(claim, &seen, key, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline void arenaFree(Arena* arena) {
+    free(arena->grid);
+    free(arena->claims);
+    free(arena->bodies);
+    free(arena->snakes);
+    free(arena->chunks);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// Set up an empty 'rows' x 'cols' arena for 'count' snakes; the first
+// 'players' of them are steered with arenaSteer(), the rest are bots.
+// Returns -1 if it cannot be allocated.
+static inline int arenaInit(Arena* arena, int rows, int cols, int count, int players, int maxLength) {
+    memset(arena, 0, sizeof(*arena));
+    arena->rows = rows;
+    arena->cols = cols;
+    arena->cells = rows * cols;
+    arena->count = count;
+    arena->max_length = maxLength;
+    arena->grid = malloc((size_t)arena->cells * sizeof(int32_t));
+    arena->claims = calloc((size_t)arena->cells, sizeof(uint64_t));
+    arena->bodies = calloc((size_t)count * maxLength, sizeof(int32_t)); // Equal arenas save equal bytes
+    arena->snakes = calloc((size_t)count, sizeof(ArenaSnake));
+    if (arena->grid == NULL || arena->claims == NULL || arena->bodies == NULL || arena->snakes == NULL) {
+        arenaFree(arena);
+        return -1;
+    }
+    for (int i = 0; i < arena->cells; i++) {
+        arena->grid[i] = ARENA_FREE;
+    }
+    for (int i = 0; i < count; i++) {
+        arena->snakes[i].bot = i >= players;
+        arena->snakes[i].target = -1;
+    }
+    return 0;
+}
+
+// Run the two parallel phases as tasks on 'pool' (NULL: on the caller)
+static inline void arenaUsePool(Arena* arena, WorkPool* pool) {
+    free(arena->chunks);
+    arena->chunks = NULL;
+    arena->chunk_count = 0;
+    arena->pool = pool;
+    if (pool == NULL) return;
+
+    int chunks = pool->threads * ARENA_CHUNKS_PER_THREAD;
+    int most = (arena->count + ARENA_CHUNK_MIN - 1) / ARENA_CHUNK_MIN;
+    if (chunks > most) chunks = most;
+    if (chunks < 1) chunks = 1;
+    arena->chunks = calloc((size_t)chunks, sizeof(ArenaChunk));
+    if (arena->chunks == NULL) {
+        perror("Unable to allocate the arena tasks");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < chunks; i++) {
+        arena->chunks[i].arena = arena;
+        arena->chunks[i].first = (int)((long)arena->count * i / chunks);
+        arena->chunks[i].last = (int)((long)arena->count * (i + 1) / chunks);
+    }
+    arena->chunk_count = chunks;
+}
+
+// Bring snake 'id' to life, one cell long, on a random free cell; returns 0
+// if no free cell turned up
+static inline int arenaSpawn(Arena* arena, int id) {
+    for (int attempt = 0; attempt < ARENA_SPAWN_TRIES; attempt++) {
+        int cell = vgcRandomRange(&arena->rng, arena->cells);
+        if (arena->grid[cell] != ARENA_FREE) continue;
+
+        ArenaSnake* snake = &arena->snakes[id];
+        snake->head = 0;
+        snake->length = 1;
+        snake->alive = 1;
+        snake->direction = "wasd"[vgcRandomRange(&arena->rng, 4)];
+        snake->target = -1;
+        snake->eaten = 0;
+        vgcRandomSeed(&snake->rng, vgcRandomNext(&arena->rng));
+        arenaBody(arena, id)[0] = cell;
+        arena->grid[cell] = id;
+        return 1;
+    }
+    return 0;
+}
+
+// Top the food up towards the target, a bounded number of tries per call
+static inline void arenaPlaceFood(Arena* arena) {
+    int tries = 2 * (arena->food_target - arena->food);
+    for (; tries > 0 && arena->food < arena->food_target; tries--) {
+        int cell = vgcRandomRange(&arena->rng, arena->cells);
+        if (arena->grid[cell] == ARENA_FREE) {
+            arena->grid[cell] = ARENA_FOOD;
+            arena->food++;
+        }
+    }
+}
+
+// Spawn every snake and 'food' pieces of food
+static inline void arenaPopulate(Arena* arena, int food) {
+    arena->food_target = food;
+    for (int id = 0; id < arena->count; id++) {
+        arenaSpawn(arena, id);
+    }
+    arenaPlaceFood(arena);
+}
+
+// Point player 'id' in 'direction'; turning back into its own neck is ignored
+static inline void arenaSteer(Arena* arena, int id, char direction) {
+    ArenaSnake* snake = &arena->snakes[id];
+    if (snake->length > 1 && direction == arenaReverse(snake->direction)) return;
+    snake->direction = direction;
+}
+
+// A bot's next direction: food straight ahead or within sight along a
+// line, room to move on, and keeping its course score; random bits break
+// ties. Never turns back; stays on course if every way is blocked.
+static inline int arenaBotDirection(Arena* arena, ArenaSnake* snake, int head) {
+    static const char directions[4] = { 'w', 'a', 's', 'd' };
+    uint64_t noise = vgcRandomNext(&snake->rng);
+    int best = snake->direction, bestScore = -1;
+
+    for (int i = 0; i < 4; i++) {
+        int direction = directions[i];
+        if (snake->length > 1 && direction == arenaReverse(snake->direction)) continue;
+        int cell = arenaStep(arena, head, direction);
+        if (cell < 0 || arena->grid[cell] >= 0) continue;
+
+        int score = arena->grid[cell] == ARENA_FOOD ? 4 * ARENA_SIGHT : 0;
+        int ahead = cell;
+        for (int distance = 1; distance <= ARENA_SIGHT; distance++) {
+            ahead = arenaStep(arena, ahead, direction);
+            if (ahead < 0 || arena->grid[ahead] >= 0) break;
+            if (arena->grid[ahead] == ARENA_FOOD) {
+                score += ARENA_SIGHT + 1 - distance;
+                break;
+            }
+        }
+        for (int j = 0; j < 4; j++) {
+            int next = arenaStep(arena, cell, directions[j]);
+            if (next >= 0 && arena->grid[next] < 0) score += 2;
+        }
+        if (direction == snake->direction) score++;
+        score = score * 4 + (int)((noise >> (2 * i)) & 3);
+        if (score > bestScore) {
+            bestScore = score;
+            best = direction;
+        }
+    }
+    return best;
+}
+
+// Phase 1 for snakes first .. last - 1
+static inline void arenaPlan(Arena* arena, int first, int last) {
+    for (int id = first; id < last; id++) {
+        ArenaSnake* snake = &arena->snakes[id];
+        if (!snake->alive) continue;
+
+        int head = arenaHeadCell(arena, id);
+        if (snake->bot) snake->direction = arenaBotDirection(arena, snake, head);
+        int cell = arenaStep(arena, head, snake->direction);
+        snake->target = cell >= 0 && arena->grid[cell] < 0 ? cell : -1;
+        if (snake->target >= 0) arenaClaim(&arena->claims[cell], arenaKey(arena->tick, id));
+    }
+}
+
+// Phase 2 for the chunk's snakes
+static inline void arenaMove(ArenaChunk* chunk) {
+    Arena* arena = chunk->arena;
+
+    chunk->food = 0;
+    chunk->deaths = 0;
+    for (int id = chunk->first; id < chunk->last; id++) {
+        ArenaSnake* snake = &arena->snakes[id];
+        if (!snake->alive) continue;
+
+        int32_t* body = arenaBody(arena, id);
+        int cell = snake->target;
+        if (cell < 0 || __atomic_load_n(&arena->claims[cell], __ATOMIC_RELAXED) != arenaKey(arena->tick, id)) {
+            // Crashed or beaten to the cell: the body becomes food
+            for (int i = 0; i < snake->length; i++) {
+                arena->grid[body[(snake->head - i + arena->max_length) % arena->max_length]] = ARENA_FOOD;
+            }
+            chunk->food += snake->length;
+            chunk->deaths++;
+            snake->alive = 0;
+            continue;
+        }
+
+        int ate = arena->grid[cell] == ARENA_FOOD;
+        if (ate) {
+            chunk->food--;
+            snake->eaten++;
+        }
+        if (!ate || snake->length == arena->max_length) {
+            int tail = (snake->head - snake->length + 1 + arena->max_length) % arena->max_length;
+            arena->grid[body[tail]] = ARENA_FREE;
+        } else {
+            snake->length++;
+        }
+        snake->head = (snake->head + 1) % arena->max_length;
+        body[snake->head] = cell;
+        arena->grid[cell] = id;
+    }
+}
+
+static inline void arenaPlanTask(void* arg) {
+    ArenaChunk* chunk = arg;
+    arenaPlan(chunk->arena, chunk->first, chunk->last);
+}
+
+static inline void arenaMoveTask(void* arg) {
+    arenaMove(arg);
+}
+
+// Advance every snake one cell
+static inline void arenaTick(Arena* arena) {
+    ArenaChunk whole = { arena, 0, arena->count, 0, 0 };
+    ArenaChunk* chunks = &whole;
+    int chunkCount = 1;
+
+    arena->tick++;
+    if (arena->pool != NULL) {
+        chunks = arena->chunks;
+        chunkCount = arena->chunk_count;
+        for (int i = 0; i < chunkCount; i++) workPoolSubmit(arena->pool, arenaPlanTask, &chunks[i]);
+        workPoolWait(arena->pool);
+        for (int i = 0; i < chunkCount; i++) workPoolSubmit(arena->pool, arenaMoveTask, &chunks[i]);
+        workPoolWait(arena->pool);
+    } else {
+        arenaPlan(arena, 0, arena->count);
+        arenaMove(&whole);
+    }
+
+    // Settle in chunk order, the same with any number of threads
+    for (int i = 0; i < chunkCount; i++) {
+        arena->food += chunks[i].food;
+        arena->deaths += (unsigned long)chunks[i].deaths;
+    }
+    for (int id = 0; id < arena->count; id++) {
+        if (!arena->snakes[id].alive && arena->snakes[id].bot) arenaSpawn(arena, id);
+    }
+    arenaPlaceFood(arena);
+}
+
+// Digest of the whole arena, to compare runs
+static inline uint64_t arenaChecksum(const Arena* arena) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < arena->cells; i++) {
+        hash = (hash ^ (uint32_t)arena->grid[i]) * 0x100000001b3ull;
+    }
+    for (int id = 0; id < arena->count; id++) {
+        const ArenaSnake* snake = &arena->snakes[id];
+        hash = (hash ^ (uint64_t)arenaHeadCell(arena, id)) * 0x100000001b3ull;
+        hash = (hash ^ (uint64_t)snake->length << 1 ^ (uint64_t)snake->alive) * 0x100000001b3ull;
+        hash = (hash ^ snake->rng.state) * 0x100000001b3ull;
+    }
+    return hash ^ arena->rng.state ^ (uint64_t)arena->food;
+}
+
+// Check that the grid, the bodies and the food count agree; returns what is
+// wrong, or NULL. O(cells + snakes x max_length): not for every tick.
+static inline const char* arenaCheck(const Arena* arena) {
+    long owned = 0, covered = 0;
+    int food = 0;
+
+    for (int i = 0; i < arena->cells; i++) {
+        if (arena->grid[i] < ARENA_FOOD || arena->grid[i] >= arena->count) return "unknown value in the grid";
+        if (arena->grid[i] == ARENA_FOOD) food++;
+        if (arena->grid[i] >= 0) owned++;
+    }
+    if (food != arena->food) return "food count and grid disagree";
+    for (int id = 0; id < arena->count; id++) {
+        const ArenaSnake* snake = &arena->snakes[id];
+        if (snake->head < 0 || snake->head >= arena->max_length) return "snake out of shape";
+        if (!snake->alive) continue;
+        if (snake->length < 1 || snake->length > arena->max_length || arenaReverse(snake->direction) == 0) {
+            return "snake out of shape";
+        }
+        for (int i = 0; i < snake->length; i++) {
+            int cell = arenaBody(arena, id)[(snake->head - i + arena->max_length) % arena->max_length];
+            if (cell < 0 || cell >= arena->cells || arena->grid[cell] != id) return "body cell not in the grid";
+        }
+        covered += snake->length;
+    }
+    return owned == covered ? NULL : "grid cell owned by no body";
+}
+
+// Saved arena: this header, then the grid (cells int32), the snakes
+// (count ArenaSnake) and their bodies (count x max_length int32)
+typedef struct {
+    int32_t rows, cols;
+    int32_t count, max_length;
+    int32_t food, food_target;
+    uint64_t tick;
+    uint64_t deaths;
+    uint64_t rng;
+} ArenaSnapshot;
+
+static inline size_t arenaSnapshotSize(const Arena* arena) {
+    return sizeof(ArenaSnapshot) + (size_t)arena->cells * sizeof(int32_t)
+           + (size_t)arena->count * sizeof(ArenaSnake)
+           + (size_t)arena->count * arena->max_length * sizeof(int32_t);
+}
+
+static inline void arenaSnapshotWrite(const Arena* arena, void* out) {
+    ArenaSnapshot* snapshot = out;
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->rows = arena->rows;
+    snapshot->cols = arena->cols;
+    snapshot->count = arena->count;
+    snapshot->max_length = arena->max_length;
+    snapshot->food = arena->food;
+    snapshot->food_target = arena->food_target;
+    snapshot->tick = arena->tick;
+    snapshot->deaths = arena->deaths;
+    snapshot->rng = arena->rng.state;
+
+    char* p = (char*)(snapshot + 1);
+    memcpy(p, arena->grid, (size_t)arena->cells * sizeof(int32_t));
+    p += (size_t)arena->cells * sizeof(int32_t);
+    memcpy(p, arena->snakes, (size_t)arena->count * sizeof(ArenaSnake));
+    p += (size_t)arena->count * sizeof(ArenaSnake);
+    memcpy(p, arena->bodies, (size_t)arena->count * arena->max_length * sizeof(int32_t));
+}
+
+// Set up an arena from a snapshot of 'size' bytes; returns -1 if it does
+// not describe a valid one
+static inline int arenaSnapshotRead(Arena* arena, const void* in, size_t size) {
+    const ArenaSnapshot* snapshot = in;
+    if (size < sizeof(ArenaSnapshot) || snapshot->rows <= 0 || snapshot->cols <= 0
+        || (long)snapshot->rows * snapshot->cols > INT32_MAX / 2 || snapshot->count < 1
+        || snapshot->count > ARENA_MAX_SNAKES || snapshot->max_length < 1
+        || (long)snapshot->count * snapshot->max_length > INT32_MAX / 2 || snapshot->food < 0
+        || snapshot->food_target < 0) {
+        return -1;
+    }
+    int cells = snapshot->rows * snapshot->cols;
+    if (size != sizeof(ArenaSnapshot) + (size_t)cells * sizeof(int32_t) + (size_t)snapshot->count * sizeof(ArenaSnake)
+                + (size_t)snapshot->count * snapshot->max_length * sizeof(int32_t)) {
+        return -1;
+    }
+
+    if (arenaInit(arena, snapshot->rows, snapshot->cols, snapshot->count, 0, snapshot->max_length) == -1) {
+        return -1;
+    }
+    const char* p = (const char*)(snapshot + 1);
+    memcpy(arena->grid, p, (size_t)cells * sizeof(int32_t));
+    p += (size_t)cells * sizeof(int32_t);
+    memcpy(arena->snakes, p, (size_t)arena->count * sizeof(ArenaSnake));
+    p += (size_t)arena->count * sizeof(ArenaSnake);
+    memcpy(arena->bodies, p, (size_t)arena->count * arena->max_length * sizeof(int32_t));
+
+    arena->food = snapshot->food;
+    arena->food_target = snapshot->food_target;
+    arena->tick = snapshot->tick;
+    arena->deaths = (unsigned long)snapshot->deaths;
+    arena->rng.state = snapshot->rng;
+    if (arenaCheck(arena) != NULL) {
+        arenaFree(arena);
+        return -1;
+    }
+    return 0;
+}
+
+#endif
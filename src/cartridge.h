@@ -0,0 +1,241 @@
+#ifndef CARTRIDGE_H
+#define CARTRIDGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "catalog.h"
+
+// Game cartridges: many games in one archive file.
+//
+// A cartridge is a CartridgeHeader, an index of CartridgeEntry sorted by
+// name, then the files themselves, each starting on a page boundary. The
+// games are the executables ("game_snake") and their plugins
+// ("game_snake.so"). Building one is vgc_cart's job.
+//
+// Opening maps the archive and checks the header and the index checksum.
+// Nothing is read per game, so a cartridge with hundreds of games opens
+// as fast as one with a single game. A file's own checksum is only checked
+// the first time it is used, and the result is remembered.
+//
+// A game cannot be executed from inside the archive, so it is copied once
+// into a sealed memfd (anonymous memory, never the file system) and started
+// with fexecve(); a plugin is dlopen()ed through /proc/self/fd. The memfd
+// is kept for the next launch.
+//
+// memfd_create() needs _GNU_SOURCE, defined before the first #include.
+
+#define CARTRIDGE_MAGIC "VCRT"
+#define CARTRIDGE_VERSION 1
+#define CARTRIDGE_EXTENSION ".vcart"
+#define CARTRIDGE_ALIGN 4096
+#define CARTRIDGE_NAME_LENGTH 64
+
+enum { CARTRIDGE_EXECUTABLE, CARTRIDGE_PLUGIN };
+enum { CARTRIDGE_UNCHECKED, CARTRIDGE_GOOD, CARTRIDGE_CORRUPT };
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;           // Index entries
+    uint32_t entry_size;      // sizeof(CartridgeEntry)
+    uint64_t size;            // The whole archive
+    uint64_t index_checksum;  // cartridgeChecksum() of the index
+} CartridgeHeader;
+
+typedef struct {
+    char name[CARTRIDGE_NAME_LENGTH]; // File name, NUL-terminated
+    uint32_t kind;            // CARTRIDGE_EXECUTABLE or CARTRIDGE_PLUGIN
+    uint32_t mode;            // Permissions of the file it was made from
+    uint64_t offset;          // From the start of the archive
+    uint64_t size;
+    int64_t mtime_ns;         // Of the file it was made from
+    uint64_t checksum;        // cartridgeChecksum() of its bytes
+} CartridgeEntry;
+
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    const unsigned char* map; // The whole archive, read-only
+    size_t size;
+    int64_t mtime_ns;
+    const CartridgeEntry* entries;
+    int count;
+    uint8_t* checked;         // CARTRIDGE_UNCHECKED, GOOD or CORRUPT per entry
+    int* memfds;              // Per entry, -1 until first used
+} Cartridge;
+
+// FNV-1a, 64 bits
+static inline uint64_t cartridgeChecksum(const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Does 'path' name a cartridge rather than a directory?
+static inline int isCartridgePath(const char* path) {
+    size_t length = strlen(path), extension = strlen(CARTRIDGE_EXTENSION);
+    return length > extension && strcmp(path + length - extension, CARTRIDGE_EXTENSION) == 0;
+}
+
+// Map the cartridge at 'path'; returns -1 with errno set if it is missing
+// or malformed
+static inline int cartridgeOpen(Cartridge* cart, const char* path) {
+    struct stat st;
+
+    memset(cart, 0, sizeof(*cart));
+    if (snprintf(cart->path, sizeof(cart->path), "%s", path) >= (int)sizeof(cart->path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(CartridgeHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const CartridgeHeader* header = map;
+    size_t indexSize = (size_t)header->count * sizeof(CartridgeEntry);
+    if (memcmp(header->magic, CARTRIDGE_MAGIC, 4) != 0 || header->version != CARTRIDGE_VERSION
+        || header->entry_size != sizeof(CartridgeEntry) || header->size != (uint64_t)st.st_size
+        || header->count > (st.st_size - sizeof(CartridgeHeader)) / sizeof(CartridgeEntry)
+        || header->index_checksum != cartridgeChecksum(header + 1, indexSize)) {
+        munmap(map, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Entries must be sorted, named and inside the archive
+    const CartridgeEntry* entries = (const CartridgeEntry*)(header + 1);
+    for (uint32_t i = 0; i < header->count; i++) {
+        const CartridgeEntry* entry = &entries[i];
+        if (memchr(entry->name, '\0', sizeof(entry->name)) == NULL || entry->name[0] == '\0'
+            || entry->kind > CARTRIDGE_PLUGIN || entry->offset < sizeof(CartridgeHeader) + indexSize
+            || entry->offset > (uint64_t)st.st_size || entry->size > (uint64_t)st.st_size - entry->offset
+            || (i > 0 && strcmp(entries[i - 1].name, entry->name) >= 0)) {
+            munmap(map, (size_t)st.st_size);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    cart->map = map;
+    cart->size = (size_t)st.st_size;
+    cart->mtime_ns = statMtimeNs(&st);
+    cart->entries = entries;
+    cart->count = (int)header->count;
+    cart->checked = calloc((size_t)cart->count + 1, 1);
+    cart->memfds = malloc(((size_t)cart->count + 1) * sizeof(int));
+    if (cart->checked == NULL || cart->memfds == NULL) {
+        perror("Unable to allocate the cartridge");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < cart->count; i++) cart->memfds[i] = -1;
+    return 0;
+}
+
+static inline void cartridgeClose(Cartridge* cart) {
+    for (int i = 0; i < cart->count; i++) {
+        if (cart->memfds[i] != -1) close(cart->memfds[i]);
+    }
+    if (cart->map != NULL) munmap((void*)cart->map, cart->size);
+    free(cart->checked);
+    free(cart->memfds);
+    memset(cart, 0, sizeof(*cart));
+}
+
+// Index of the entry called 'name', or -1
+static inline int cartridgeFind(const Cartridge* cart, const char* name) {
+    int low = 0, high = cart->count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        int cmp = strcmp(cart->entries[mid].name, name);
+        if (cmp == 0) return mid;
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return -1;
+}
+
+// Check entry 'i' against its checksum the first time; returns 1 if it is intact
+static inline int cartridgeVerify(Cartridge* cart, int i) {
+    if (cart->checked[i] == CARTRIDGE_UNCHECKED) {
+        const CartridgeEntry* entry = &cart->entries[i];
+        int good = cartridgeChecksum(cart->map + entry->offset, entry->size) == entry->checksum;
+        cart->checked[i] = good ? CARTRIDGE_GOOD : CARTRIDGE_CORRUPT;
+    }
+    return cart->checked[i] == CARTRIDGE_GOOD;
+}
+
+// A sealed memfd holding entry 'i', made on first use; returns -1 with
+// errno set if the entry is corrupt or the memfd cannot be made
+static inline int cartridgeMemfd(Cartridge* cart, int i) {
+    if (cart->memfds[i] != -1) return cart->memfds[i];
+    if (!cartridgeVerify(cart, i)) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    const CartridgeEntry* entry = &cart->entries[i];
+    int fd = memfd_create(entry->name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) return -1;
+    size_t done = 0;
+    while (done < entry->size) {
+        ssize_t n = write(fd, cart->map + entry->offset + done, entry->size - done);
+        if (n <= 0) {
+            int error = n == -1 ? errno : EIO;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    // Nothing can change it now, so it is only ever checked once
+    fchmod(fd, 0755);
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    cart->memfds[i] = fd;
+    return fd;
+}
+
+// Fill 'catalog' with the cartridge's games, without touching their bytes.
+// Entries keep the cartridge's path and their index in 'slot'; the catalog
+// lives in the cartridge's directory for logs and storage.
+static inline void cartridgeCatalog(const Cartridge* cart, Catalog* catalog) {
+    memset(catalog, 0, sizeof(*catalog));
+    catalog->watch_fd = -1;
+    snprintf(catalog->dir, sizeof(catalog->dir), "%s", cart->path);
+    char* slash = strrchr(catalog->dir, '/');
+    if (slash == NULL) snprintf(catalog->dir, sizeof(catalog->dir), ".");
+    else if (slash == catalog->dir) slash[1] = '\0';
+    else *slash = '\0';
+
+    catalogReserve(catalog, cart->count);
+    for (int i = 0; i < cart->count; i++) {
+        const CartridgeEntry* source = &cart->entries[i];
+        if (source->kind != CARTRIDGE_EXECUTABLE || !isGameName(source->name)) continue;
+
+        GameEntry* entry = &catalog->entries[catalog->count++];
+        memset(entry, 0, sizeof(*entry));
+        snprintf(entry->name, sizeof(entry->name), "%s", source->name);
+        snprintf(entry->path, sizeof(entry->path), "%s", cart->path);
+        entry->size = (int64_t)source->size;
+        entry->mtime_ns = source->mtime_ns;
+        entry->executable = 1;
+        entry->slot = i + 1;
+    }
+}
+
+#endif
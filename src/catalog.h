@@ -0,0 +1,328 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+// Game catalog for the console menu.
+//
+// The list of games is kept in an index file inside the game directory, so
+// the launcher starts by reading one small file instead of walking the whole
+// directory. The index is used while the directory's mtime matches the
+// one recorded in it; otherwise the directory is scanned once and the index
+// rewritten. A chmod or a game rewritten in place leaves the directory's
+// mtime alone, so every entry read from the index is still checked against
+// its file (one stat() each, no directory walk), and paths are always
+// rebuilt from the directory, which is made absolute, rather than taken
+// from the index. While the menu is open an inotify watch on the directory keeps
+// the catalog, and the index, up to date as games are added or removed.
+//
+// The entries grow as needed and stay sorted by name, so the games starting
+// with a prefix are one contiguous run found by two binary searches; that is
+// the menu's type-ahead index (catalogPrefix()).
+
+#define CATALOG_INITIAL 64 // Entries; grows as needed
+#define MAX_NAME_LENGTH 256
+#define MAX_PATH_LENGTH 512
+#define CATALOG_FILE ".vgc_catalog"
+#define CATALOG_MAGIC 0x47544356u // "VCTG"
+#define CATALOG_VERSION 1
+
+// One game, stored on disk exactly as laid out here
+typedef struct {
+    char name[MAX_NAME_LENGTH];
+    char path[MAX_PATH_LENGTH];
+    int64_t size;
+    int64_t mtime_ns;
+    int32_t executable;
+    int32_t slot;           // Cartridge entry + 1 (see cartridge.h), 0 for a file
+} GameEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t entry_size;
+    int64_t dir_mtime_ns;   // Directory mtime the entries were taken at
+} CatalogHeader;
+
+typedef struct {
+    char dir[MAX_PATH_LENGTH];
+    GameEntry* entries;            // Sorted by name
+    int count;
+    int capacity;
+    int watch_fd;                  // inotify descriptor, -1 when not watching
+} Catalog;
+
+static inline int64_t statMtimeNs(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+// Games are files named "game_*" without an extension (sources, plugins...)
+static inline int isGameName(const char* name) {
+    return strncmp(name, "game_", 5) == 0 && strchr(name, '.') == NULL;
+}
+
+// Make room for 'count' entries
+static inline void catalogReserve(Catalog* catalog, int count) {
+    if (count <= catalog->capacity) return;
+    int capacity = catalog->capacity > 0 ? catalog->capacity : CATALOG_INITIAL;
+    while (capacity < count) capacity *= 2;
+    GameEntry* entries = realloc(catalog->entries, sizeof(GameEntry) * capacity);
+    if (entries == NULL) {
+        perror("Unable to allocate the catalog");
+        exit(EXIT_FAILURE);
+    }
+    catalog->entries = entries;
+    catalog->capacity = capacity;
+}
+
+// Fill 'entry' from the file system; returns 0 if 'name' is a regular file
+static inline int catalogStat(const Catalog* catalog, const char* name, GameEntry* entry) {
+    struct stat st;
+
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    if (snprintf(entry->path, sizeof(entry->path), "%s/%s", catalog->dir, name) >= (int)sizeof(entry->path)
+        || stat(entry->path, &st) == -1 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    entry->size = st.st_size;
+    entry->mtime_ns = statMtimeNs(&st);
+    entry->executable = access(entry->path, X_OK) == 0;
+    return 0;
+}
+
+// Entries first .. last - 1 are the games whose name starts with 'prefix'
+// (first == last when none do)
+static inline void catalogPrefix(const Catalog* catalog, const char* prefix, int* first, int* last) {
+    size_t length = strlen(prefix);
+
+    for (int bound = 0; bound < 2; bound++) {
+        // First entry past the names below 'prefix', then past those starting with it
+        int low = 0, high = catalog->count;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            int cmp = strncmp(catalog->entries[mid].name, prefix, length);
+            if (cmp < 0 || (bound == 1 && cmp == 0)) low = mid + 1;
+            else high = mid;
+        }
+        *(bound == 0 ? first : last) = low;
+    }
+}
+
+// Position of 'name' in the sorted entries, or where it would be inserted
+static inline int catalogFind(const Catalog* catalog, const char* name, int* found) {
+    int low = 0, high = catalog->count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        int cmp = strcmp(catalog->entries[mid].name, name);
+        if (cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    *found = 0;
+    return low;
+}
+
+// Insert or refresh one game, or drop it if it no longer exists.
+// Returns 1 if the catalog changed.
+static inline int catalogUpdate(Catalog* catalog, const char* name) {
+    GameEntry entry;
+    int found;
+
+    if (!isGameName(name)) return 0;
+
+    int pos = catalogFind(catalog, name, &found);
+    if (catalogStat(catalog, name, &entry) == -1) {
+        if (!found) return 0;
+        memmove(&catalog->entries[pos], &catalog->entries[pos + 1],
+                sizeof(GameEntry) * (catalog->count - pos - 1));
+        catalog->count--;
+        return 1;
+    }
+
+    if (found) {
+        if (memcmp(&catalog->entries[pos], &entry, sizeof(entry)) == 0) return 0;
+    } else {
+        catalogReserve(catalog, catalog->count + 1);
+        memmove(&catalog->entries[pos + 1], &catalog->entries[pos],
+                sizeof(GameEntry) * (catalog->count - pos));
+        catalog->count++;
+    }
+    catalog->entries[pos] = entry;
+    return 1;
+}
+
+// Scan the directory for games
+static inline void catalogScan(Catalog* catalog) {
+    DIR* dir;
+    struct dirent* entry;
+
+    catalog->count = 0;
+    dir = opendir(catalog->dir);
+    if (dir == NULL) {
+        perror("Unable to open directory");
+        exit(EXIT_FAILURE);
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        catalogUpdate(catalog, entry->d_name);
+    }
+    closedir(dir);
+}
+
+// Write the index file. Rewriting an existing index in place leaves the
+// directory mtime alone, so the recorded mtime stays valid.
+static inline void catalogSave(const Catalog* catalog) {
+    char path[MAX_PATH_LENGTH + sizeof(CATALOG_FILE)];
+    CatalogHeader header;
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", catalog->dir, CATALOG_FILE);
+    int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) return; // Read-only directory: scan again next time
+
+    // Take the directory mtime after the index file exists
+    if (stat(catalog->dir, &st) == -1) {
+        close(fd);
+        return;
+    }
+    header.magic = CATALOG_MAGIC;
+    header.version = CATALOG_VERSION;
+    header.count = (uint32_t)catalog->count;
+    header.entry_size = sizeof(GameEntry);
+    header.dir_mtime_ns = statMtimeNs(&st);
+
+    size_t size = sizeof(GameEntry) * catalog->count;
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)
+        || write(fd, catalog->entries, size) != (ssize_t)size
+        || ftruncate(fd, sizeof(header) + size) == -1) {
+        // Never leave a half-written index behind
+        if (ftruncate(fd, 0) == -1) unlink(path);
+    }
+    close(fd);
+}
+
+// Read the index file; returns 0 if it is present and still current
+static inline int catalogLoad(Catalog* catalog) {
+    char path[MAX_PATH_LENGTH + sizeof(CATALOG_FILE)];
+    CatalogHeader header;
+    struct stat st, index;
+    int result = -1;
+
+    snprintf(path, sizeof(path), "%s/%s", catalog->dir, CATALOG_FILE);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+
+    if (read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+        && header.magic == CATALOG_MAGIC
+        && header.version == CATALOG_VERSION
+        && header.entry_size == sizeof(GameEntry)
+        && fstat(fd, &index) == 0
+        && (uint64_t)header.count * sizeof(GameEntry) + sizeof(header) == (uint64_t)index.st_size
+        && stat(catalog->dir, &st) == 0
+        && header.dir_mtime_ns == statMtimeNs(&st)) {
+        size_t size = sizeof(GameEntry) * header.count;
+        catalogReserve(catalog, (int)header.count);
+        if (read(fd, catalog->entries, size) == (ssize_t)size) {
+            catalog->count = (int)header.count;
+            result = 0;
+        }
+    }
+    close(fd);
+    return result;
+}
+
+// Check the entries read from the index against their files, dropping those
+// that are gone; returns 1 if any changed
+static inline int catalogRecheck(Catalog* catalog) {
+    int changed = 0, kept = 0;
+
+    for (int i = 0; i < catalog->count; i++) {
+        GameEntry entry;
+        catalog->entries[i].name[MAX_NAME_LENGTH - 1] = '\0';
+        if (catalogStat(catalog, catalog->entries[i].name, &entry) == -1) {
+            changed = 1;
+            continue;
+        }
+        if (memcmp(&entry, &catalog->entries[i], sizeof(entry)) != 0) changed = 1;
+        catalog->entries[kept++] = entry;
+    }
+    catalog->count = kept;
+    return changed;
+}
+
+// Open the catalog of 'dir', using the index when it is current
+static inline void catalogOpen(Catalog* catalog, const char* dir) {
+    memset(catalog, 0, sizeof(*catalog));
+    char* absolute = realpath(dir, NULL); // Paths that hold from any working directory
+    snprintf(catalog->dir, sizeof(catalog->dir), "%s", absolute != NULL ? absolute : dir);
+    free(absolute);
+    catalog->watch_fd = -1;
+
+    if (catalogLoad(catalog) == -1) {
+        catalogScan(catalog);
+        catalogSave(catalog);
+    } else if (catalogRecheck(catalog)) {
+        catalogSave(catalog);
+    }
+}
+
+// Start watching the directory; returns the descriptor to poll, or -1
+static inline int catalogWatch(Catalog* catalog) {
+    catalog->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (catalog->watch_fd == -1) return -1;
+
+    if (inotify_add_watch(catalog->watch_fd, catalog->dir,
+                          IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                          | IN_ATTRIB | IN_CLOSE_WRITE) == -1) {
+        close(catalog->watch_fd);
+        catalog->watch_fd = -1;
+    }
+    return catalog->watch_fd;
+}
+
+// Apply pending directory events; returns 1 if the catalog changed
+static inline int catalogRefresh(Catalog* catalog) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t len;
+
+    if (catalog->watch_fd == -1) return 0;
+
+    while ((len = read(catalog->watch_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + len;) {
+            struct inotify_event* event = (struct inotify_event*)p;
+            if (event->mask & IN_Q_OVERFLOW) {
+                catalogScan(catalog); // Events were lost
+                changed = 1;
+            } else if (event->len > 0) {
+                changed |= catalogUpdate(catalog, event->name);
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (changed) catalogSave(catalog);
+    return changed;
+}
+
+static inline void catalogClose(Catalog* catalog) {
+    if (catalog->watch_fd != -1) close(catalog->watch_fd);
+    catalog->watch_fd = -1;
+    free(catalog->entries);
+    catalog->entries = NULL;
+    catalog->count = catalog->capacity = 0;
+}
+
+#endif
@@ -0,0 +1,662 @@
+#ifndef CONSOLE_RUNTIME_H
+#define CONSOLE_RUNTIME_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include "renderer.h"
+#include "tick_loop.h"
+#include "tick_stats.h"
+#include "input_log.h"
+#include "input_queue.h"
+#include "snapshot.h"
+#include "score_store.h"
+#include "probe.h"
+#include "vgc_random.h"
+#include "vgc_plugin.h"
+#include "netplay.h"
+
+// Console runtime shared by the launcher and every game: terminal mode,
+// signal handling and the event loop that drives a VgcGame.
+//
+// Games and the launcher using it build with -pthread (see snapshot.h).
+
+// Global terminal settings
+static struct termios original_termios;
+
+// What the signal handler has to clean up and how to say goodbye
+static Renderer* runtime_screen = NULL;
+static InputLog* runtime_record = NULL;
+static Probe* runtime_probe = NULL;
+static const char* runtime_title = "Game";
+
+// Replays without a tick rate play this many keys per second
+#define REPLAY_KEY_RATE 4.0
+
+#define MAX_RECORD_PATH 512
+#define MAX_PROGRAM_LENGTH 256 // Program names keep apart in the score log
+
+// Running games are saved in the background this often
+#define AUTOSAVE_INTERVAL_NS 5000000000ull
+
+// What a running game writes besides the screen: its input recording and
+// its save state
+typedef struct {
+    InputLog log;
+    InputLog* record;         // &log while recording, otherwise NULL
+    SnapshotWriter writer;
+    SnapshotWriter* saves;    // &writer while saving, otherwise NULL
+    ScoreLog scores;          // Where the result goes; fd -1 when not keeping scores
+    Probe probe;              // Per-frame timings for vgc_top
+    char program[MAX_PROGRAM_LENGTH];
+    int resumed;              // Started from the save state rather than init()
+} VgcSession;
+
+// Set terminal input mode for non-canonical input. Reads never block: every
+// loop polls before it reads.
+static inline void setInputMode(void) {
+    struct termios new_termios;
+    tcgetattr(STDIN_FILENO, &original_termios);
+    new_termios = original_termios;
+    new_termios.c_lflag &= ~(ICANON | ECHO); // Disable canonical mode and echo
+    new_termios.c_cc[VMIN] = 0;
+    new_termios.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
+}
+
+// Restore the original terminal settings
+static inline void restoreInputMode(void) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+}
+
+// Signal handler for graceful exit
+static inline void signalHandler(int signo) {
+    if (runtime_screen != NULL) rendererFinish(runtime_screen);
+    if (runtime_record != NULL) inputLogClose(runtime_record); // Keep what was recorded
+    if (runtime_probe != NULL) probeClose(runtime_probe);
+    restoreInputMode();
+    printf("\n%s exited due to signal %d. Goodbye!\n", runtime_title, signo);
+    exit(0);
+}
+
+// File name part of a program path
+static inline const char* vgcProgramName(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+// Start recording a session to 'path', or when that is NULL to
+// $VGC_RECORD_DIR/<program>-<seed>.vlog if VGC_RECORD_DIR is set. 'argv[0]'
+// is the program. Returns the log, or NULL when not recording.
+static inline InputLog* vgcRecordStart(InputLog* log, const VgcGame* game, const char* path,
+                                       int argc, char* argv[], uint64_t seed, double tickRate) {
+    char generated[MAX_RECORD_PATH];
+    const char* dir = getenv("VGC_RECORD_DIR");
+
+    if (path == NULL) {
+        if (dir == NULL || dir[0] == '\0') return NULL;
+        snprintf(generated, sizeof(generated), "%s/%s-%016llx.vlog", dir,
+                 vgcProgramName(argv[0]), (unsigned long long)seed);
+        path = generated;
+    }
+    if (inputLogCreate(log, path, game->name, seed, tickRate, argc - 1, argv + 1) == -1) {
+        return NULL; // Play on without a recording
+    }
+    return log;
+}
+
+// Record the keys the game played by itself in the tick just run
+static inline void vgcRecordOwnKeys(const VgcGame* game, void* state, InputLog* record, uint64_t ticks) {
+    char keys[16];
+
+    if (record == NULL || game->own_keys == NULL) return;
+    size_t count = game->own_keys(state, keys, sizeof(keys));
+    for (size_t i = 0; i < count && i < sizeof(keys); i++) inputLogOwnKey(record, ticks, keys[i]);
+}
+
+// Set up a game from the snapshot at 'path'; NULL if there is no usable one
+static inline void* vgcResume(const VgcGame* game, const char* path, double* tickRate) {
+    void* mapping;
+    size_t mappingSize, size;
+
+    void* payload = snapshotMap(path, game->name, game->state_version, &size, &mapping, &mappingSize);
+    if (payload == NULL) {
+        return NULL;
+    }
+    void* state = game->resume(payload, size, tickRate);
+    snapshotUnmap(mapping, mappingSize);
+    return state;
+}
+
+// Hand the game's current state to the snapshot writer, or have the
+// snapshot removed when the game has nothing worth resuming
+static inline void vgcSave(const VgcGame* game, void* state, SnapshotWriter* writer) {
+    size_t size = game->save(state, NULL, 0);
+    if (size == 0) {
+        snapshotRemove(writer);
+        return;
+    }
+    game->save(state, snapshotStage(writer, size), size);
+    snapshotCommit(writer, game->name, game->state_version);
+}
+
+// Snapshot path in 'dir' for the program and arguments in 'argv': a game
+// started with other arguments is another game, so the arguments go into
+// the name as an FNV-1a hash; <program>.vsnap without any
+static inline void vgcSavePath(char* path, size_t size, const char* dir, int argc, char* argv[]) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    if (argc <= 1) {
+        snprintf(path, size, "%s/%s.vsnap", dir, vgcProgramName(argv[0]));
+        return;
+    }
+    for (int i = 1; i < argc; i++) {
+        const unsigned char* bytes = (const unsigned char*)argv[i];
+        size_t length = strlen(argv[i]) + 1; // The NUL keeps "-r 12" apart from "-r1 2"
+        for (size_t j = 0; j < length; j++) {
+            hash = (hash ^ bytes[j]) * 0x100000001b3ull;
+        }
+    }
+    snprintf(path, size, "%s/%s-%016llx.vsnap", dir, vgcProgramName(argv[0]), (unsigned long long)hash);
+}
+
+// Start a session of 'game': resume its save state from the vgcSavePath()
+// in $VGC_SAVE_DIR unless 'fresh', or else start a new game
+// from the arguments and 'seed'. A new game is recorded (see
+// vgcRecordStart()); a resumed one cannot be replayed from the start, so it
+// is not. The result goes to the score log in $VGC_SCORE_DIR. Returns the
+// game state, or NULL if the game could not start.
+static inline void* vgcSessionStart(VgcSession* session, const VgcGame* game, int argc, char* argv[],
+                                    double* tickRate, uint64_t seed, const char* recordPath, int fresh) {
+    char path[SNAPSHOT_PATH_LENGTH];
+    const char* dir = getenv("VGC_SAVE_DIR");
+    const char* scoreDir = getenv("VGC_SCORE_DIR");
+    void* state = NULL;
+
+    memset(session, 0, sizeof(*session));
+    session->scores.fd = -1;
+    snprintf(session->program, sizeof(session->program), "%s", vgcProgramName(argv[0]));
+    path[0] = '\0';
+    if (dir != NULL && dir[0] != '\0') {
+        vgcSavePath(path, sizeof(path), dir, argc, argv);
+        if (!fresh) state = vgcResume(game, path, tickRate);
+    }
+
+    session->resumed = state != NULL;
+    if (state == NULL) {
+        state = game->init(argc, argv, tickRate, seed);
+        if (state == NULL) return NULL;
+
+        session->record = vgcRecordStart(&session->log, game, recordPath, argc, argv, seed, *tickRate);
+        if (session->record == NULL && recordPath != NULL) {
+            perror("Unable to record the session");
+        }
+    }
+    if (path[0] != '\0' && snapshotWriterStart(&session->writer, path) == 0) {
+        session->saves = &session->writer;
+    }
+    if (scoreDir != NULL && scoreDir[0] != '\0') {
+        scoreLogOpen(&session->scores, scoreDir); // Played without scores if it fails
+    }
+    probeOpen(&session->probe, session->program);
+    return state;
+}
+
+// Wait for the last save and the result to reach the disk
+static inline void vgcSessionEnd(VgcSession* session) {
+    if (session->saves != NULL) snapshotWriterStop(session->saves);
+    session->saves = NULL;
+    scoreLogClose(&session->scores);
+    probeClose(&session->probe);
+}
+
+// Drive an initialized game on 'screen' until it ends, keeping tick and
+// latency statistics in 'loop'. With a 'session' (may be NULL) every key is
+// recorded, the game is saved every AUTOSAVE_INTERVAL_NS and when it ends,
+// and every frame's timings go to the session's probe. Returns the
+// CLOCK_MONOTONIC time the first frame was shown.
+static inline uint64_t vgcRun(const VgcGame* game, void* state, double tickRate,
+                              Renderer* screen, TickLoop* loop, VgcSession* session) {
+    InputLog* record = session != NULL ? session->record : NULL;
+    SnapshotWriter* saves = session != NULL ? session->saves : NULL;
+    Probe off = { 0 };
+    Probe* probe = session != NULL ? &session->probe : &off;
+    Probe* outer = runtime_probe; // The launcher's, while it runs a plugin
+    InputParser parser;
+    InputQueue queue;
+    InputEvent event;
+    char input[64];
+    size_t inputLength;
+    uint64_t firstFrame = 0;
+    uint64_t ticks = 0; // Ticks the game has run
+    uint64_t lastSave = monotonicNs();
+    int running = 1;
+
+    if (tickLoopInit(loop, tickRate) == -1) {
+        if (record != NULL) inputLogClose(record);
+        return 0;
+    }
+    runtime_record = record;
+    if (probe->ring != NULL) runtime_probe = probe;
+    inputParserInit(&parser, game->arrows);
+    inputQueueInit(&queue);
+    inputQueueCoalesce(&queue, tickRate > 0 ? game->arrows : NULL); // Only directions of a real-time game
+
+    while (running) {
+        probeBegin(probe);
+        rendererClear(screen);
+        game->render(state, screen);
+        probeLap(probe, &probe->frame.render_ns);
+        rendererPresent(screen);
+        tickLoopPresented(loop);
+        probeLap(probe, &probe->frame.write_ns);
+        if (firstFrame == 0) firstFrame = monotonicNs();
+
+        // Sleep until a key arrives or the next tick is due
+        unsigned long syscalls = loop->syscalls;
+        int due = tickLoopWait(loop, STDIN_FILENO, input, sizeof(input), &inputLength);
+        probeLap(probe, &probe->frame.wait_ns);
+
+        uint64_t now = monotonicNs();
+        inputFeed(&parser, &queue, input, inputLength, now);
+        inputFlush(&parser, &queue, now);
+        while (running && inputQueuePop(&queue, &event)) {
+            if (record != NULL) inputLogKey(record, ticks, event.key);
+            running = game->handle_input(state, event.key);
+        }
+        probeLap(probe, &probe->frame.input_ns);
+        int ran = 0;
+        for (; ran < due && running; ran++) {
+            running = game->tick(state);
+            ticks++;
+            vgcRecordOwnKeys(game, state, record, ticks);
+        }
+        if (!loop->input_open && loop->timer_fd == -1) {
+            running = 0; // Input is gone and nothing else moves the game
+        }
+        if (running && saves != NULL && monotonicNs() - lastSave >= AUTOSAVE_INTERVAL_NS) {
+            vgcSave(game, state, saves);
+            lastSave = monotonicNs();
+        }
+        probeLap(probe, &probe->frame.sim_ns);
+        probeEnd(probe, screen->last.bytes, screen->last.syscalls + loop->syscalls - syscalls, (unsigned)ran);
+    }
+
+    // Show the final position
+    rendererClear(screen);
+    game->render(state, screen);
+    rendererPresent(screen);
+
+    tickLoopClose(loop);
+    loop->keys = queue.keys;
+    loop->coalesced = queue.coalesced;
+    if (record != NULL) inputLogFinish(record, ticks);
+    runtime_record = NULL;
+    runtime_probe = outer;
+    if (saves != NULL) vgcSave(game, state, saves);
+    if (session != NULL && session->scores.fd != -1) {
+        int64_t score = 0;
+        int outcome = game->result(state, &score);
+        if (outcome != SCORE_NONE) {
+            scoreLogAppend(&session->scores, session->program, outcome, score, ticks);
+        }
+    }
+    return firstFrame;
+}
+
+// Feed the recording's pending key to the game, a key it played by itself
+// through own_key()
+static inline int vgcReplayKey(const VgcGame* game, void* state, InputLog* log) {
+    char key = log->next_key;
+    int own = log->next_own;
+
+    inputLogNext(log);
+    if (own) return game->own_key != NULL ? game->own_key(state, key) : 1;
+    return game->handle_input(state, key);
+}
+
+// Advance a replay by one step: feed the keys recorded before this tick,
+// then tick. Games without a tick rate take one key per step. Returns 0 once
+// the game is over.
+static inline int vgcReplayStep(const VgcGame* game, void* state, double tickRate,
+                                InputLog* log, uint64_t* ticks) {
+    if (tickRate <= 0) {
+        return vgcReplayKey(game, state, log);
+    }
+    while (log->status == 1 && log->next_tick <= *ticks) {
+        if (!vgcReplayKey(game, state, log)) return 0;
+    }
+    (*ticks)++;
+    return game->tick(state);
+}
+
+// Has the replay used up the recording?
+static inline int vgcReplayDone(const InputLog* log, double tickRate, uint64_t ticks) {
+    return log->status != 1 && (tickRate <= 0 || ticks >= log->next_tick);
+}
+
+// Play a recording back, at the recorded pace on the terminal or, with
+// 'maxSpeed', as fast as possible without rendering. Reports where the
+// replay and the recording disagree.
+static inline int vgcReplay(const VgcGame* game, const char* path, int maxSpeed) {
+    InputLog log;
+    char summary[256] = "";
+    uint64_t ticks = 0;
+    int running = 1;
+
+    if (inputLogOpen(&log, path) == -1) {
+        return 1;
+    }
+    if (strcmp(log.header.game, game->name) != 0) {
+        fprintf(stderr, "%s is a recording of %s, not %s.\n", path, log.header.game, game->name);
+        inputLogClose(&log);
+        return 1;
+    }
+
+    double tickRate = log.header.tick_rate;
+    int set = getenv(VGC_REPLAY) == NULL;
+    if (set) setenv(VGC_REPLAY, "1", 1); // The game waits for its own keys from the recording
+    void* state = game->init(log.argc, log.argv, &tickRate, log.header.seed);
+    if (set) unsetenv(VGC_REPLAY);
+    if (state == NULL) {
+        inputLogClose(&log);
+        return 1;
+    }
+    tickRate = log.header.tick_rate; // Whatever the arguments say, keep the recorded pace
+
+    uint64_t start = monotonicNs();
+    if (maxSpeed) {
+        while (running && !vgcReplayDone(&log, tickRate, ticks)) {
+            running = vgcReplayStep(game, state, tickRate, &log, &ticks);
+        }
+    } else {
+        Renderer screen;
+        TickLoop loop;
+        char input[64];
+        size_t inputLength;
+
+        setInputMode();
+        signal(SIGINT, signalHandler);
+        signal(SIGTERM, signalHandler);
+        rendererInit(&screen, 1, 1);
+        runtime_screen = &screen;
+        if (tickLoopInit(&loop, tickRate > 0 ? tickRate : REPLAY_KEY_RATE) == 0) {
+            while (running && !vgcReplayDone(&log, tickRate, ticks)) {
+                rendererClear(&screen);
+                game->render(state, &screen);
+                rendererPresent(&screen);
+
+                int due = tickLoopWait(&loop, STDIN_FILENO, input, sizeof(input), &inputLength);
+                if (memchr(input, 'q', inputLength) != NULL) break; // Stop watching
+                for (int t = 0; t < due && running && !vgcReplayDone(&log, tickRate, ticks); t++) {
+                    running = vgcReplayStep(game, state, tickRate, &log, &ticks);
+                }
+            }
+            rendererClear(&screen);
+            game->render(state, &screen);
+            rendererPresent(&screen);
+            tickLoopClose(&loop);
+        }
+        rendererFinish(&screen);
+        runtime_screen = NULL;
+        rendererFree(&screen);
+        restoreInputMode();
+    }
+    uint64_t elapsed = monotonicNs() - start;
+
+    game->shutdown(state, summary, sizeof(summary));
+    if (summary[0] != '\0') {
+        printf("\n%s\n", summary);
+    }
+    printf("Replayed %llu ticks in %.3f ms (%.0f ticks/s)\n", (unsigned long long)ticks,
+           elapsed / 1e6, elapsed > 0 ? ticks * 1e9 / elapsed : 0.0);
+    if (!running && !vgcReplayDone(&log, tickRate, ticks)) {
+        printf("Desync: the game ended at tick %llu, the recording goes on to tick %llu.\n",
+               (unsigned long long)ticks, (unsigned long long)log.next_tick);
+    } else if (running && log.status == 0) {
+        printf("The recording ends at tick %llu with the game still running.\n",
+               (unsigned long long)ticks);
+    } else if (log.status == -1) {
+        printf("The recording was cut short at tick %llu.\n", (unsigned long long)log.next_tick);
+    }
+    inputLogClose(&log);
+    return 0;
+}
+
+// Run 'ticks' simulation steps as fast as possible, with no terminal, no
+// rendering and no sleeping. Each step feeds one key, from 'script' (repeated;
+// '.' means no key) or picked at random from the game's keys, and then ticks
+// once. A game that ends is started again with the next seed. Prints steps
+// per second and the step time distribution.
+static inline int vgcHeadless(const VgcGame* game, int argc, char* argv[],
+                              unsigned long ticks, const char* script, uint64_t seed) {
+    TickStats stats;
+    VgcRandom rng;
+    char summary[256];
+    double tickRate = game->tick_rate;
+    size_t scriptLength = script != NULL ? strlen(script) : 0;
+    size_t keyCount = game->keys != NULL ? strlen(game->keys) : 0;
+    unsigned long games = 1;
+
+    vgcRandomSeed(&rng, seed);
+    void* state = game->init(argc, argv, &tickRate, seed);
+    if (state == NULL) {
+        return 1;
+    }
+
+    tickStatsInit(&stats, ticks);
+    for (unsigned long t = 0; t < ticks; t++) {
+        char key = '.';
+        if (scriptLength > 0) {
+            key = script[t % scriptLength];
+        } else if (keyCount > 0) {
+            key = game->keys[vgcRandomRange(&rng, (int)keyCount)];
+        }
+
+        uint64_t start = monotonicNs();
+        int running = 1;
+        if (key != '.') running = game->handle_input(state, key);
+        if (running && tickRate > 0) running = game->tick(state);
+        tickStatsAdd(&stats, monotonicNs() - start);
+
+        if (!running && t + 1 < ticks) {
+            game->shutdown(state, summary, sizeof(summary));
+            state = game->init(argc, argv, &tickRate, vgcRandomNext(&rng));
+            if (state == NULL) {
+                tickStatsFree(&stats);
+                return 1;
+            }
+            games++;
+        }
+    }
+    game->shutdown(state, summary, sizeof(summary));
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s (%lu games)", game->name, games);
+    tickStatsPrint(&stats, label);
+    printf("\n");
+    tickStatsFree(&stats);
+    return 0;
+}
+
+// Play 'game' with a second player on another terminal (see netplay.h):
+// host it on 'address' or join the one hosted there. The host's arguments,
+// seed, 'delay' and 'lag' ("rtt[,jitter]" in ms, NULL for none) are the
+// guest's too. Netplay games are not saved, recorded or scored.
+static inline int vgcNetplay(const VgcGame* game, int argc, char* argv[], const char* address, int host,
+                             const char* lag, int delay, uint64_t seed) {
+    Netplay np;
+    Renderer screen;
+    TickLoop loop;
+    char summary[256] = "";
+    double tickRate = game->tick_rate;
+    uint64_t lagNs = 0, jitterNs = 0;
+    void* state = NULL;
+
+    if (game->seat == NULL || game->handle_player_input == NULL) {
+        fprintf(stderr, "%s is a one-player game.\n", game->name);
+        return 1;
+    }
+    if (lag != NULL && netplayParseLag(lag, &lagNs, &jitterNs) == -1) {
+        fprintf(stderr, "--lag takes the round trip and jitter in ms, e.g. --lag=200,30\n");
+        return 1;
+    }
+    if (delay < 0 || delay > NETPLAY_WINDOW / 2) {
+        fprintf(stderr, "--delay takes 0 to %d ticks\n", NETPLAY_WINDOW / 2);
+        return 1;
+    }
+    if (host) {
+        // A game that will not start is found out before anyone joins
+        state = game->init(argc, argv, &tickRate, seed);
+        if (state == NULL) return 1;
+        if (netplayHost(&np, address, game, argc, argv, seed, delay, lagNs, jitterNs) == -1) {
+            game->shutdown(state, summary, sizeof(summary));
+            return 1;
+        }
+    } else {
+        if (netplayJoin(&np, address, game, &argc, &argv, &seed) == -1) return 1;
+        state = game->init(argc, argv, &tickRate, seed);
+        if (state == NULL) {
+            netplayClose(&np);
+            return 1;
+        }
+    }
+    game->seat(state, np.player);
+
+    setInputMode();
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    rendererInit(&screen, 1, 1);
+    runtime_screen = &screen;
+
+    state = netplayRun(&np, game, state, tickRate, &screen, &loop);
+
+    rendererFinish(&screen);
+    runtime_screen = NULL;
+    rendererFree(&screen);
+    restoreInputMode();
+    netplayReport(&np, tickRate > 0);
+    tickLoopReport(&loop);
+    if (state == NULL) {
+        fprintf(stderr, "Unable to roll the game back.\n");
+    } else {
+        game->shutdown(state, summary, sizeof(summary));
+    }
+    netplayClose(&np);
+    if (summary[0] != '\0') {
+        printf("\n%s\n", summary);
+    }
+    return state == NULL;
+}
+
+// main() of a game built as its own executable. The runtime takes its own
+// options out of the arguments before the game sees them:
+//   --headless[=ticks], --script=keys   run vgcHeadless()
+//   --seed=n                            seed the game instead of a fresh seed
+//   --record=file                       record the session (default: see vgcRecordStart())
+//   --replay=file [--max-speed]         play a recording back with vgcReplay()
+//   --fresh                             start a new game even if one was saved
+//   --host=address, --join=address      play with someone else with vgcNetplay()
+//   --lag=rtt[,jitter] --delay=ticks    the host's netplay lag (ms) and input delay
+static inline int vgcMain(const VgcGame* game, int argc, char* argv[]) {
+    Renderer screen;
+    TickLoop loop;
+    VgcSession session;
+    char summary[256] = "";
+    double tickRate = game->tick_rate;
+    unsigned long headlessTicks = 0;
+    const char* script = NULL;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    int maxSpeed = 0;
+    int fresh = 0;
+    const char* hostAddress = NULL;
+    const char* joinAddress = NULL;
+    const char* lag = NULL;
+    int delay = NETPLAY_DEFAULT_DELAY;
+    uint64_t seed = vgcNewSeed();
+
+    // Take the runtime options out so the game only sees its own
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headlessTicks = 1000000;
+        } else if (strncmp(argv[i], "--headless=", 11) == 0) {
+            headlessTicks = strtoul(argv[i] + 11, NULL, 10);
+        } else if (strncmp(argv[i], "--script=", 9) == 0) {
+            script = argv[i] + 9;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 0);
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            recordPath = argv[i] + 9;
+        } else if (strncmp(argv[i], "--replay=", 9) == 0) {
+            replayPath = argv[i] + 9;
+        } else if (strcmp(argv[i], "--max-speed") == 0) {
+            maxSpeed = 1;
+        } else if (strcmp(argv[i], "--fresh") == 0) {
+            fresh = 1;
+        } else if (strncmp(argv[i], "--host=", 7) == 0) {
+            hostAddress = argv[i] + 7;
+        } else if (strncmp(argv[i], "--join=", 7) == 0) {
+            joinAddress = argv[i] + 7;
+        } else if (strncmp(argv[i], "--lag=", 6) == 0) {
+            lag = argv[i] + 6;
+        } else if (strncmp(argv[i], "--delay=", 8) == 0) {
+            delay = atoi(argv[i] + 8);
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    argv[argc] = NULL;
+    if (script != NULL && headlessTicks == 0) headlessTicks = strlen(script);
+    if (replayPath != NULL) {
+        return vgcReplay(game, replayPath, maxSpeed);
+    }
+    if (headlessTicks > 0) {
+        return vgcHeadless(game, argc, argv, headlessTicks, script, seed);
+    }
+    if (hostAddress != NULL || joinAddress != NULL) {
+        return vgcNetplay(game, argc, argv, hostAddress != NULL ? hostAddress : joinAddress, hostAddress != NULL,
+                          lag, delay, seed);
+    }
+
+    void* state = vgcSessionStart(&session, game, argc, argv, &tickRate, seed, recordPath, fresh);
+    if (state == NULL) {
+        return 1;
+    }
+
+    setInputMode(); // Set non-canonical input mode
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    rendererInit(&screen, 1, 1);
+    runtime_screen = &screen;
+
+    vgcRun(game, state, tickRate, &screen, &loop, &session);
+
+    rendererFinish(&screen);
+    runtime_screen = NULL;
+    rendererFree(&screen);
+    restoreInputMode(); // Restore terminal settings
+    vgcSessionEnd(&session);
+    tickLoopReport(&loop);
+    game->shutdown(state, summary, sizeof(summary));
+    if (summary[0] != '\0') {
+        printf("\n%s\n", summary);
+    }
+    return 0;
+}
+
+// Standalone builds get a main(); plugin builds only export vgc_game
+#ifdef VGC_PLUGIN
+#define VGC_GAME_MAIN(game)
+#else
+#define VGC_GAME_MAIN(game) \
+    int main(int argc, char* argv[]) { return vgcMain(&(game), argc, argv); }
+#endif
+
+#endif
@@ -1,141 +1,166 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <termios.h>
-#include <signal.h>
-#include <time.h>
+#include "console_runtime.h"
+#include "stars_engine.h"
 
-#define ROWS 15
-#define COLS 20
-#define PADDLE_WIDTH 3
+#define DEFAULT_ROWS 15
+#define DEFAULT_COLS 20
+#define DEFAULT_TICK_RATE 5.0 // Ticks per second
+#define SCREEN_WIDTH 60
+#define STATE_VERSION 3 // Layout of StarsSave and StarsSnapshot
 
-// Global variables
-struct termios original_termios;
-int paddle_pos = COLS / 2 - 1;
+// Saved game: these fields followed by the playfield's snapshot
+typedef struct {
+    double tick_rate;
+} StarsSave;
 
 // Function prototypes
-void initializeGrid(char grid[ROWS][COLS]);
-void printGrid(char grid[ROWS][COLS]);
-void updateGrid(char grid[ROWS][COLS]);
-void movePaddle(char direction);
-void dropStar(char grid[ROWS][COLS]);
-int checkCollision(char grid[ROWS][COLS]);
-void setInputMode();
-void restoreInputMode();
-void signalHandler(int signo);
-
-int main() {
-    char grid[ROWS][COLS];
-    int score = 0, running = 1;
-    char input;
-
-    srand(time(NULL));
-    setInputMode();
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
-
-    initializeGrid(grid);
-
-    while (running) {
-        system("clear");
-        printGrid(grid);
-        printf("Score: %d\n", score);
-        printf("Use 'a' to move left, 'd' to move right, 'q' to quit.\n");
-
-        if (read(STDIN_FILENO, &input, 1) > 0) {
-            if (input == 'q') {
-                running = 0;
-            } else if (input == 'a' || input == 'd') {
-                movePaddle(input);
-            }
+void* starsStart(int argc, char* argv[], double* tickRate, uint64_t seed);
+int starsTick(void* state);
+void starsRender(void* state, Renderer* screen);
+int starsInput(void* state, char input);
+void starsStop(void* state, char* summary, size_t size);
+size_t starsSave(void* state, void* buffer, size_t size);
+void* starsResume(void* snapshot, size_t size, double* tickRate);
+int starsResult(void* state, int64_t* score);
+void printGrid(StarsGame* game, Renderer* screen);
+
+const VgcGame vgc_game = {
+    VGC_PLUGIN_ABI, "Falling Stars", DEFAULT_TICK_RATE, "ad", STATE_VERSION,
+    starsStart, starsTick, starsRender, starsInput, starsStop,
+    starsSave, starsResume, starsResult, "..da",
+    NULL, NULL, NULL, NULL
+};
+
+VGC_GAME_MAIN(vgc_game)
+
+void* starsStart(int argc, char* argv[], double* tickRate, uint64_t seed) {
+    int rows = DEFAULT_ROWS, cols = DEFAULT_COLS;
+    int fillTerminal = 0;
+    int mode = 0;
+    int opt;
+
+    optind = 1;
+    while ((opt = getopt(argc, argv, "t:r:c:fd:")) != -1) {
+        if (opt == 't' && atof(optarg) > 0) {
+            *tickRate = atof(optarg);
+        } else if (opt == 'r' && atoi(optarg) >= 2 && atoi(optarg) <= STARS_MAX_SIZE) {
+            rows = atoi(optarg);
+        } else if (opt == 'c' && atoi(optarg) >= PADDLE_WIDTH && atoi(optarg) <= STARS_MAX_SIZE) {
+            cols = atoi(optarg);
+        } else if (opt == 'f') {
+            fillTerminal = 1;
+        } else if (opt == 'd' && starsModeFind(optarg) >= 0) {
+            mode = starsModeFind(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-t ticks_per_second] [-r rows] [-c cols] [-f] [-d classic|shower|storm]\n",
+                    argv[0]);
+            return NULL;
         }
-
-        dropStar(grid);
-        if (checkCollision(grid)) {
-            score++;
-        }
-        updateGrid(grid);
-        usleep(200000); // Adjust game speed
+    }
+    if (fillTerminal) {
+        // Leave room for the score and help lines
+        terminalSize(&rows, &cols);
+        rows = rows - 3 >= 2 ? rows - 3 : 2;
+        rows = rows <= STARS_MAX_SIZE ? rows : STARS_MAX_SIZE;
+        cols = cols >= PADDLE_WIDTH ? cols : PADDLE_WIDTH;
+        cols = cols <= STARS_MAX_SIZE ? cols : STARS_MAX_SIZE;
     }
 
-    restoreInputMode();
-    printf("\nGame over! Final Score: %d\n", score);
-    return 0;
+    StarsGame* game = malloc(sizeof(StarsGame));
+    if (game == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    initializeStars(game, rows, cols, mode);
+    game->tick_rate = *tickRate;
+    vgcRandomSeed(&game->rng, seed);
+    return game;
 }
 
-void initializeGrid(char grid[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; i++) {
-        for (int j = 0; j < COLS; j++) {
-            grid[i][j] = ' ';
-        }
-    }
-    for (int i = paddle_pos; i < paddle_pos + PADDLE_WIDTH; i++) {
-        grid[ROWS - 1][i] = '=';
-    }
+int starsTick(void* state) {
+    StarsGame* game = state;
+
+    dropStars(game);
+    game->score += updateStars(game);
+    return 1;
 }
 
-void printGrid(char grid[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; i++) {
-        for (int j = 0; j < COLS; j++) {
-            printf("%c", grid[i][j]);
-        }
-        printf("\n");
+int starsInput(void* state, char input) {
+    StarsGame* game = state;
+
+    if (input == 'q') {
+        return 0;
+    } else if (input == 'a' || input == 'd') {
+        movePaddle(game, input);
     }
+    return 1;
 }
 
-void updateGrid(char grid[ROWS][COLS]) {
-    for (int i = ROWS - 2; i >= 0; i--) {
-        for (int j = 0; j < COLS; j++) {
-            grid[i + 1][j] = grid[i][j];
-        }
-    }
-    for (int i = 0; i < COLS; i++) {
-        grid[0][i] = ' ';
-    }
-    for (int i = 0; i < COLS; i++) {
-        grid[ROWS - 1][i] = ' ';
-    }
-    for (int i = paddle_pos; i < paddle_pos + PADDLE_WIDTH; i++) {
-        grid[ROWS - 1][i] = '=';
-    }
+void starsRender(void* state, Renderer* screen) {
+    StarsGame* game = state;
+
+    rendererEnsureSize(screen, game->rows + 2, game->cols > SCREEN_WIDTH ? game->cols : SCREEN_WIDTH);
+    printGrid(game, screen);
+    rendererText(screen, game->rows, 0, "Score: %d", game->score);
+    rendererText(screen, game->rows + 1, 0, "Use 'a' to move left, 'd' to move right, 'q' to quit.");
 }
 
-void movePaddle(char direction) {
-    if (direction == 'a' && paddle_pos > 0) {
-        paddle_pos--;
-    } else if (direction == 'd' && paddle_pos + PADDLE_WIDTH < COLS) {
-        paddle_pos++;
+// The playfield and the speed set with -t
+size_t starsSave(void* state, void* buffer, size_t size) {
+    StarsGame* game = state;
+    size_t needed = sizeof(StarsSave) + starsSnapshotSize(game);
+
+    if (buffer != NULL && size >= needed) {
+        StarsSave* save = buffer;
+        save->tick_rate = game->tick_rate;
+        starsSnapshotWrite(game, save + 1);
     }
+    return needed;
 }
 
-void dropStar(char grid[ROWS][COLS]) {
-    int col = rand() % COLS;
-    grid[0][col] = '*';
-}
+void* starsResume(void* snapshot, size_t size, double* tickRate) {
+    StarsSave* save = snapshot;
 
-int checkCollision(char grid[ROWS][COLS]) {
-    for (int i = paddle_pos; i < paddle_pos + PADDLE_WIDTH; i++) {
-        if (grid[ROWS - 2][i] == '*') {
-            return 1;
-        }
+    if (size < sizeof(StarsSave) || !(save->tick_rate > 0)) {
+        return NULL;
     }
-    return 0;
+    StarsGame* game = malloc(sizeof(StarsGame));
+    if (game == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    if (starsSnapshotRead(game, save + 1, size - sizeof(StarsSave)) == -1) {
+        free(game);
+        return NULL;
+    }
+    game->tick_rate = save->tick_rate;
+    *tickRate = save->tick_rate;
+    return game;
 }
 
-void setInputMode() {
-    struct termios new_termios;
-    tcgetattr(STDIN_FILENO, &original_termios);
-    new_termios = original_termios;
-    new_termios.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
+// Quitting is the only way a game ends
+int starsResult(void* state, int64_t* score) {
+    StarsGame* game = state;
+
+    *score = game->score;
+    return SCORE_QUIT;
 }
 
-void restoreInputMode() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+void starsStop(void* state, char* summary, size_t size) {
+    StarsGame* game = state;
+
+    snprintf(summary, size, "Game over! Final Score: %d", game->score);
+    freeStars(game);
+    free(game);
 }
 
-void signalHandler(int signo) {
-    restoreInputMode();
-    printf("\nGame exited due to signal %d. Goodbye!\n", signo);
-    exit(0);
+void printGrid(StarsGame* game, Renderer* screen) {
+    for (int i = 0; i < game->count; i++) {
+        rendererPut(screen, game->y[i] / STARS_FIXED, game->x[i], starGlyphs[game->type[i]]);
+    }
+    for (int i = game->paddle_pos; i < game->paddle_pos + PADDLE_WIDTH; i++) {
+        rendererPut(screen, game->rows - 1, i, '=');
+    }
 }
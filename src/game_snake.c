@@ -1,225 +1,320 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include <termios.h>
-#include <time.h>
-
-#define ROWS 15
-#define COLS 15
-#define INITIAL_SNAKE_LENGTH 1
-
-// Global terminal settings
-struct termios original_termios;
-
-// Snake structure
+#include "console_runtime.h"
+#include "snake_engine.h"
+#include "snake_autopilot.h"
+
+#define DEFAULT_ROWS 15
+#define DEFAULT_COLS 15
+#define SCREEN_WIDTH 80
+#define TICK_RATE 5.0 // Moves per second
+#define STATE_VERSION 3 // Layout of SnakeSave
+#define TURN_BUFFER 3 // Direction changes remembered between two moves
+
+// Game state
+typedef struct {
+    SnakeGame board;
+    char direction;     // Direction of the next move
+    char turns[TURN_BUFFER]; // Direction changes still to make, one per move
+    int turnCount;
+    int blocked;        // Last move hit the border or the snake; waiting for new input
+    int won;            // The snake fills the whole board
+    int autopilot;      // The snake steers itself until a direction key is pressed
+    SnakeAutopilot pilot;
+    int viewRows, viewCols; // Part of the board shown on the terminal
+    const char* message;
+} Snake;
+
+// Saved game: these fields followed by the board's snapshot
 typedef struct {
-    int row, col;
-} SnakePart;
+    int32_t direction;
+    int32_t blocked;
+    int32_t autopilot;
+    int32_t turn_count;
+    char turns[8];
+} SnakeSave;
 
 // Function prototypes
-void setInputMode();
-void restoreInputMode();
-void initializeGrid(char grid[ROWS][COLS]);
-void printGrid(char grid[ROWS][COLS]);
-void placeBait(char grid[ROWS][COLS], int* baitRow, int* baitCol, SnakePart* snake, int length);
-void updateGrid(char grid[ROWS][COLS], SnakePart* snake, int length, int baitRow, int baitCol);
-int moveSnake(SnakePart* snake, int* length, char direction, int baitRow, int baitCol);
-int checkCollision(SnakePart* snake, int length);
-void waitForNewInput();
-
-int main() {
-    char grid[ROWS][COLS];
-    SnakePart snake[ROWS * COLS]; // Maximum possible length
-    int snakeLength = INITIAL_SNAKE_LENGTH;
-    int baitRow, baitCol;
-    char input = 'd'; // Start moving to the right
-    int running = 1;
-
-    // Initialize terminal
-    setInputMode();
-    atexit(restoreInputMode);
-
-    // Initialize game
-    srand(time(NULL));
-    initializeGrid(grid);
-    snake[0].row = ROWS / 2;
-    snake[0].col = COLS / 2; // Snake starts in the middle
-    placeBait(grid, &baitRow, &baitCol, snake, snakeLength);
-    updateGrid(grid, snake, snakeLength, baitRow, baitCol);
-
-while (running) {
-        system("clear");
-        printGrid(grid);
-        printf("Use 'w', 'a', 's', 'd' to move. Press 'q' to quit.\n");
-
-        usleep(200000); // Adjust game speed
-
-        // Read user input
-        if (read(STDIN_FILENO, &input, 1) > 0) {
-            if (input == 'q') {
-                running = 0; // Exit the game
-                continue;
-            } else if (input != 'w' && input != 'a' && input != 's' && input != 'd') {
-                continue; // Ignore invalid inputs
-            }
-        }
-
-        // Attempt to move the snake
-        if (!moveSnake(snake, &snakeLength, input, baitRow, baitCol)) {
-            printf("\nInvalid move. Snake hit the border or itself. Waiting for new input...\n");
-
-            // Wait for valid input after an invalid move
-            while (1) {
-                if (read(STDIN_FILENO, &input, 1) > 0) {
-                    if (input == 'q') {
-                        running = 0; // Exit on 'q'
-                        break;
-                    } else if (input == 'w' || input == 'a' || input == 's' || input == 'd') {
-                        // Check if the new input is valid and proceed
-                        if (moveSnake(snake, &snakeLength, input, baitRow, baitCol)) {
-                            break; // Valid move found, exit wait loop
-                        } else {
-                            printf("\nInvalid move. Try again.\n");
-                        }
-                    }
-                }
-            }
-
-            if (!running) {
-                break; // Exit the main loop if the game is terminated
-            }
+void* snakeStart(int argc, char* argv[], double* tickRate, uint64_t seed);
+int snakeTick(void* state);
+void snakeRender(void* state, Renderer* screen);
+int snakeInput(void* state, char input);
+void snakeStop(void* state, char* summary, size_t size);
+size_t snakeSave(void* state, void* buffer, size_t size);
+void* snakeResume(void* snapshot, size_t size, double* tickRate);
+int snakeResult(void* state, int64_t* score);
+void setViewSize(Snake* snake);
+void queueTurn(Snake* snake, char input);
+void printGrid(SnakeGame* game, Renderer* screen, int viewRows, int viewCols);
+
+const VgcGame vgc_game = {
+    VGC_PLUGIN_ABI, "Snake", TICK_RATE, "wasd", STATE_VERSION,
+    snakeStart, snakeTick, snakeRender, snakeInput, snakeStop,
+    snakeSave, snakeResume, snakeResult, "wsda",
+    NULL, NULL, NULL, NULL
+};
+
+VGC_GAME_MAIN(vgc_game)
+
+// Parse the board size and set up a new game
+void* snakeStart(int argc, char* argv[], double* tickRate, uint64_t seed) {
+    int rows = DEFAULT_ROWS, cols = DEFAULT_COLS;
+    int autopilot = 0;
+    int opt;
+
+    (void)tickRate;
+    optind = 1;
+    while ((opt = getopt(argc, argv, "r:c:p")) != -1) {
+        if (opt == 'r' && atoi(optarg) > 0) {
+            rows = atoi(optarg);
+        } else if (opt == 'c' && atoi(optarg) > 0) {
+            cols = atoi(optarg);
+        } else if (opt == 'p') {
+            autopilot = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-r rows] [-c cols] [-p]\n", argv[0]);
+            return NULL;
         }
+    }
+    if ((long)rows * cols < 2 || (long)rows * cols > SNAKE_MAX_CELLS) {
+        fprintf(stderr, "The board needs at least two cells and at most %d.\n", SNAKE_MAX_CELLS);
+        fprintf(stderr, "Usage: %s [-r rows] [-c cols] [-p]\n", argv[0]);
+        return NULL;
+    }
 
-        // Update the grid and check for bait
-        updateGrid(grid, snake, snakeLength, baitRow, baitCol);
-
-        // Check if the snake eats the bait
-        if (snake[0].row == baitRow && snake[0].col == baitCol) {
-            snakeLength++;
-            placeBait(grid, &baitRow, &baitCol, snake, snakeLength);
-        }
+    Snake* snake = calloc(1, sizeof(Snake));
+    if (snake == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
     }
 
+    // Snake starts in the middle
+    if (snakeInit(&snake->board, rows, cols) == -1) {
+        perror("Unable to allocate the board");
+        free(snake);
+        return NULL;
+    }
+    if (autopilot && snakeAutopilotInit(&snake->pilot, rows, cols) == -1) {
+        perror("Unable to allocate the autopilot");
+        snakeFree(&snake->board);
+        free(snake);
+        return NULL;
+    }
+    vgcRandomSeed(&snake->board.rng, seed);
+    placeBait(&snake->board);
+    snake->direction = 'd'; // Start moving to the right
+    snake->autopilot = autopilot;
+    setViewSize(snake);
+    return snake;
+}
 
+// Show as much of the board as fits on the terminal
+void setViewSize(Snake* snake) {
+    int rows = snake->board.rows, cols = snake->board.cols;
 
-    printf("\nGame Over. Thank you for playing!\n");
-    return 0;
+    terminalSize(&snake->viewRows, &snake->viewCols);
+    snake->viewRows = rows < snake->viewRows - 4 ? rows : snake->viewRows - 4;
+    snake->viewCols = cols < snake->viewCols / 2 ? cols : snake->viewCols / 2;
+    if (snake->viewRows < 1) snake->viewRows = 1;
+    if (snake->viewCols < 1) snake->viewCols = 1;
 }
 
-// Set terminal input mode for non-canonical input
-void setInputMode() {
-    struct termios new_termios;
-    tcgetattr(STDIN_FILENO, &original_termios);
-    new_termios = original_termios;
-    new_termios.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
-}
+// A finished game is not worth resuming
+size_t snakeSave(void* state, void* buffer, size_t size) {
+    Snake* snake = state;
+    size_t needed = sizeof(SnakeSave) + snakeSnapshotSize(&snake->board);
 
-// Restore terminal settings
-void restoreInputMode() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+    if (snake->won) {
+        return 0;
+    }
+    if (buffer == NULL || size < needed) {
+        return needed;
+    }
+    SnakeSave* save = buffer;
+    save->direction = snake->direction;
+    save->blocked = snake->blocked;
+    save->autopilot = snake->autopilot;
+    save->turn_count = snake->turnCount;
+    memset(save->turns, 0, sizeof(save->turns));
+    memcpy(save->turns, snake->turns, (size_t)snake->turnCount);
+    snakeSnapshotWrite(&snake->board, save + 1);
+    return needed;
 }
 
-// Wait for new valid input after an invalid move
-void waitForNewInput() {
-    char input;
-    while (1) {
-        if (read(STDIN_FILENO, &input, 1) > 0) {
-            if (input == 'w' || input == 'a' || input == 's' || input == 'd') {
-                break; // Exit loop on valid input
-            }
-        }
+void* snakeResume(void* snapshot, size_t size, double* tickRate) {
+    SnakeSave* save = snapshot;
+
+    (void)tickRate;
+    if (size < sizeof(SnakeSave) || save->direction == 0 || strchr("wasd", save->direction) == NULL
+        || save->turn_count < 0 || save->turn_count > TURN_BUFFER) {
+        return NULL;
+    }
+    for (int i = 0; i < save->turn_count; i++) {
+        if (save->turns[i] == 0 || strchr("wasd", save->turns[i]) == NULL) return NULL;
     }
-}
 
-// Initialize the grid with empty spaces
-void initializeGrid(char grid[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; i++) {
-        for (int j = 0; j < COLS; j++) {
-            grid[i][j] = '.';
+    Snake* snake = calloc(1, sizeof(Snake));
+    if (snake == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    if (snakeSnapshotRead(&snake->board, save + 1, size - sizeof(SnakeSave)) == -1) {
+        free(snake);
+        return NULL;
+    }
+    snake->direction = (char)save->direction;
+    snake->turnCount = save->turn_count;
+    memcpy(snake->turns, save->turns, (size_t)save->turn_count);
+    snake->blocked = save->blocked != 0;
+    if (snake->blocked) {
+        snake->message = "Invalid move. Snake hit the border or itself. Waiting for new input...";
+    }
+    if (save->autopilot) {
+        if (snakeAutopilotInit(&snake->pilot, snake->board.rows, snake->board.cols) == -1) {
+            perror("Unable to allocate the autopilot");
+            snakeFree(&snake->board);
+            free(snake);
+            return NULL;
         }
+        snake->autopilot = 1;
     }
+    setViewSize(snake);
+    return snake;
 }
 
-// Print the grid
-void printGrid(char grid[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; i++) {
-        for (int j = 0; j < COLS; j++) {
-            printf("%c ", grid[i][j]);
+// Move the snake one step
+int snakeTick(void* state) {
+    Snake* snake = state;
+
+    if (snake->blocked) {
+        return 1; // Wait for a new direction
+    }
+    if (snake->autopilot) {
+        char key = snakeAutopilotMove(&snake->pilot, &snake->board);
+        if (key == 0) {
+            return 0; // Boxed in
         }
-        printf("\n");
+        snake->direction = key;
+    } else if (snake->turnCount > 0) {
+        snake->direction = snake->turns[0];
+        memmove(snake->turns, snake->turns + 1, (size_t)--snake->turnCount);
     }
-}
 
-// Place bait at a random location
-void placeBait(char grid[ROWS][COLS], int* baitRow, int* baitCol, SnakePart* snake, int length) {
-    int valid = 0;
-    while (!valid) {
-        *baitRow = rand() % ROWS;
-        *baitCol = rand() % COLS;
-        valid = 1;
-        // Ensure bait does not spawn on the snake
-        for (int i = 0; i < length; i++) {
-            if (snake[i].row == *baitRow && snake[i].col == *baitCol) {
-                valid = 0;
-                break;
-            }
-        }
+    int result = moveSnake(&snake->board, snake->direction);
+    if (result == SNAKE_BLOCKED) {
+        snake->blocked = 1;
+        snake->turnCount = 0; // The player picks a new way out
+        snake->message = "Invalid move. Snake hit the border or itself. Waiting for new input...";
+    } else if (result == SNAKE_ATE_BAIT && !placeBait(&snake->board)) {
+        snake->won = 1;
+        return 0;
     }
-    grid[*baitRow][*baitCol] = 'X';
+    return 1;
 }
 
-// Update the grid with the snake and bait
-void updateGrid(char grid[ROWS][COLS], SnakePart* snake, int length, int baitRow, int baitCol) {
-    // Clear the grid
-    initializeGrid(grid);
+int snakeInput(void* state, char input) {
+    Snake* snake = state;
 
-    // Place the bait
-    grid[baitRow][baitCol] = 'X';
+    if (input == 'q') {
+        return 0; // Exit the game
+    } else if (input != 'w' && input != 'a' && input != 's' && input != 'd') {
+        return 1; // Ignore invalid inputs
+    }
 
-    // Place the snake on the grid
-    for (int i = 0; i < length; i++) {
-        if (i == 0) {
-            grid[snake[i].row][snake[i].col] = 'O'; // Snake's head
-        } else {
-            grid[snake[i].row][snake[i].col] = '#'; // Snake's body
-        }
+    if (snake->autopilot) {
+        snake->autopilot = 0; // The player takes over
+        snakeAutopilotFree(&snake->pilot);
+    }
+    if (!snake->blocked) {
+        queueTurn(snake, input);
+        return 1;
     }
-}
 
+    // Check if the new input is valid and proceed
+    snake->direction = input;
+    int result = moveSnake(&snake->board, input);
+    if (result == SNAKE_BLOCKED) {
+        snake->message = "Invalid move. Try again.";
+        return 1;
+    }
+    snake->blocked = 0;
+    snake->message = NULL;
+    if (result == SNAKE_ATE_BAIT && !placeBait(&snake->board)) {
+        snake->won = 1;
+        return 0;
+    }
+    return 1;
+}
 
-// Move the snake
-int moveSnake(SnakePart* snake, int* length, char direction, int baitRow, int baitCol) {
-    SnakePart nextHead = snake[0]; // Calculate the next head position
+// Remember a direction change for the coming moves, so two quick turns
+// between moves both happen instead of the second replacing the first.
+// Repeating the direction already queued changes nothing; when the buffer
+// is full the newest turn replaces the last one.
+void queueTurn(Snake* snake, char input) {
+    char last = snake->turnCount > 0 ? snake->turns[snake->turnCount - 1] : snake->direction;
 
-    // Update the next head position based on the direction
-    switch (direction) {
-        case 'w': nextHead.row--; break;
-        case 'a': nextHead.col--; break;
-        case 's': nextHead.row++; break;
-        case 'd': nextHead.col++; break;
+    if (input == last) {
+        return;
     }
-
-    // Check for border collision
-    if (nextHead.row < 0 || nextHead.row >= ROWS || nextHead.col < 0 || nextHead.col >= COLS) {
-        return 0; // Invalid move
+    if (snake->turnCount == TURN_BUFFER) {
+        snake->turns[TURN_BUFFER - 1] = input;
+    } else {
+        snake->turns[snake->turnCount++] = input;
     }
+}
 
-    // Check for self-collision
-    for (int i = 0; i < *length; i++) {
-        if (nextHead.row == snake[i].row && nextHead.col == snake[i].col) {
-            return 0; // Invalid move
-        }
-    }
+void snakeRender(void* state, Renderer* screen) {
+    Snake* snake = state;
+    int viewRows = snake->viewRows, viewCols = snake->viewCols;
 
-    // Move the snake's body
-    for (int i = *length - 1; i > 0; i--) {
-        snake[i] = snake[i - 1];
+    rendererEnsureSize(screen, viewRows + 3, viewCols * 2 > SCREEN_WIDTH ? viewCols * 2 : SCREEN_WIDTH);
+
+    printGrid(&snake->board, screen, viewRows, viewCols);
+    if (snake->autopilot) {
+        rendererText(screen, viewRows, 0, "Autopilot. Press 'w', 'a', 's' or 'd' to take over, 'q' to quit.");
+    } else {
+        rendererText(screen, viewRows, 0, "Use 'w', 'a', 's', 'd' to move. Press 'q' to quit.");
+    }
+    if (snake->message != NULL) {
+        rendererText(screen, viewRows + 2, 0, "%s", snake->message);
     }
+}
 
-    // Update the snake's head
-    snake[0] = nextHead;
+// The score is the length of the snake
+int snakeResult(void* state, int64_t* score) {
+    Snake* snake = state;
 
-    return 1; // Valid move
+    *score = snake->board.length;
+    return snake->won ? SCORE_WON : SCORE_QUIT;
 }
 
+void snakeStop(void* state, char* summary, size_t size) {
+    Snake* snake = state;
+
+    snprintf(summary, size, "%sGame Over. Thank you for playing!",
+             snake->won ? "The snake filled the board. You win!\n" : "");
+    snakeFree(&snake->board);
+    if (snake->autopilot) snakeAutopilotFree(&snake->pilot);
+    free(snake);
+}
+
+// Print the part of the board around the snake's head that fits on screen
+void printGrid(SnakeGame* game, Renderer* screen, int viewRows, int viewCols) {
+    SnakePart head = snakeHead(game);
+
+    int top = head.row - viewRows / 2;
+    int left = head.col - viewCols / 2;
+    if (top > game->rows - viewRows) top = game->rows - viewRows;
+    if (left > game->cols - viewCols) left = game->cols - viewCols;
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+
+    for (int i = 0; i < viewRows && top + i < game->rows; i++) {
+        const char* line = game->grid + (size_t)(top + i) * game->cols + left;
+        for (int j = 0; j < viewCols; j++) {
+            rendererPut(screen, i, j * 2, line[j]);
+        }
+    }
+}
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "console_runtime.h"
+#include "arena_engine.h"
+#include "work_pool.h"
+
+#define DEFAULT_ROWS 200
+#define DEFAULT_COLS 200
+#define DEFAULT_BOTS 500
+#define DEFAULT_MAX_LENGTH 40
+#define SCREEN_WIDTH 80
+#define TICK_RATE 8.0 // Moves per second
+#define STATE_VERSION 1 // Layout of ArenaSave
+#define MAX_PLAYERS 2 // Snakes 0 .. players - 1 are steered by people, the rest are bots
+
+// Game state
+typedef struct {
+    Arena arena;
+    WorkPool pool;
+    int threads;        // Workers ticking the arena, 1 for none
+    int players;        // Snakes steered by people, 2 for netplay
+    int viewer;         // The snake this terminal follows and steers
+    int viewRows, viewCols; // Part of the board shown on the terminal
+} SnakeArena;
+
+// Saved game: these fields followed by the arena's snapshot
+typedef struct {
+    int32_t threads;
+    int32_t players;    // 0 in saves from before two-player games
+} ArenaSave;
+
+// Function prototypes
+void* arenaStart(int argc, char* argv[], double* tickRate, uint64_t seed);
+int arenaGameTick(void* state);
+void arenaRender(void* state, Renderer* screen);
+int arenaInput(void* state, char input);
+void arenaStop(void* state, char* summary, size_t size);
+size_t arenaSave(void* state, void* buffer, size_t size);
+void* arenaResume(void* snapshot, size_t size, double* tickRate);
+int arenaResult(void* state, int64_t* score);
+void arenaSeat(void* state, int player);
+int arenaPlayerInput(void* state, int player, char input);
+int playersAlive(SnakeArena* game);
+int startThreads(SnakeArena* game, int threads);
+void setViewSize(SnakeArena* game);
+void printArena(Arena* arena, Renderer* screen, int viewer, int viewRows, int viewCols);
+
+const VgcGame vgc_game = {
+    VGC_PLUGIN_ABI, "Snake Arena", TICK_RATE, "wasd", STATE_VERSION,
+    arenaStart, arenaGameTick, arenaRender, arenaInput, arenaStop,
+    arenaSave, arenaResume, arenaResult, "wsda",
+    arenaSeat, arenaPlayerInput, NULL, NULL
+};
+
+VGC_GAME_MAIN(vgc_game)
+
+// Parse the arena size and set up a new game
+void* arenaStart(int argc, char* argv[], double* tickRate, uint64_t seed) {
+    int rows = DEFAULT_ROWS, cols = DEFAULT_COLS;
+    int bots = DEFAULT_BOTS, maxLength = DEFAULT_MAX_LENGTH;
+    int food = -1, threads = 1, players = 1;
+    int opt;
+
+    (void)tickRate;
+    optind = 1;
+    while ((opt = getopt(argc, argv, "r:c:n:l:f:t:p:")) != -1) {
+        if (opt == 'r' && atoi(optarg) > 0) {
+            rows = atoi(optarg);
+        } else if (opt == 'c' && atoi(optarg) > 0) {
+            cols = atoi(optarg);
+        } else if (opt == 'n' && atoi(optarg) >= 0 && atoi(optarg) <= ARENA_MAX_SNAKES) {
+            bots = atoi(optarg);
+        } else if (opt == 'l' && atoi(optarg) > 0) {
+            maxLength = atoi(optarg);
+        } else if (opt == 'f' && atoi(optarg) >= 0) {
+            food = atoi(optarg);
+        } else if (opt == 't' && atoi(optarg) >= 0) {
+            threads = atoi(optarg);
+        } else if (opt == 'p' && atoi(optarg) >= 1 && atoi(optarg) <= MAX_PLAYERS) {
+            players = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-r rows] [-c cols] [-n bots] [-l max_length] [-f food] "
+                    "[-t threads, 0 for every core] [-p players, 2 for netplay]\n", argv[0]);
+            return NULL;
+        }
+    }
+    if (bots + players > ARENA_MAX_SNAKES) {
+        fprintf(stderr, "The arena holds at most %d snakes, bots and players together.\n", ARENA_MAX_SNAKES);
+        fprintf(stderr, "Usage: %s [-r rows] [-c cols] [-n bots] [-l max_length] [-f food] "
+                "[-t threads, 0 for every core] [-p players, 2 for netplay]\n", argv[0]);
+        return NULL;
+    }
+    if ((long)rows * cols > INT32_MAX / 2 || (long)rows * cols < 2L * (bots + players)
+        || (long)(bots + players) * maxLength > INT32_MAX / 2) {
+        fprintf(stderr, "The arena needs at least two cells per snake, at most %d cells and at most %d "
+                "segments over all snakes.\n", INT32_MAX / 2, INT32_MAX / 2);
+        fprintf(stderr, "Usage: %s [-r rows] [-c cols] [-n bots] [-l max_length] [-f food] "
+                "[-t threads, 0 for every core] [-p players, 2 for netplay]\n", argv[0]);
+        return NULL;
+    }
+    if (food < 0) food = rows * cols / 40;
+
+    SnakeArena* game = calloc(1, sizeof(SnakeArena));
+    if (game == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    game->players = players;
+    if (arenaInit(&game->arena, rows, cols, bots + players, players, maxLength) == -1) {
+        perror("Unable to allocate the arena");
+        free(game);
+        return NULL;
+    }
+    vgcRandomSeed(&game->arena.rng, seed);
+    arenaPopulate(&game->arena, food);
+    if (!playersAlive(game) || startThreads(game, threads) == -1) {
+        fprintf(stderr, "Unable to start the arena.\n");
+        arenaFree(&game->arena);
+        free(game);
+        return NULL;
+    }
+    setViewSize(game);
+    return game;
+}
+
+// Tick the arena on 'threads' workers; 1 ticks it on the caller's thread.
+// A two-player game always ticks on the caller's: netplay rolls back by
+// resuming a save, which would start and stop a pool on every misprediction.
+int startThreads(SnakeArena* game, int threads) {
+    game->threads = 1;
+    if (threads == 1 || game->players > 1) return 0;
+    if (workPoolStart(&game->pool, threads) == -1) {
+        workPoolStop(&game->pool);
+        return -1;
+    }
+    game->threads = game->pool.threads;
+    arenaUsePool(&game->arena, &game->pool);
+    return 0;
+}
+
+// Show as much of the arena as fits on the terminal
+void setViewSize(SnakeArena* game) {
+    int rows = game->arena.rows, cols = game->arena.cols;
+
+    terminalSize(&game->viewRows, &game->viewCols);
+    game->viewRows = rows < game->viewRows - 4 ? rows : game->viewRows - 4;
+    game->viewCols = cols < game->viewCols / 2 ? cols : game->viewCols / 2;
+    if (game->viewRows < 1) game->viewRows = 1;
+    if (game->viewCols < 1) game->viewCols = 1;
+}
+
+// A finished game is not worth resuming
+size_t arenaSave(void* state, void* buffer, size_t size) {
+    SnakeArena* game = state;
+    size_t needed = sizeof(ArenaSave) + arenaSnapshotSize(&game->arena);
+
+    if (!playersAlive(game)) {
+        return 0;
+    }
+    if (buffer == NULL || size < needed) {
+        return needed;
+    }
+    ArenaSave* save = buffer;
+    save->threads = game->threads;
+    save->players = game->players;
+    arenaSnapshotWrite(&game->arena, save + 1);
+    return needed;
+}
+
+void* arenaResume(void* snapshot, size_t size, double* tickRate) {
+    ArenaSave* save = snapshot;
+
+    (void)tickRate;
+    if (size < sizeof(ArenaSave) || save->threads < 1 || save->players < 0 || save->players > MAX_PLAYERS) {
+        return NULL;
+    }
+    SnakeArena* game = calloc(1, sizeof(SnakeArena));
+    if (game == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    game->players = save->players > 0 ? save->players : 1;
+    if (arenaSnapshotRead(&game->arena, save + 1, size - sizeof(ArenaSave)) == -1) {
+        free(game);
+        return NULL;
+    }
+    if (game->arena.count < game->players || !playersAlive(game)) {
+        arenaFree(&game->arena);
+        free(game);
+        return NULL;
+    }
+    if (startThreads(game, save->threads) == -1) {
+        arenaFree(&game->arena);
+        free(game);
+        return NULL;
+    }
+    setViewSize(game);
+    return game;
+}
+
+// Are all the players' snakes alive, and none of them a bot?
+int playersAlive(SnakeArena* game) {
+    for (int id = 0; id < game->players; id++) {
+        if (game->arena.snakes[id].bot || !game->arena.snakes[id].alive) return 0;
+    }
+    return 1;
+}
+
+// Move every snake one step; the game ends when a player's snake dies
+int arenaGameTick(void* state) {
+    SnakeArena* game = state;
+
+    arenaTick(&game->arena);
+    return playersAlive(game);
+}
+
+int arenaInput(void* state, char input) {
+    SnakeArena* game = state;
+    return arenaPlayerInput(state, game->viewer, input);
+}
+
+// Netplay: player 0 steers snake 0, player 1 snake 1
+void arenaSeat(void* state, int player) {
+    SnakeArena* game = state;
+    if (player < game->players) game->viewer = player;
+}
+
+int arenaPlayerInput(void* state, int player, char input) {
+    SnakeArena* game = state;
+
+    if (player >= game->players) {
+        return -1;
+    } else if (input == 'q') {
+        return 0; // Exit the game
+    } else if (input == 'w' || input == 'a' || input == 's' || input == 'd') {
+        arenaSteer(&game->arena, player, input);
+    }
+    return 1;
+}
+
+void arenaRender(void* state, Renderer* screen) {
+    SnakeArena* game = state;
+    Arena* arena = &game->arena;
+    int viewRows = game->viewRows, viewCols = game->viewCols;
+    int alive = 0;
+
+    rendererEnsureSize(screen, viewRows + 3, viewCols * 2 > SCREEN_WIDTH ? viewCols * 2 : SCREEN_WIDTH);
+    printArena(arena, screen, game->viewer, viewRows, viewCols);
+    for (int id = 0; id < arena->count; id++) {
+        alive += arena->snakes[id].alive;
+    }
+    rendererText(screen, viewRows, 0, "Length: %d  Eaten: %d  Snakes: %d  Food: %d",
+                 arena->snakes[game->viewer].length, arena->snakes[game->viewer].eaten, alive, arena->food);
+    rendererText(screen, viewRows + 1, 0, "You are O%s. Use 'w', 'a', 's', 'd' to move. Press 'q' to quit.",
+                 game->players > 1 ? ", your rival X" : "");
+}
+
+// The score is the food the player ate; outliving the other player wins
+int arenaResult(void* state, int64_t* score) {
+    SnakeArena* game = state;
+
+    *score = game->arena.snakes[game->viewer].eaten;
+    if (!game->arena.snakes[game->viewer].alive) {
+        return SCORE_LOST;
+    }
+    return playersAlive(game) ? SCORE_QUIT : SCORE_WON;
+}
+
+void arenaStop(void* state, char* summary, size_t size) {
+    SnakeArena* game = state;
+    Arena* arena = &game->arena;
+
+    ArenaSnake* snake = &arena->snakes[game->viewer];
+    snprintf(summary, size, "%sYou ate %d after %llu moves. Game Over. Thank you for playing!",
+             snake->alive ? (playersAlive(game) ? "" : "Your rival crashed!\n") : "Your snake crashed!\n",
+             snake->eaten, (unsigned long long)arena->tick);
+    if (game->threads > 1) workPoolStop(&game->pool);
+    arenaFree(arena);
+    free(game);
+}
+
+// Print the part of the arena around the viewer's head that fits on
+// screen: '@'/'O'/'X' heads, 's'/'#'/'+' bodies of bots/the viewer/other
+// players, '*' food
+void printArena(Arena* arena, Renderer* screen, int viewer, int viewRows, int viewCols) {
+    int head = arenaHeadCell(arena, viewer);
+    int top = head / arena->cols - viewRows / 2;
+    int left = head % arena->cols - viewCols / 2;
+    if (top > arena->rows - viewRows) top = arena->rows - viewRows;
+    if (left > arena->cols - viewCols) left = arena->cols - viewCols;
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+
+    for (int i = 0; i < viewRows && top + i < arena->rows; i++) {
+        const int32_t* line = arena->grid + (size_t)(top + i) * arena->cols + left;
+        for (int j = 0; j < viewCols; j++) {
+            int owner = line[j];
+            char glyph = '.';
+            if (owner == ARENA_FOOD) {
+                glyph = '*';
+            } else if (owner >= 0) {
+                int isHead = arenaHeadCell(arena, owner) == (top + i) * arena->cols + left + j;
+                if (owner == viewer) {
+                    glyph = isHead ? 'O' : '#';
+                } else {
+                    glyph = arena->snakes[owner].bot ? (isHead ? '@' : 's') : (isHead ? 'X' : '+');
+                }
+            }
+            rendererPut(screen, i, j * 2, glyph);
+        }
+    }
+}
@@ -1,127 +1,508 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <unistd.h>
-#include <termios.h>
-#include <signal.h>
+#include "console_runtime.h"
+#include "ttt_engine.h"
+#include "ttt_search.h"
+#include "work_pool.h"
+
+#define SCREEN_WIDTH 80
+#define STATE_VERSION 2 // Layout of TttSave
+#define TOP_LEVEL 10 // Strength with no depth limit
+#define DEFAULT_MOVE_MS 1000
+#define THINK_TICK_RATE 20.0 // How often a game against the computer looks for its move
+
+// Row and column keys; boards up to 15 x 15 need one key per coordinate
+#define COORDINATE_KEYS "123456789abcdef"
+
+// Game state
+typedef struct {
+    TttGame board;
+    int player;         // Whose turn it is
+    int row;            // Row entered so far, -1 while asking for the row
+    int quit;           // Player who pressed 'q', 0 if nobody did
+    const char* error;  // Why the last key was rejected
+    int computer;       // Player the computer plays, 0 for none
+    int seat;           // Player at this terminal in a netplay game, 0 for hot seat
+    int level;          // 1-9 searches that many moves ahead, TOP_LEVEL as far as time allows
+    int moveMs;         // Thinking time per move, 0 for no limit
+    int threads;        // Search threads
+    WorkPool pool;      // Started when threads > 1
+    TttSearch search;
+    TttSearchResult last; // The computer's last move
+    int replaying;      // The computer's moves come from the recording, as keys, not from a search
+    int thinking;       // The computer's search is running; tick() plays its move
+    int thought;        // Atomic: the search has finished with 'next'
+    int joinable;       // The search runs on 'thinker'
+    pthread_t thinker;
+    TttSearchResult next; // What the running search found
+    char played[2];     // The computer's move as row and column keys, for or from the recording
+    int playedCount;
+} TicTacToe;
+
+// Saved game
+typedef struct {
+    int32_t player;
+    int32_t row;
+    int32_t computer;
+    int32_t level;
+    int32_t move_ms;
+    int32_t threads;
+    TttSnapshot board;
+} TttSave;
 
-#define SIZE 3
+// Function prototypes
+void* tttStart(int argc, char* argv[], double* tickRate, uint64_t seed);
+int tttTick(void* state);
+void tttRender(void* state, Renderer* screen);
+int tttInput(void* state, char input);
+void tttStop(void* state, char* summary, size_t size);
+size_t tttSave(void* state, void* buffer, size_t size);
+void* tttResume(void* snapshot, size_t size, double* tickRate);
+int tttResult(void* state, int64_t* score);
+void tttSeat(void* state, int player);
+int tttPlayerInput(void* state, int player, char input);
+size_t tttOwnKeys(void* state, char* keys, size_t size);
+int tttOwnKey(void* state, char key);
+int printBoard(TttGame* game, Renderer* screen, int top);
+int boardHeight(TttGame* game);
+int makeMove(TicTacToe* game, int row, int col);
+int startComputer(TicTacToe* game);
+void computerMove(TicTacToe* game);
+void* think(void* arg);
+int playComputerMove(TicTacToe* game);
+void stopThinking(TicTacToe* game);
+
+const VgcGame vgc_game = {
+    VGC_PLUGIN_ABI, "Tic-Tac-Toe", 0, COORDINATE_KEYS, STATE_VERSION,
+    tttStart, tttTick, tttRender, tttInput, tttStop,
+    tttSave, tttResume, tttResult, NULL,
+    tttSeat, tttPlayerInput, tttOwnKeys, tttOwnKey
+};
+
+VGC_GAME_MAIN(vgc_game)
+
+void* tttStart(int argc, char* argv[], double* tickRate, uint64_t seed) {
+    int size = 3, k = 3; // Classic tic-tac-toe
+    int computer = 0, level = TOP_LEVEL, moveMs = DEFAULT_MOVE_MS, threads = 0;
+    int opt;
+
+    (void)seed; // Nothing random in tic-tac-toe
+    optind = 1;
+    while ((opt = getopt(argc, argv, "p:n:k:c:l:m:t:")) != -1) {
+        if (opt == 'p' && strcmp(optarg, "classic") == 0) {
+            size = 3;
+            k = 3;
+        } else if (opt == 'p' && strcmp(optarg, "gomoku") == 0) {
+            size = 15;
+            k = 5;
+        } else if (opt == 'n') {
+            size = atoi(optarg);
+        } else if (opt == 'k') {
+            k = atoi(optarg);
+        } else if (opt == 'c' && (strcmp(optarg, "x") == 0 || strcmp(optarg, "o") == 0)) {
+            computer = optarg[0] == 'x' ? 1 : 2;
+        } else if (opt == 'l' && atoi(optarg) >= 1 && atoi(optarg) <= TOP_LEVEL) {
+            level = atoi(optarg);
+        } else if (opt == 'm' && atoi(optarg) >= 0) {
+            moveMs = atoi(optarg);
+        } else if (opt == 't' && atoi(optarg) >= 0) {
+            threads = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-p classic|gomoku] [-n size] [-k in_a_row] [-c x|o] [-l level 1-%d] "
+                    "[-m move_ms] [-t threads]\n", argv[0], TOP_LEVEL);
+            return NULL;
+        }
+    }
+
+    TicTacToe* game = calloc(1, sizeof(TicTacToe));
+    if (game == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    if (tttInit(&game->board, size, k) == -1) {
+        fprintf(stderr, "The board must be 1-%d cells wide and k between 1 and the board size.\n", TTT_MAX_SIZE);
+        free(game);
+        return NULL;
+    }
+    game->player = 1; // Player 1 starts
+    game->row = -1;
+    game->computer = computer;
+    game->level = level;
+    game->moveMs = moveMs;
+    game->threads = threads;
+    game->last.cell = -1;
+    game->replaying = getenv(VGC_REPLAY) != NULL;
+    if (startComputer(game) == -1) {
+        tttFree(&game->board);
+        free(game);
+        return NULL;
+    }
+    if (computer != 0) *tickRate = THINK_TICK_RATE;
+    if (game->computer == game->player) computerMove(game);
+    return game;
+}
 
-// Global terminal settings
-struct termios original_termios;
+// Set up the computer's search on 'threads' threads, 0 for every core
+int startComputer(TicTacToe* game) {
+    WorkPool* pool = NULL;
 
-// Function prototypes
-void setInputMode();
-void restoreInputMode();
-void signalHandler(int signo);
-void initializeBoard(char board[SIZE][SIZE]);
-void printBoard(char board[SIZE][SIZE]);
-int checkWin(char board[SIZE][SIZE]);
-int isDraw(char board[SIZE][SIZE]);
-void makeMove(char board[SIZE][SIZE], int player);
-
-int main() {
-    char board[SIZE][SIZE];
-    int player = 1; // Player 1 starts
-    int running = 1;
-
-    setInputMode(); // Set non-canonical input mode
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
-
-    initializeBoard(board);
-
-    while (running) {
-        system("clear");
-        printf("Tic-Tac-Toe\n");
-        printf("Player 1: X | Player 2: O\n");
-        printf("Press 'q' to quit at any time.\n\n");
-        printBoard(board);
-
-        if (checkWin(board)) {
-            printf("Player %d wins!\n", player == 1 ? 2 : 1);
-            break;
-        } else if (isDraw(board)) {
-            printf("It's a draw!\n");
-            break;
+    if (game->computer == 0) return 0;
+    if (game->threads != 1) {
+        if (workPoolStart(&game->pool, game->threads) == -1) {
+            perror("Unable to start the search threads");
+            workPoolStop(&game->pool);
+            return -1;
         }
+        pool = &game->pool;
+    }
+    tttSearchInit(&game->search, TTT_TABLE_BITS, pool);
+    game->threads = game->search.workers;
+    return 0;
+}
+
+// Start the computer's search; tick() plays the move it finds. A replay
+// searches nothing: the recorded move arrives as keys.
+void computerMove(TicTacToe* game) {
+    game->thought = 0;
+    game->thinking = 1;
+    if (game->replaying) return;
+    game->joinable = pthread_create(&game->thinker, NULL, think, game) == 0;
+    if (!game->joinable) think(game); // Search on this thread instead
+}
 
-        printf("Player %d's turn.\n", player);
-        makeMove(board, player);
+// The search, on its own thread so that the game keeps drawing and hears 'q'
+void* think(void* arg) {
+    TicTacToe* game = arg;
+    int depth = game->level < TOP_LEVEL ? game->level : 0;
 
-        player = (player == 1) ? 2 : 1; // Switch player
+    tttSearchMove(&game->search, &game->board, game->player, depth, (uint64_t)game->moveMs * 1000000, &game->next);
+    __atomic_store_n(&game->thought, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Play the finished search's move, and keep it for the recording; returns
+// 0 once the game is over
+int playComputerMove(TicTacToe* game) {
+    TttGame* board = &game->board;
+
+    if (game->joinable) pthread_join(game->thinker, NULL);
+    game->thinking = 0;
+    game->joinable = 0;
+    game->last = game->next;
+    if (game->last.cell < 0) return 0;
+    if (!game->replaying) {
+        game->played[0] = COORDINATE_KEYS[game->last.cell / board->size];
+        game->played[1] = COORDINATE_KEYS[game->last.cell % board->size];
+        game->playedCount = 2;
+    }
+    tttPlay(board, game->player, game->last.cell);
+    if (checkWin(board) || isDraw(board)) {
+        return 0;
     }
+    game->player = (game->player == 1) ? 2 : 1;
+    return 1;
+}
 
-    restoreInputMode(); // Restore terminal settings
-    printf("\nGame Over. Thank you for playing!\n");
-    return 0;
+// Abandon the search, e.g. when the player quits
+void stopThinking(TicTacToe* game) {
+    if (!game->thinking) return;
+    tttSearchCancel(&game->search);
+    if (game->joinable) pthread_join(game->thinker, NULL);
+    game->thinking = 0;
+    game->joinable = 0;
 }
 
+// Turns advance on input; against the computer, ticks also pick up its move
+// once the search has finished
+int tttTick(void* state) {
+    TicTacToe* game = state;
 
-// Set terminal input mode for non-canonical input
-void setInputMode() {
-    struct termios new_termios;
-    tcgetattr(STDIN_FILENO, &original_termios);
-    new_termios = original_termios;
-    new_termios.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
+    if (!game->thinking || !__atomic_load_n(&game->thought, __ATOMIC_ACQUIRE)) {
+        return 1;
+    }
+    return playComputerMove(game);
 }
 
-// Restore terminal settings
-void restoreInputMode() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+// The computer's move, recorded at the tick it was played so that a replay
+// plays it there too
+size_t tttOwnKeys(void* state, char* keys, size_t size) {
+    TicTacToe* game = state;
+    size_t count = (size_t)game->playedCount < size ? (size_t)game->playedCount : size;
+
+    memcpy(keys, game->played, count);
+    game->playedCount = 0;
+    return count;
 }
 
-// Signal handler for graceful exit
-void signalHandler(int signo) {
-    restoreInputMode();
-    printf("\nGame exited due to signal %d. Goodbye!\n", signo);
-    exit(0);
+// Replay: the computer's recorded move, row key then column key
+int tttOwnKey(void* state, char key) {
+    TicTacToe* game = state;
+    int size = game->board.size;
+
+    if (!game->thinking) return 1; // Not the computer's turn: the recording does not fit
+    game->played[game->playedCount++] = key;
+    if (game->playedCount < 2) return 1;
+
+    const char* row = strchr(COORDINATE_KEYS, game->played[0]);
+    const char* col = strchr(COORDINATE_KEYS, game->played[1]);
+    game->playedCount = 0;
+    if (row == NULL || col == NULL || row - COORDINATE_KEYS >= size || col - COORDINATE_KEYS >= size
+        || !tttIsEmpty(&game->board, (int)(row - COORDINATE_KEYS) * size + (int)(col - COORDINATE_KEYS))) {
+        return 1;
+    }
+    memset(&game->next, 0, sizeof(game->next));
+    game->next.cell = (int)(row - COORDINATE_KEYS) * size + (int)(col - COORDINATE_KEYS);
+    return playComputerMove(game);
 }
 
-// Initialize the board with empty spaces
-void initializeBoard(char board[SIZE][SIZE]) {
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            board[i][j] = ' ';
-        }
+int tttInput(void* state, char input) {
+    TicTacToe* game = state;
+    int size = game->board.size;
+
+    if (input == 'q' || input == 'Q') {
+        game->quit = game->thinking ? 3 - game->computer : game->player;
+        stopThinking(game);
+        return 0;
+    }
+    if (game->thinking) {
+        game->error = "The computer is thinking. Wait for its move.";
+        return 1;
+    }
+
+    const char* key = strchr(COORDINATE_KEYS, input);
+    if (input == '\0' || key == NULL || key - COORDINATE_KEYS >= size) {
+        game->error = game->row == -1 ? "Invalid input. Row must be between 1 and %c. Try again."
+                                      : "Invalid input. Column must be between 1 and %c. Try again.";
+        return 1;
+    }
+
+    game->error = NULL;
+    if (game->row == -1) {
+        game->row = (int)(key - COORDINATE_KEYS);
+        return 1;
     }
+
+    int row = game->row;
+    game->row = -1;
+    return makeMove(game, row, (int)(key - COORDINATE_KEYS));
 }
 
-// Print the board
-void printBoard(char board[SIZE][SIZE]) {
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            printf(" %c ", board[i][j]);
-            if (j < SIZE - 1) printf("|");
-        }
-        printf("\n");
-        if (i < SIZE - 1) printf("---+---+---\n");
+// Netplay: player 0 plays X, player 1 plays O
+void tttSeat(void* state, int player) {
+    TicTacToe* game = state;
+    game->seat = player + 1;
+}
+
+// Either player may quit; only the one whose turn it is may move, and
+// nobody plays against the computer over the network
+int tttPlayerInput(void* state, int player, char input) {
+    TicTacToe* game = state;
+
+    if (input == 'q' || input == 'Q') {
+        game->quit = player + 1;
+        stopThinking(game);
+        return 0;
     }
-    printf("\n");
+    if (game->computer != 0 || game->player != player + 1) {
+        return -1;
+    }
+    return tttInput(state, input);
 }
 
-// Check if a player has won
-int checkWin(char board[SIZE][SIZE]) {
-    // Check rows and columns
-    for (int i = 0; i < SIZE; i++) {
-        if (board[i][0] != ' ' && board[i][0] == board[i][1] && board[i][1] == board[i][2]) return 1;
-        if (board[0][i] != ' ' && board[0][i] == board[1][i] && board[1][i] == board[2][i]) return 1;
+void tttRender(void* state, Renderer* screen) {
+    TicTacToe* game = state;
+    TttGame* board = &game->board;
+    char symbol = (game->player == 1) ? 'X' : 'O';
+    char last = COORDINATE_KEYS[board->size - 1];
+
+    rendererEnsureSize(screen, boardHeight(board) + 10, SCREEN_WIDTH);
+    if (board->size == 3 && board->k == 3) {
+        rendererText(screen, 0, 0, "Tic-Tac-Toe");
+    } else {
+        rendererText(screen, 0, 0, "%dx%d, %d in a row", board->size, board->size, board->k);
+    }
+    rendererText(screen, 1, 0, "Player 1: X%s | Player 2: O%s",
+                 game->computer == 1 ? " (computer)" : game->seat == 1 ? " (you)" : "",
+                 game->computer == 2 ? " (computer)" : game->seat == 2 ? " (you)" : "");
+    if (game->computer != 0 && game->last.cell >= 0 && board->moves > 0 && game->last.nodes == 0) {
+        rendererText(screen, 3, 0, "Computer played %c %c", // Replayed from the recording
+                     COORDINATE_KEYS[game->last.cell / board->size], COORDINATE_KEYS[game->last.cell % board->size]);
+    } else if (game->computer != 0 && game->last.cell >= 0 && board->moves > 0) {
+        rendererText(screen, 3, 0, "Computer played %c %c: %d moves ahead, %llu positions in %llu ms",
+                     COORDINATE_KEYS[game->last.cell / board->size], COORDINATE_KEYS[game->last.cell % board->size],
+                     game->last.depth, (unsigned long long)game->last.nodes,
+                     (unsigned long long)(game->last.ns / 1000000));
+    }
+    rendererText(screen, 2, 0, "Press 'q' to quit at any time.");
+    int row = printBoard(board, screen, 4);
+
+    if (checkWin(board)) {
+        rendererText(screen, row, 0, "Player %d wins!", board->winner);
+        return;
+    } else if (isDraw(board)) {
+        rendererText(screen, row, 0, "It's a draw!");
+        return;
+    } else if (game->quit) {
+        rendererText(screen, row, 0, "Player %d has quit the game. Goodbye!", game->quit);
+        return;
     }
-    // Check diagonals
-    if (board[0][0] != ' ' && board[0][0] == board[1][1] && board[1][1] == board[2][2]) return 1;
-    if (board[0][2] != ' ' && board[0][2] == board[1][1] && board[1][1] == board[2][0]) return 1;
 
-    return 0;
+    if (game->thinking) {
+        rendererText(screen, row, 0, "The computer is thinking (%c)...", symbol);
+        return;
+    } else if (game->seat == 0) {
+        rendererText(screen, row, 0, "Player %d's turn (%c).", game->player, symbol);
+    } else if (game->seat == game->player) {
+        rendererText(screen, row, 0, "Your turn (%c).", symbol);
+    } else {
+        rendererText(screen, row, 0, "Waiting for player %d (%c)...", game->player, symbol);
+        return;
+    }
+    if (game->row == -1) {
+        rendererText(screen, row + 1, 0, "Enter row (1-%c): ", last);
+    } else {
+        rendererText(screen, row + 1, 0, "Enter column (1-%c): ", last);
+    }
+    if (game->error != NULL) {
+        rendererText(screen, row + 3, 0, game->error, last);
+    }
 }
 
-// Check if the game is a draw
-int isDraw(char board[SIZE][SIZE]) {
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            if (board[i][j] == ' ') return 0;
+// A win scores the cells left empty, so quicker wins rank higher; draws,
+// losses to the computer and abandoned games go into the match history
+// with no score
+int tttResult(void* state, int64_t* score) {
+    TicTacToe* game = state;
+    TttGame* board = &game->board;
+
+    *score = 0;
+    if (checkWin(board) && board->winner == game->computer) {
+        return SCORE_LOST;
+    } else if (checkWin(board)) {
+        *score = board->cells - board->moves + 1;
+        return SCORE_WON;
+    } else if (isDraw(board)) {
+        return SCORE_DRAW;
+    }
+    return board->moves > 0 ? SCORE_QUIT : SCORE_NONE;
+}
+
+void tttStop(void* state, char* summary, size_t size) {
+    TicTacToe* game = state;
+
+    snprintf(summary, size, "Game Over. Thank you for playing!");
+    stopThinking(game);
+    if (game->computer != 0) {
+        tttSearchFree(&game->search);
+        if (game->threads > 1) workPoolStop(&game->pool);
+    }
+    tttFree(&game->board);
+    free(game);
+}
+
+// A decided game is not worth resuming
+size_t tttSave(void* state, void* buffer, size_t size) {
+    TicTacToe* game = state;
+
+    if (checkWin(&game->board) || isDraw(&game->board)) {
+        return 0;
+    }
+    if (buffer != NULL && size >= sizeof(TttSave)) {
+        TttSave* save = buffer;
+        save->player = game->player;
+        save->row = game->row;
+        save->computer = game->computer;
+        save->level = game->level;
+        save->move_ms = game->moveMs;
+        save->threads = game->threads;
+        tttSnapshotWrite(&game->board, &save->board);
+    }
+    return sizeof(TttSave);
+}
+
+void* tttResume(void* snapshot, size_t size, double* tickRate) {
+    TttSave* save = snapshot;
+
+    if (size != sizeof(TttSave) || (save->player != 1 && save->player != 2)
+        || save->row < -1 || save->row >= save->board.size || save->computer < 0 || save->computer > 2
+        || save->level < 1 || save->level > TOP_LEVEL || save->move_ms < 0 || save->threads < 0) {
+        return NULL;
+    }
+
+    TicTacToe* game = calloc(1, sizeof(TicTacToe));
+    if (game == NULL) {
+        perror("Unable to allocate the game");
+        return NULL;
+    }
+    if (tttSnapshotRead(&game->board, &save->board) == -1) {
+        free(game);
+        return NULL;
+    }
+    game->player = save->player;
+    game->row = save->row;
+    game->computer = save->computer;
+    game->level = save->level;
+    game->moveMs = save->move_ms;
+    game->threads = save->threads;
+    if (startComputer(game) == -1) {
+        tttFree(&game->board);
+        free(game);
+        return NULL;
+    }
+    game->last.cell = -1;
+    if (game->computer != 0) *tickRate = THINK_TICK_RATE;
+    if (game->computer == game->player) computerMove(game);
+    return game;
+}
+
+// Screen rows taken by the board, including its labels and separators
+int boardHeight(TttGame* game) {
+    int labels = game->size > 3;
+    int separators = game->size <= 5;
+    return labels + game->size + (separators ? game->size - 1 : 0);
+}
+
+// Print the board starting at screen row 'top'; returns the first row below it.
+// Boards larger than 3x3 get coordinate labels, and boards larger than 5x5
+// drop the separator lines so they fit on the screen.
+int printBoard(TttGame* game, Renderer* screen, int top) {
+    int size = game->size;
+    int labels = size > 3;
+    int separators = size <= 5;
+    int width = separators ? 4 : 2;
+    int left = labels ? 2 : 0;
+    int row = top;
+
+    if (labels) {
+        for (int j = 0; j < size; j++) {
+            rendererPut(screen, row, left + j * width + width / 2, COORDINATE_KEYS[j]);
         }
+        row++;
     }
-    return 1;
+
+    for (int i = 0; i < size; i++) {
+        if (labels) rendererPut(screen, row, 0, COORDINATE_KEYS[i]);
+        for (int j = 0; j < size; j++) {
+            char symbol = tttSymbol(game, i * size + j);
+            if (separators) {
+                rendererText(screen, row, left + j * 4, " %c ", symbol);
+                if (j < size - 1) rendererPut(screen, row, left + j * 4 + 3, '|');
+            } else {
+                rendererPut(screen, row, left + j * 2 + 1, symbol == ' ' ? '.' : symbol);
+            }
+        }
+        row++;
+        if (separators && i < size - 1) {
+            for (int j = 0; j < size; j++) {
+                rendererText(screen, row, left + j * 4, j < size - 1 ? "---+" : "---");
+            }
+            row++;
+        }
+    }
+    return row + 1;
 }
 
 // Allow a player to make a move
@@ -167,68 +548,24 @@ int isDraw(char board[SIZE][SIZE]) {
 
 
 
-void makeMove(char board[SIZE][SIZE], int player) {
-    int row = -1, col = -1;
-    char symbol = (player == 1) ? 'X' : 'O';
-    char input;
-
-    while (1) {
-        system("clear");
-        printBoard(board);
-        printf("Player %d's turn (%c). Press 'q' to quit.\n", player, symbol);
-
-        // Prompt for row
-        printf("Enter row (1-3): ");
-        fflush(stdout);
-
-        if (read(STDIN_FILENO, &input, 1) == 1) {
-            if (input == 'q' || input == 'Q') {
-                printf("\nPlayer %d has quit the game. Goodbye!\n", player);
-                restoreInputMode(); // Restore terminal settings
-                exit(0);
-            }
-
-            if (input >= '1' && input <= '3') {
-                row = input - '1'; // Convert to 0-based index
-            } else {
-                printf("\nInvalid input. Row must be between 1 and 3. Try again.\n");
-                sleep(1); // Wait briefly before retrying
-                continue;
-            }
-        }
+// Place the current player's stone; returns 0 once the game is over
+int makeMove(TicTacToe* game, int row, int col) {
+    TttGame* board = &game->board;
 
-        // Prompt for column
-        system("clear");
-        printBoard(board);
-        printf("Player %d's turn (%c). Press 'q' to quit.\n", player, symbol);
-        printf("Enter column (1-3): ");
-        fflush(stdout);
-
-        if (read(STDIN_FILENO, &input, 1) == 1) {
-            if (input == 'q' || input == 'Q') {
-                printf("\nPlayer %d has quit the game. Goodbye!\n", player);
-                restoreInputMode(); // Restore terminal settings
-                exit(0);
-            }
-
-            if (input >= '1' && input <= '3') {
-                col = input - '1'; // Convert to 0-based index
-            } else {
-                printf("\nInvalid input. Column must be between 1 and 3. Try again.\n");
-                sleep(1); // Wait briefly before retrying
-                continue;
-            }
-        }
+    // Validate move
+    int cell = row * board->size + col;
+    if (!tttIsEmpty(board, cell)) {
+        game->error = "Invalid move. Cell is already occupied. Try again.";
+        return 1;
+    }
 
-        // Validate move
-        if (board[row][col] == ' ') {
-            board[row][col] = symbol;
-            break; // Exit loop when move is valid
-        } else {
-            printf("\nInvalid move. Cell is already occupied. Try again.\n");
-            sleep(1); // Wait briefly before retrying
-        }
+    tttPlay(board, game->player, cell);
+    if (checkWin(board) || isDraw(board)) {
+        return 0;
+    }
+    game->player = (game->player == 1) ? 2 : 1; // Switch player
+    if (game->player == game->computer) {
+        computerMove(game);
     }
+    return 1;
 }
-
-
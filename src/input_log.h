@@ -0,0 +1,187 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// Compact binary recording of a game session: everything needed to play it
+// again exactly.
+//
+//   header     InputLogHeader: game, seed, tick rate, argument count and size
+//   arguments  the game's own arguments, NUL-terminated, back to back
+//   events     one per key: varint(ticks since the previous event), key byte;
+//              a key the game played by itself (VgcGame.own_keys) is a 0
+//              byte followed by the key
+//   end        varint(ticks since the previous event), 0, 0
+//
+// Keys are stamped with the number of ticks the game had run when the key
+// was handled, so a replay feeds every key between the same two ticks as the
+// original session. With the game's PRNG seeded from the header that
+// reproduces the session bit for bit. Most events take two bytes. Version 1
+// logs have no own keys and end in a single 0.
+
+#define INPUT_LOG_MAGIC "VLOG"
+#define INPUT_LOG_VERSION 2
+#define INPUT_LOG_MAX_ARGS 16
+#define INPUT_LOG_ARG_BYTES 512
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    double tick_rate;       // Ticks per second the session ran at
+    char game[32];          // VgcGame name, checked on replay
+    uint32_t arg_count;
+    uint32_t arg_bytes;
+} InputLogHeader;
+
+typedef struct {
+    FILE* file;
+    InputLogHeader header;
+    char args[INPUT_LOG_ARG_BYTES];
+    char* argv[INPUT_LOG_MAX_ARGS + 2];  // Program name, arguments, NULL
+    int argc;
+    uint64_t tick;          // Stamp of the last event written or read
+    // Reading: the event just read
+    int status;             // 1 key pending, 0 end reached, -1 log cut short
+    uint64_t next_tick;     // Stamp of the pending key, or the final tick
+    char next_key;
+    int next_own;           // The pending key is one the game played by itself
+} InputLog;
+
+static inline void inputLogPutVarint(FILE* file, uint64_t value) {
+    while (value >= 0x80) {
+        putc((int)(value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    putc((int)value, file);
+}
+
+static inline int inputLogGetVarint(FILE* file, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = getc(file);
+        if (c == EOF) return -1;
+        *value |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return 0;
+    }
+    return -1;
+}
+
+// Start recording a session of 'game' (its own arguments only, without the
+// program name) to 'path'; returns -1 on failure
+static inline int inputLogCreate(InputLog* log, const char* path, const char* game,
+                                 uint64_t seed, double tickRate, int argc, char* argv[]) {
+    memset(log, 0, sizeof(*log));
+    memcpy(log->header.magic, INPUT_LOG_MAGIC, 4);
+    log->header.version = INPUT_LOG_VERSION;
+    log->header.seed = seed;
+    log->header.tick_rate = tickRate;
+    snprintf(log->header.game, sizeof(log->header.game), "%s", game);
+
+    for (int i = 0; i < argc && i < INPUT_LOG_MAX_ARGS; i++) {
+        size_t length = strlen(argv[i]) + 1;
+        if (log->header.arg_bytes + length > INPUT_LOG_ARG_BYTES) break;
+        memcpy(log->args + log->header.arg_bytes, argv[i], length);
+        log->header.arg_bytes += (uint32_t)length;
+        log->header.arg_count++;
+    }
+
+    log->file = fopen(path, "wb");
+    if (log->file == NULL) {
+        return -1;
+    }
+    fwrite(&log->header, sizeof(log->header), 1, log->file);
+    fwrite(log->args, 1, log->header.arg_bytes, log->file);
+    return 0;
+}
+
+static inline void inputLogKey(InputLog* log, uint64_t tick, char key) {
+    if (key == '\0') return; // Reserved for the end marker
+    inputLogPutVarint(log->file, tick - log->tick);
+    putc((unsigned char)key, log->file);
+    log->tick = tick;
+}
+
+// A key the game played by itself
+static inline void inputLogOwnKey(InputLog* log, uint64_t tick, char key) {
+    if (key == '\0') return; // Reserved for the end marker
+    inputLogPutVarint(log->file, tick - log->tick);
+    putc(0, log->file);
+    putc((unsigned char)key, log->file);
+    log->tick = tick;
+}
+
+// Write the end marker with the session's final tick count and close the log
+static inline void inputLogFinish(InputLog* log, uint64_t tick) {
+    if (log->file == NULL) return;
+    inputLogPutVarint(log->file, tick - log->tick);
+    putc(0, log->file);
+    putc(0, log->file);
+    fclose(log->file);
+    log->file = NULL;
+}
+
+static inline void inputLogClose(InputLog* log) {
+    if (log->file != NULL) fclose(log->file);
+    log->file = NULL;
+}
+
+// Read the next event into 'status', 'next_tick', 'next_key' and 'next_own'
+static inline void inputLogNext(InputLog* log) {
+    uint64_t delta;
+    int key, own = 0;
+
+    if (log->status != 1) return;
+    if (inputLogGetVarint(log->file, &delta) == -1 || (key = getc(log->file)) == EOF
+        || (key == 0 && log->header.version >= 2 && (own = 1, key = getc(log->file)) == EOF)) {
+        log->status = -1; // Cut short, e.g. the recording process was killed
+        log->next_tick = log->tick;
+        return;
+    }
+    log->tick += delta;
+    log->next_tick = log->tick;
+    log->next_key = (char)key;
+    log->next_own = own;
+    if (key == 0) log->status = 0;
+}
+
+// Open a recording for replay and read its first event; returns -1 (after
+// printing why) if it cannot be used
+static inline int inputLogOpen(InputLog* log, const char* path) {
+    memset(log, 0, sizeof(*log));
+    log->file = fopen(path, "rb");
+    if (log->file == NULL) {
+        perror("Unable to open the recording");
+        return -1;
+    }
+    if (fread(&log->header, sizeof(log->header), 1, log->file) != 1
+        || memcmp(log->header.magic, INPUT_LOG_MAGIC, 4) != 0
+        || log->header.version < 1 || log->header.version > INPUT_LOG_VERSION
+        || log->header.arg_bytes > INPUT_LOG_ARG_BYTES
+        || log->header.arg_count > INPUT_LOG_MAX_ARGS
+        || fread(log->args, 1, log->header.arg_bytes, log->file) != log->header.arg_bytes) {
+        fprintf(stderr, "%s is not a recording this version can play.\n", path);
+        inputLogClose(log);
+        return -1;
+    }
+    log->header.game[sizeof(log->header.game) - 1] = '\0';
+
+    // Rebuild the argument vector the game was started with
+    log->argv[log->argc++] = log->header.game;
+    char* arg = log->args;
+    for (uint32_t i = 0; i < log->header.arg_count; i++) {
+        char* end = memchr(arg, '\0', log->args + log->header.arg_bytes - arg);
+        if (end == NULL) break;
+        log->argv[log->argc++] = arg;
+        arg = end + 1;
+    }
+    log->argv[log->argc] = NULL;
+
+    log->status = 1;
+    inputLogNext(log);
+    return 0;
+}
+
+#endif
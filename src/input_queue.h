@@ -0,0 +1,164 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Terminal input decoding shared by the console, the games and the arcade.
+//
+// The event loops read every byte that is waiting (see tickLoopWait()) and
+// feed them here. The parser turns them into key events:
+//
+// - Escape sequences (CSI "ESC [ ... final" and SS3 "ESC O final") are
+//   recognised as a whole, also when a read splits them. Arrow keys become
+//   the keys the game maps them to (VgcGame.arrows); every other sequence
+//   (function keys, modified arrows the game has no use for, mouse reports)
+//   is swallowed instead of arriving as stray letters.
+// - A lone ESC is only known to be one when nothing follows it in time, so
+//   it is held back for INPUT_ESCAPE_NS; inputFlush() then delivers it.
+// - Auto-repeat of a direction key that piled up while a real-time game was
+//   busy would replay late. A queue given the keys to coalesce folds a
+//   press of one of them into the newest event when that is the same key,
+//   still waiting and less than INPUT_REPEAT_NS older; the event counts
+//   the presses folded into it. Other keys, and every key of a queue
+//   without coalesce keys, arrive one event per press.
+//
+// Events carry the time their bytes were read and wait in a fixed ring
+// until the loop hands them to the game; a full ring drops the oldest.
+
+#define INPUT_QUEUE_SIZE 64       // Events; a power of two
+#define INPUT_ESCAPE_NS 25000000ull
+#define INPUT_REPEAT_NS 50000000ull // Longer than one auto-repeat interval
+#define INPUT_KEY_ESCAPE '\033'
+
+typedef struct {
+    uint64_t time_ns;             // When the key's bytes were read
+    char key;
+    uint16_t repeats;             // Copies folded into this event
+} InputEvent;
+
+typedef struct {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    unsigned head, count;
+    unsigned long keys;           // Keys queued, repeats included
+    unsigned long coalesced;      // Repeats folded into an earlier event
+    unsigned long sequences;      // Escape sequences decoded
+    unsigned long dropped;        // Events lost to a full ring
+    const char* coalesce;         // Keys whose repeats fold together; NULL for none
+} InputQueue;
+
+enum { INPUT_PLAIN, INPUT_ESCAPE, INPUT_CSI, INPUT_SS3 };
+
+typedef struct {
+    const char* arrows;           // Keys for up, down, right, left; '.' or NULL ignores
+    int state;                    // INPUT_*: how far into an escape sequence
+    uint64_t escape_ns;           // When the pending ESC was read
+} InputParser;
+
+static inline void inputQueueInit(InputQueue* queue) {
+    memset(queue, 0, sizeof(*queue));
+}
+
+// Fold repeats of the keys in 'keys' (a game's arrows: the directions of a
+// real-time game); NULL or "" folds none
+static inline void inputQueueCoalesce(InputQueue* queue, const char* keys) {
+    queue->coalesce = keys;
+}
+
+static inline void inputParserInit(InputParser* parser, const char* arrows) {
+    parser->arrows = arrows;
+    parser->state = INPUT_PLAIN;
+    parser->escape_ns = 0;
+}
+
+// Queue 'key', folding it into the newest event when it is a coalesce key
+// repeated within INPUT_REPEAT_NS
+static inline void inputQueuePush(InputQueue* queue, char key, uint64_t now) {
+    queue->keys++;
+    if (queue->count > 0 && queue->coalesce != NULL && key != '.' && key != '\0'
+        && strchr(queue->coalesce, key) != NULL) {
+        InputEvent* last = &queue->events[(queue->head + queue->count - 1) & (INPUT_QUEUE_SIZE - 1)];
+        if (last->key == key && now - last->time_ns < INPUT_REPEAT_NS && last->repeats < UINT16_MAX) {
+            last->repeats++;
+            queue->coalesced++;
+            return;
+        }
+    }
+    if (queue->count == INPUT_QUEUE_SIZE) {
+        queue->head = (queue->head + 1) & (INPUT_QUEUE_SIZE - 1);
+        queue->count--;
+        queue->dropped++;
+    }
+    InputEvent* event = &queue->events[(queue->head + queue->count++) & (INPUT_QUEUE_SIZE - 1)];
+    event->time_ns = now;
+    event->key = key;
+    event->repeats = 0;
+}
+
+// Take the oldest event; returns 0 when the queue is empty
+static inline int inputQueuePop(InputQueue* queue, InputEvent* event) {
+    if (queue->count == 0) return 0;
+    *event = queue->events[queue->head];
+    queue->head = (queue->head + 1) & (INPUT_QUEUE_SIZE - 1);
+    queue->count--;
+    return 1;
+}
+
+// The final byte of a CSI or SS3 sequence ends it; arrows become keys
+static inline void inputSequenceEnd(InputParser* parser, InputQueue* queue, char final, uint64_t now) {
+    queue->sequences++;
+    parser->state = INPUT_PLAIN;
+    if (final >= 'A' && final <= 'D' && parser->arrows != NULL) {
+        char key = parser->arrows[final - 'A'];
+        if (key != '.' && key != '\0') inputQueuePush(queue, key, now);
+    }
+}
+
+// Decode 'length' bytes read at 'now' into events
+static inline void inputFeed(InputParser* parser, InputQueue* queue, const char* bytes, size_t length,
+                             uint64_t now) {
+    for (size_t i = 0; i < length; i++) {
+        char c = bytes[i];
+
+        switch (parser->state) {
+        case INPUT_ESCAPE:
+            if (c == '[') {
+                parser->state = INPUT_CSI;
+            } else if (c == 'O') {
+                parser->state = INPUT_SS3;
+            } else if (c == INPUT_KEY_ESCAPE) {
+                inputQueuePush(queue, INPUT_KEY_ESCAPE, now); // Two presses; the second waits
+                parser->escape_ns = now;
+            } else {
+                parser->state = INPUT_PLAIN; // Alt+key: the key alone
+                inputQueuePush(queue, c, now);
+            }
+            break;
+        case INPUT_CSI:
+            // Parameter and intermediate bytes until a final byte
+            if (c >= 0x40 && c <= 0x7e) inputSequenceEnd(parser, queue, c, now);
+            break;
+        case INPUT_SS3:
+            inputSequenceEnd(parser, queue, c, now);
+            break;
+        default:
+            if (c == INPUT_KEY_ESCAPE) {
+                parser->state = INPUT_ESCAPE;
+                parser->escape_ns = now;
+            } else {
+                inputQueuePush(queue, c, now);
+            }
+            break;
+        }
+    }
+}
+
+// Settle an escape sequence nothing more arrived for: a lone ESC becomes
+// the escape key, an unfinished sequence is dropped
+static inline void inputFlush(InputParser* parser, InputQueue* queue, uint64_t now) {
+    if (parser->state == INPUT_PLAIN || now - parser->escape_ns < INPUT_ESCAPE_NS) return;
+    if (parser->state == INPUT_ESCAPE) inputQueuePush(queue, INPUT_KEY_ESCAPE, parser->escape_ns);
+    parser->state = INPUT_PLAIN;
+}
+
+#endif
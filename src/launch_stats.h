@@ -0,0 +1,315 @@
+#ifndef LAUNCH_STATS_H
+#define LAUNCH_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+// What each launch costs, and optional limits on it.
+//
+// A game run as a process is reaped with wait4(), whose rusage gives its
+// CPU time, peak RSS, page faults and context switches; the wall time runs
+// from the spawn to the reap. A game run in-process from its plugin is
+// measured with getrusage(RUSAGE_SELF) before and after, so its peak RSS is
+// the console's own.
+//
+// launch.stats, next to the games, is append-only: one 128-byte
+// checksummed LaunchRecord per launch. A game is known by a 64-bit hash of
+// its whole name, so names that only differ late never share totals. The
+// file is read once when the console starts into per-game totals
+// (LaunchCost), kept sorted by that hash and updated after every launch,
+// for the menu's cost line.
+//
+// limits.conf, next to the games, sets limits per game, one line each:
+//
+//   game_snake cpu=30 mem=64     CPU seconds and address space in MB
+//   * mem=256                    every game without a line of its own
+//
+// They are rlimits (RLIMIT_CPU, RLIMIT_AS), soft and hard, set in the
+// forked child just before it execs the game, so the game cannot raise them
+// again and nothing else runs under them. A limited game always runs as a
+// forked process, never from its plugin or through the launch server.
+
+#define LAUNCH_STATS_FILE "launch.stats"
+#define LAUNCH_LIMITS_FILE "limits.conf"
+#define LAUNCH_RECORD_MAGIC 0x32534c56u // "VLS2"; records keyed by a truncated name were "VLST"
+#define LAUNCH_GAME_LENGTH 24
+#define LAUNCH_PATH_LENGTH 512
+
+typedef struct {
+    uint64_t wall_ns;
+    uint64_t user_ns;
+    uint64_t system_ns;
+    uint64_t max_rss_kb;
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    int32_t status;             // wait() status; 0 for a plugin
+    int32_t plugin;             // Ran in-process
+} LaunchUsage;
+
+typedef struct {
+    uint64_t cpu_seconds;       // 0: no limit
+    uint64_t memory_mb;         // 0: no limit
+} LaunchLimits;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    int64_t time;               // Unix time the game ended
+    uint64_t game_hash;         // launchGameHash() of the name
+    char game[LAUNCH_GAME_LENGTH]; // Start of the name, for reading the file by hand
+    LaunchUsage usage;
+    uint64_t checksum;          // launchChecksum() of the bytes above
+} LaunchRecord;
+
+// Totals of one game's launches; max_rss_kb is the highest peak
+typedef struct {
+    uint64_t game_hash;
+    uint64_t runs;
+    uint64_t stopped;           // Runs ended by a signal, e.g. a limit
+    LaunchUsage total;
+} LaunchCost;
+
+typedef struct {
+    int fd;                     // launch.stats, appending; -1 if unavailable
+    LaunchCost* costs;          // Sorted by game_hash
+    int count, capacity;
+} LaunchStats;
+
+// FNV-1a, 64 bits
+static inline uint64_t launchChecksum(const LaunchRecord* record) {
+    const unsigned char* bytes = (const unsigned char*)record;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < offsetof(LaunchRecord, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// FNV-1a of a game's whole name
+static inline uint64_t launchGameHash(const char* game) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char* c = (const unsigned char*)game; *c != 0; c++) {
+        hash = (hash ^ *c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static inline uint64_t launchTimevalNs(struct timeval tv) {
+    return (uint64_t)tv.tv_sec * 1000000000ull + (uint64_t)tv.tv_usec * 1000ull;
+}
+
+// Fill 'usage' from a wait4() rusage
+static inline void launchUsageSet(LaunchUsage* usage, const struct rusage* ru, int status, uint64_t wallNs) {
+    memset(usage, 0, sizeof(*usage));
+    usage->wall_ns = wallNs;
+    usage->user_ns = launchTimevalNs(ru->ru_utime);
+    usage->system_ns = launchTimevalNs(ru->ru_stime);
+    usage->max_rss_kb = (uint64_t)ru->ru_maxrss;
+    usage->minor_faults = (uint64_t)ru->ru_minflt;
+    usage->major_faults = (uint64_t)ru->ru_majflt;
+    usage->voluntary_switches = (uint64_t)ru->ru_nvcsw;
+    usage->involuntary_switches = (uint64_t)ru->ru_nivcsw;
+    usage->status = status;
+}
+
+// Fill 'usage' with what this process used since 'before' (a plugin run)
+static inline void launchUsageSince(LaunchUsage* usage, const struct rusage* before, uint64_t wallNs) {
+    struct rusage after;
+
+    getrusage(RUSAGE_SELF, &after);
+    memset(usage, 0, sizeof(*usage));
+    usage->wall_ns = wallNs;
+    usage->user_ns = launchTimevalNs(after.ru_utime) - launchTimevalNs(before->ru_utime);
+    usage->system_ns = launchTimevalNs(after.ru_stime) - launchTimevalNs(before->ru_stime);
+    usage->max_rss_kb = (uint64_t)after.ru_maxrss;
+    usage->minor_faults = (uint64_t)(after.ru_minflt - before->ru_minflt);
+    usage->major_faults = (uint64_t)(after.ru_majflt - before->ru_majflt);
+    usage->voluntary_switches = (uint64_t)(after.ru_nvcsw - before->ru_nvcsw);
+    usage->involuntary_switches = (uint64_t)(after.ru_nivcsw - before->ru_nivcsw);
+    usage->plugin = 1;
+}
+
+// Read the limits for 'game' from the limits.conf in 'dir'; returns 1 if
+// it has any
+static inline int launchLimitsLoad(const char* dir, const char* game, LaunchLimits* limits) {
+    char path[LAUNCH_PATH_LENGTH + sizeof(LAUNCH_LIMITS_FILE)], line[256], name[128];
+    LaunchLimits fallback;
+    int found = 0;
+
+    memset(limits, 0, sizeof(*limits));
+    memset(&fallback, 0, sizeof(fallback));
+    snprintf(path, sizeof(path), "%s/%s", dir, LAUNCH_LIMITS_FILE);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int used;
+        if (line[0] == '#' || sscanf(line, "%127s%n", name, &used) != 1) continue;
+        int own = strcmp(name, game) == 0;
+        if (!own && strcmp(name, "*") != 0) continue;
+
+        LaunchLimits* target = own ? limits : &fallback;
+        for (char* word = strtok(line + used, " \t\n"); word != NULL; word = strtok(NULL, " \t\n")) {
+            unsigned long long value;
+            if (sscanf(word, "cpu=%llu", &value) == 1) target->cpu_seconds = value;
+            else if (sscanf(word, "mem=%llu", &value) == 1) target->memory_mb = value;
+        }
+        found |= own;
+    }
+    fclose(file);
+    if (!found) *limits = fallback;
+    return limits->cpu_seconds > 0 || limits->memory_mb > 0;
+}
+
+// Lower one rlimit to 'value' and its hard limit to 'hard'
+static inline int launchLimitSet(int resource, rlim_t value, rlim_t hard) {
+    struct rlimit limit;
+
+    if (getrlimit(resource, &limit) == -1) return -1;
+    limit.rlim_cur = value < limit.rlim_max ? value : limit.rlim_max;
+    if (hard < limit.rlim_max) limit.rlim_max = hard;
+    return setrlimit(resource, &limit);
+}
+
+// Set the limits on this process, a forked child about to exec the game;
+// lowered hard limits cannot be raised again
+static inline int launchLimitsApply(const LaunchLimits* limits) {
+    // SIGXCPU at the CPU limit, SIGKILL a second later if that is ignored
+    if (limits->cpu_seconds > 0
+        && launchLimitSet(RLIMIT_CPU, limits->cpu_seconds, limits->cpu_seconds + 1) == -1) {
+        return -1;
+    }
+    if (limits->memory_mb > 0
+        && launchLimitSet(RLIMIT_AS, limits->memory_mb << 20, limits->memory_mb << 20) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+// Position of 'game' in the sorted totals, or where it would be inserted
+static inline int launchCostFind(const LaunchStats* stats, uint64_t gameHash, int* found) {
+    int low = 0, high = stats->count;
+
+    *found = 0;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        uint64_t hash = stats->costs[mid].game_hash;
+        if (hash == gameHash) {
+            *found = 1;
+            return mid;
+        }
+        if (hash < gameHash) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Add one record to its game's totals
+static inline void launchCostAdd(LaunchStats* stats, const LaunchRecord* record) {
+    int found;
+    int i = launchCostFind(stats, record->game_hash, &found);
+
+    if (!found) {
+        if (stats->count == stats->capacity) {
+            int capacity = stats->capacity > 0 ? stats->capacity * 2 : 16;
+            LaunchCost* costs = realloc(stats->costs, (size_t)capacity * sizeof(LaunchCost));
+            if (costs == NULL) return; // The menu goes without this game's cost
+            stats->costs = costs;
+            stats->capacity = capacity;
+        }
+        memmove(&stats->costs[i + 1], &stats->costs[i], (size_t)(stats->count - i) * sizeof(LaunchCost));
+        stats->count++;
+        memset(&stats->costs[i], 0, sizeof(LaunchCost));
+        stats->costs[i].game_hash = record->game_hash;
+    }
+
+    LaunchCost* cost = &stats->costs[i];
+    const LaunchUsage* usage = &record->usage;
+    cost->runs++;
+    cost->stopped += !usage->plugin && WIFSIGNALED(usage->status);
+    cost->total.wall_ns += usage->wall_ns;
+    cost->total.user_ns += usage->user_ns;
+    cost->total.system_ns += usage->system_ns;
+    if (usage->max_rss_kb > cost->total.max_rss_kb) cost->total.max_rss_kb = usage->max_rss_kb;
+    cost->total.minor_faults += usage->minor_faults;
+    cost->total.major_faults += usage->major_faults;
+    cost->total.voluntary_switches += usage->voluntary_switches;
+    cost->total.involuntary_switches += usage->involuntary_switches;
+}
+
+// Open launch.stats in 'dir' and total the records in it; corrupt records
+// are skipped. Returns -1 if the file cannot be opened.
+static inline int launchStatsOpen(LaunchStats* stats, const char* dir) {
+    char path[LAUNCH_PATH_LENGTH + sizeof(LAUNCH_STATS_FILE)];
+    LaunchRecord records[64];
+    struct stat st;
+    ssize_t n;
+
+    memset(stats, 0, sizeof(*stats));
+    snprintf(path, sizeof(path), "%s/%s", dir, LAUNCH_STATS_FILE);
+    stats->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (stats->fd == -1) return -1;
+
+    // Drop a record torn by a crash so the next ones stay aligned
+    if (fstat(stats->fd, &st) == 0 && st.st_size % sizeof(LaunchRecord) != 0) {
+        if (ftruncate(stats->fd, st.st_size - st.st_size % sizeof(LaunchRecord)) == -1) {
+            close(stats->fd);
+            stats->fd = -1;
+            return -1;
+        }
+    }
+    while ((n = read(stats->fd, records, sizeof(records))) > 0) {
+        for (size_t i = 0; i < (size_t)n / sizeof(LaunchRecord); i++) {
+            if (records[i].magic == LAUNCH_RECORD_MAGIC && records[i].checksum == launchChecksum(&records[i])) {
+                launchCostAdd(stats, &records[i]);
+            }
+        }
+    }
+    return 0;
+}
+
+// Record one launch of 'game' and add it to the totals
+static inline void launchStatsAppend(LaunchStats* stats, const char* game, const LaunchUsage* usage) {
+    LaunchRecord record;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = LAUNCH_RECORD_MAGIC;
+    record.time = (int64_t)time(NULL);
+    record.game_hash = launchGameHash(game);
+    memcpy(record.game, game, strnlen(game, sizeof(record.game) - 1));
+    record.usage = *usage;
+    record.checksum = launchChecksum(&record);
+    launchCostAdd(stats, &record);
+    if (stats->fd != -1 && write(stats->fd, &record, sizeof(record)) != (ssize_t)sizeof(record)) {
+        perror("Unable to record the launch");
+    }
+}
+
+// Totals of 'game', or NULL if it has never run
+static inline const LaunchCost* launchStatsCost(const LaunchStats* stats, const char* game) {
+    int found;
+    int i = launchCostFind(stats, launchGameHash(game), &found);
+    return found ? &stats->costs[i] : NULL;
+}
+
+static inline void launchStatsClose(LaunchStats* stats) {
+    if (stats->fd != -1) close(stats->fd);
+    free(stats->costs);
+    memset(stats, 0, sizeof(*stats));
+    stats->fd = -1;
+}
+
+#endif
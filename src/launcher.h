@@ -0,0 +1,240 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "catalog.h"
+#include "launch_stats.h"
+
+// Pre-forked launch server.
+//
+// A small helper process is forked when the console starts, while the
+// console is still tiny, and waits on a socket for launch requests. It starts
+// each game with posix_spawn(), which glibc implements with vfork semantics
+// (no copy of the address space), so launching never pays for a full fork.
+// The terminal is already in the non-canonical, no-echo mode the games use,
+// so nothing has to be restored or re-applied around a launch.
+//
+// The game reports when its first frame is on screen through the descriptor
+// named in VGC_LAUNCH_FD (see renderer.h), which gives the keypress to first
+// frame latency of every launch. The helper reaps the game with wait4() and
+// sends back what it used. Games with limits (launch_stats.h) do not come
+// here: they are forked so the limits are set in the game's process alone.
+
+extern char** environ;
+
+// Helper replies
+#define LAUNCH_STARTED 1  // First frame shown, or the game exited without one
+#define LAUNCH_EXITED 2   // The game has finished
+#define LAUNCH_FAILED 3   // The game could not be started
+
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    char name[MAX_NAME_LENGTH];
+} LaunchRequest;
+
+typedef struct {
+    int32_t type;
+    int32_t status;          // errno for LAUNCH_FAILED, wait status for LAUNCH_EXITED
+    uint64_t first_frame_ns; // CLOCK_MONOTONIC time of the first frame, 0 if none
+    LaunchUsage usage;       // For LAUNCH_EXITED
+} LaunchReply;
+
+typedef struct {
+    pid_t pid;               // Helper process, -1 when not running
+    int fd;                  // Socket to the helper
+} LaunchServer;
+
+static inline uint64_t launchClockNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Send or receive one whole message; returns 0 on success
+static inline int launchSend(int fd, const void* msg, size_t size) {
+    ssize_t n;
+    do {
+        n = send(fd, msg, size, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    return n == (ssize_t)size ? 0 : -1;
+}
+
+static inline int launchReceive(int fd, void* msg, size_t size) {
+    ssize_t n;
+    do {
+        n = recv(fd, msg, size, 0);
+    } while (n == -1 && errno == EINTR);
+    return n == (ssize_t)size ? 0 : -1;
+}
+
+// Spawn one game and report on it
+static inline void launchServe(int fd, const LaunchRequest* request) {
+    LaunchReply reply;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t defaults;
+    int frame[2];
+    char frameEnv[32];
+    pid_t pid;
+
+    memset(&reply, 0, sizeof(reply));
+    if (pipe(frame) == -1) {
+        reply.type = LAUNCH_FAILED;
+        reply.status = errno;
+        launchSend(fd, &reply, sizeof(reply));
+        return;
+    }
+    fcntl(frame[0], F_SETFD, FD_CLOEXEC); // Only the write end goes to the game
+
+    // Give the game the write end of the first-frame pipe
+    int count = 0;
+    while (environ[count] != NULL) count++;
+    char** env = malloc(sizeof(char*) * (count + 2));
+    if (env == NULL) {
+        reply.type = LAUNCH_FAILED;
+        reply.status = ENOMEM;
+        launchSend(fd, &reply, sizeof(reply));
+        close(frame[0]);
+        close(frame[1]);
+        return;
+    }
+    memcpy(env, environ, sizeof(char*) * count);
+    snprintf(frameEnv, sizeof(frameEnv), "VGC_LAUNCH_FD=%d", frame[1]);
+    env[count] = frameEnv;
+    env[count + 1] = NULL;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addclose(&actions, fd);
+    posix_spawnattr_init(&attr);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+    posix_spawnattr_setsigdefault(&attr, &defaults); // The helper ignores these
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    char* argv[] = { (char*)request->name, NULL };
+    uint64_t start = launchClockNs();
+    int error = posix_spawn(&pid, request->path, &actions, &attr, argv, env);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    free(env);
+    close(frame[1]);
+
+    if (error != 0) {
+        reply.type = LAUNCH_FAILED;
+        reply.status = error;
+        launchSend(fd, &reply, sizeof(reply));
+        close(frame[0]);
+        return;
+    }
+
+    // Blocks until the first frame, or end of file if the game exits first
+    uint64_t shown = 0;
+    ssize_t n;
+    do {
+        n = read(frame[0], &shown, sizeof(shown));
+    } while (n == -1 && errno == EINTR);
+    close(frame[0]);
+    reply.type = LAUNCH_STARTED;
+    reply.first_frame_ns = n == (ssize_t)sizeof(shown) ? shown : 0;
+    launchSend(fd, &reply, sizeof(reply));
+
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    while (wait4(pid, &status, 0, &usage) == -1 && errno == EINTR) {}
+    reply.type = LAUNCH_EXITED;
+    reply.status = status;
+    launchUsageSet(&reply.usage, &usage, status, launchClockNs() - start);
+    launchSend(fd, &reply, sizeof(reply));
+}
+
+// Fork the helper; returns 0 on success
+static inline int launchServerStart(LaunchServer* server) {
+    int fds[2];
+
+    server->pid = -1;
+    server->fd = -1;
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        // Helper process: serve requests until the console goes away
+        LaunchRequest request;
+        close(fds[0]);
+        signal(SIGINT, SIG_IGN);
+        signal(SIGTERM, SIG_IGN);
+        while (launchReceive(fds[1], &request, sizeof(request)) == 0) {
+            launchServe(fds[1], &request);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    server->pid = pid;
+    server->fd = fds[0];
+    return 0;
+}
+
+// Run a game through the helper and wait for it to finish.
+// '*latency_ns' receives the time from 'keypress_ns' to the first frame
+// (0 if the game never drew one) and '*usage' what the game used (zero if
+// the helper died first). Returns 0 on success, -1 if the helper is
+// unavailable, or an errno value if the game could not be started.
+static inline int launchGame(LaunchServer* server, const GameEntry* game, uint64_t keypress_ns,
+                             uint64_t* latency_ns, LaunchUsage* usage) {
+    LaunchRequest request;
+    LaunchReply reply;
+
+    *latency_ns = 0;
+    memset(usage, 0, sizeof(*usage));
+    if (server->fd == -1) return -1;
+
+    memset(&request, 0, sizeof(request));
+    snprintf(request.path, sizeof(request.path), "%s", game->path);
+    snprintf(request.name, sizeof(request.name), "%s", game->name);
+    if (launchSend(server->fd, &request, sizeof(request)) == -1) return -1;
+
+    while (launchReceive(server->fd, &reply, sizeof(reply)) == 0) {
+        if (reply.type == LAUNCH_FAILED) {
+            return reply.status;
+        } else if (reply.type == LAUNCH_STARTED && reply.first_frame_ns > keypress_ns) {
+            *latency_ns = reply.first_frame_ns - keypress_ns;
+        } else if (reply.type == LAUNCH_EXITED) {
+            *usage = reply.usage;
+            return 0;
+        }
+    }
+    close(server->fd); // The helper died; later launches fall back to fork()
+    server->fd = -1;
+    return 0;
+}
+
+static inline void launchServerStop(LaunchServer* server) {
+    if (server->fd != -1) close(server->fd);
+    if (server->pid > 0) waitpid(server->pid, NULL, 0);
+    server->fd = -1;
+    server->pid = -1;
+}
+
+#endif
@@ -1,182 +1,670 @@
+#define _GNU_SOURCE // memfd_create(), readahead()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
 #include <unistd.h>
+#include <poll.h>
 #include <signal.h>
-#include <termios.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
+#include "console_runtime.h"
+#include "catalog.h"
+#include "cartridge.h"
+#include "launcher.h"
+#include "launch_stats.h"
+#include "plugin_loader.h"
+#include "prefetch.h"
+#include "score_store.h"
 
-#define MAX_GAMES 100
-#define MAX_NAME_LENGTH 256
+#define MENU_WIDTH 100
+#define MENU_EXTRA_ROWS (8 + LEADERBOARD_ROWS) // Header, search line, Exit, footer, launch status, cost and leaderboard lines
+#define MENU_MIN_WINDOW 3
+#define LEADERBOARD_SIZE 5
+#define LEADERBOARD_ROWS (LEADERBOARD_SIZE + 2)
+#define LAUNCH_LOG "launch.log"
+#define RECORD_DIR "recordings"
+#define SAVE_DIR "saves"
+#define SCORE_DIR "scores"
 
-// Global terminal attributes
-struct termios original_termios;
+// Menu screen
+Renderer screen;
+
+// Games in the game directory, or in the cartridge
+Catalog catalog;
+Cartridge cartridge;
+int haveCartridge = 0;
+
+// Warm helper that starts games, unless disabled with -F
+LaunchServer launchServer;
+char launchStatus[MAX_NAME_LENGTH + 128];
+
+// Games run in-process from their .so, unless disabled with -E
+PluginCache pluginCache;
+int usePlugins = 1;
+
+// Reads the highlighted game ahead into the page cache, unless disabled with -P
+Prefetcher prefetcher;
+int usePrefetch = 1;
+char prefetchedName[MAX_NAME_LENGTH]; // What the last request was for; "" for nothing
+
+// What each game has cost per launch, kept in launch.stats
+LaunchStats launchStats;
+
+// Frame timings of the menu loop, for vgc_top
+Probe menuProbe;
+
+// High scores of every game, shown for the highlighted one
+ScoreStore scoreStore;
+int haveScores = 0;
+
+// Arrow keys arrive as control keys, so letters stay free for type-ahead
+#define KEY_UP '\x10'
+#define KEY_DOWN '\x0e'
+#define KEY_RIGHT '\x06'
+#define KEY_LEFT '\x02'
+#define KEY_BACKSPACE '\x7f'
+#define MENU_ARROWS "\x10\x0e\x06\x02" // KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT
+
+// Where the menu is: the games matching the type-ahead query are catalog
+// entries first .. last - 1, and only 'window' of them, from 'top', are drawn
+typedef struct {
+    char query[MAX_NAME_LENGTH];  // Typed after '/', matched after "game_"
+    int searching;
+    int first, last;
+    int selected;                 // Catalog entry highlighted, unless on Exit
+    int exit_selected;
+    int top;                      // First catalog entry drawn
+    int window;                   // Game rows that fit on the terminal
+} Menu;
 
 // Function prototypes
-void setInputMode();
-void restoreInputMode();
-void signalHandler(int signo);
-int scanGames(char games[MAX_GAMES][MAX_NAME_LENGTH]);
-void printMenu(char games[MAX_GAMES][MAX_NAME_LENGTH], int gameCount, int selectedGame, int exitSelected);
-void startGame(char* gameName);
-
-int main() {
-    char games[MAX_GAMES][MAX_NAME_LENGTH];
-    int gameCount = scanGames(games);
-    int selectedGame = 0;
-    int exitSelected = 0;
-    char input;
+void printMenu(Catalog* catalog, Menu* menu);
+void prefetchSelected(const Menu* menu);
+void menuResize(Menu* menu, const Catalog* catalog);
+void menuFilter(Menu* menu, const Catalog* catalog);
+void menuMove(Menu* menu, int step);
+int menuKey(Menu* menu, const Catalog* catalog, char key);
+int printLeaderboard(GameEntry* game, int row);
+int printCost(GameEntry* game, int row);
+void startGame(GameEntry* game, uint64_t keypressNs);
+int runPlugin(GameEntry* game, uint64_t keypressNs);
+const VgcGame* loadPlugin(GameEntry* game, const char** error);
+void logLaunch(GameEntry* game, const char* mode, uint64_t latencyNs);
+void recordUsage(GameEntry* game, const LaunchUsage* usage);
+void setStorageDir(const char* gameDir, const char* variable, const char* name);
+
+int main(int argc, char* argv[]) {
+    int useLaunchServer = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "FEP")) != -1) {
+        if (opt == 'F') {
+            useLaunchServer = 0; // Plain fork() + exec for every launch
+        } else if (opt == 'E') {
+            usePlugins = 0; // Always run the game executables
+        } else if (opt == 'P') {
+            usePrefetch = 0; // Games start from whatever is cached
+        } else {
+            fprintf(stderr, "Usage: %s [-F] [-E] [-P] [game_directory | cartridge%s]\n", argv[0], CARTRIDGE_EXTENSION);
+            return 1;
+        }
+    }
+
+    const char* gameDir = optind < argc ? argv[optind] : ".";
+    if (isCartridgePath(gameDir)) {
+        if (cartridgeOpen(&cartridge, gameDir) == -1) {
+            fprintf(stderr, "Unable to open the cartridge %s: %s\n", gameDir, strerror(errno));
+            return 1;
+        }
+        haveCartridge = 1;
+        cartridgeCatalog(&cartridge, &catalog);
+        gameDir = catalog.dir; // Storage goes next to the cartridge
+    }
+    // Before the helper copies the environment
+    setStorageDir(gameDir, "VGC_RECORD_DIR", RECORD_DIR);
+    setStorageDir(gameDir, "VGC_SAVE_DIR", SAVE_DIR);
+    setStorageDir(gameDir, "VGC_SCORE_DIR", SCORE_DIR);
+
+    // Fork the helper first, while this process is still small
+    launchServer.pid = -1;
+    launchServer.fd = -1;
+    if (useLaunchServer && launchServerStart(&launchServer) == -1) {
+        perror("Unable to start the launch server");
+    }
+
+    if (!haveCartridge) catalogOpen(&catalog, gameDir);
+    if (launchStatsOpen(&launchStats, catalog.dir) == -1) {
+        perror("Unable to open " LAUNCH_STATS_FILE); // Costs are still shown for this session
+    }
+    const char* scoreDir = getenv("VGC_SCORE_DIR");
+    haveScores = scoreDir != NULL && scoreDir[0] != '\0' && scoreStoreOpen(&scoreStore, scoreDir) == 0;
+    Menu menu;
+    char bytes[64];
+    InputParser parser;
+    InputQueue queue;
+    InputEvent event;
     int running = 1;
 
-    if (gameCount == 0) {
-        printf("No games found in the current directory.\n");
+    if (catalog.count == 0) {
+        if (optind < argc) {
+            printf("No games found in %s.\n", argv[optind]); // The directory or cartridge given
+        } else {
+            printf("No games found in the current directory.\n");
+        }
+        launchStatsClose(&launchStats);
+        launchServerStop(&launchServer);
         return 1;
     }
 
     setInputMode(); // Set non-canonical input mode
+    runtime_title = "Main screen";
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    memset(&menu, 0, sizeof(menu));
+    menuFilter(&menu, &catalog);
+    menuResize(&menu, &catalog);
+    rendererInit(&screen, menu.window + MENU_EXTRA_ROWS, MENU_WIDTH);
+    runtime_screen = &screen;
+
+    // Watch the game directory so the menu follows games being added or removed
+    struct pollfd fds[2];
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = haveCartridge ? -1 : catalogWatch(&catalog); // A cartridge does not change
+    fds[1].events = POLLIN;
+
+    inputParserInit(&parser, MENU_ARROWS);
+    inputQueueInit(&queue);
+    probeOpen(&menuProbe, "main_screen");
+    runtime_probe = &menuProbe;
+    if (usePrefetch && prefetchStart(&prefetcher) == -1) {
+        usePrefetch = 0; // Games still start, only colder
+    }
 
     while (running) {
-        system("clear");
-        printMenu(games, gameCount, selectedGame, exitSelected);
+        int launched = 0;
+        unsigned long syscalls = 1;
+
+        probeBegin(&menuProbe);
+        if (usePrefetch) prefetchSelected(&menu);
+        printMenu(&catalog, &menu);
+        probeLap(&menuProbe, &menuProbe.frame.render_ns);
+        rendererPresent(&screen);
+        probeLap(&menuProbe, &menuProbe.frame.write_ns);
+
+        // A lone ESC only counts once nothing follows it, so wake up to settle it
+        int timeout = parser.state == INPUT_PLAIN ? -1 : (int)(INPUT_ESCAPE_NS / 1000000) + 1;
+        if (poll(fds, 2, timeout) == -1) {
+            continue;
+        }
+        probeLap(&menuProbe, &menuProbe.frame.wait_ns);
+
+        if ((fds[1].revents & POLLIN) && catalogRefresh(&catalog)) {
+            menuFilter(&menu, &catalog);
+            menuResize(&menu, &catalog);
+        }
+        probeLap(&menuProbe, &menuProbe.frame.sim_ns);
 
-        if (read(STDIN_FILENO, &input, 1) > 0) {
-            if (input == 'q') {
+        // Take every key waiting, so a burst of keys does not trail behind
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            uint64_t now = monotonicNs();
+            ssize_t n;
+            while (++syscalls && (n = read(STDIN_FILENO, bytes, sizeof(bytes))) > 0) {
+                inputFeed(&parser, &queue, bytes, (size_t)n, now);
+            }
+        }
+        inputFlush(&parser, &queue, monotonicNs());
+
+        while (running && !launched && inputQueuePop(&queue, &event)) {
+            int action = menuKey(&menu, &catalog, event.key);
+            if (action == -1) {
                 running = 0; // Exit the main screen
-            } else if (input == 'w') {
-                if (exitSelected) {
-                    // If currently on Exit, move focus to the last game
-                    exitSelected = 0;
-                    selectedGame = gameCount - 1;
-                } else {
-                    // Move up in the game list
-                    if (selectedGame == 0) {
-                        exitSelected = 1; // If at the first game, move to Exit
-                    } else {
-                        selectedGame--;
-                    }
-                }
-            } else if (input == 's') {
-                if (!exitSelected && selectedGame == gameCount - 1) {
-                    // If currently on the last game, move focus to Exit
-                    exitSelected = 1;
-                } else if (exitSelected) {
-                    // If currently on Exit, move focus to the first game
-                    exitSelected = 0;
-                    selectedGame = 0;
-                } else {
-                    // Move down in the game list
-                    selectedGame++;
-                }
-            } else if (input == 'a' || input == 'd') {
-                // Toggle focus between game list and Exit button
-                exitSelected = !exitSelected;
-            } else if (input == '\n') {
-                if (exitSelected) {
-                    running = 0; // Exit the main screen
-                } else {
-                    startGame(games[selectedGame]); // Launch selected game
-                }
+            } else if (action == 1) {
+                startGame(&catalog.entries[menu.selected], launchClockNs()); // Launch selected game
+                if (haveScores) scoreStoreRefresh(&scoreStore); // Pick up its result
+                menuResize(&menu, &catalog); // The terminal may have changed meanwhile
+                launched = 1;
             }
         }
+        while (launched && inputQueuePop(&queue, &event)) {
+            // Keys typed before the game started were meant for the menu
+        }
+
+        // A frame that ran a game says nothing about the menu
+        if (!launched) {
+            probeLap(&menuProbe, &menuProbe.frame.input_ns);
+            probeEnd(&menuProbe, screen.last.bytes, syscalls + screen.last.syscalls, 0);
+        }
     }
+    runtime_probe = NULL;
+    probeClose(&menuProbe);
+    if (usePrefetch) prefetchStop(&prefetcher);
 
+    rendererFinish(&screen);
+    rendererFree(&screen);
+    catalogClose(&catalog);
+    launchStatsClose(&launchStats);
+    if (haveScores) scoreStoreClose(&scoreStore);
+    launchServerStop(&launchServer);
+    pluginUnloadAll(&pluginCache);
+    if (haveCartridge) cartridgeClose(&cartridge);
+    runtime_screen = NULL;
     restoreInputMode();
     printf("\nThank you for using the video game console! Goodbye!\n");
     return 0;
 }
 
-// Set terminal input mode for non-canonical input
-void setInputMode() {
-    struct termios new_termios;
-    tcgetattr(STDIN_FILENO, &original_termios); // Get current terminal attributes
-    new_termios = original_termios;
-    new_termios.c_lflag &= ~(ICANON | ECHO); // Disable canonical mode and echo
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_termios); // Apply new settings
-}
+// Draw the main menu into the back buffer: the search line, then only the
+// window of matching games around the selection
+void printMenu(Catalog* catalog, Menu* menu) {
+    int row = 0;
+    int matches = menu->last - menu->first;
+
+    rendererEnsureSize(&screen, menu->window + MENU_EXTRA_ROWS, MENU_WIDTH);
+    rendererClear(&screen);
+    rendererText(&screen, row++, 0, "=== Video Game Console ===");
+    rendererText(&screen, row++, 0, "Use 'w' and 's' to navigate, 'a' and 'd' to toggle, '/' to search, 'Enter' to select, 'q' to quit.");
+    rendererText(&screen, row++, 0, "---------------------------");
+
+    int end = menu->top + menu->window < menu->last ? menu->top + menu->window : menu->last;
+    if (menu->searching) {
+        rendererText(&screen, row++, 0, "Search: %s_   (%d of %d games)", menu->query, matches, catalog->count);
+    } else if (matches > menu->window) {
+        rendererText(&screen, row++, 0, "Games %d-%d of %d", menu->top - menu->first + 1, end - menu->first, matches);
+    } else {
+        rendererText(&screen, row++, 0, "Games");
+    }
+
+    for (int i = menu->top; i < end; i++) {
+        GameEntry* game = &catalog->entries[i];
+        const char* note = game->executable ? "" : "  (not executable)";
+        if (!menu->exit_selected && i == menu->selected) {
+            rendererText(&screen, row++, 0, " > %s <%s", game->name, note); // Highlight selected game
+        } else {
+            rendererText(&screen, row++, 0, "   %s%s", game->name, note);
+        }
+    }
+    row += menu->window - (end - menu->top); // Exit stays put while the list narrows
 
-// Restore the original terminal settings
-void restoreInputMode() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+    if (menu->exit_selected) {
+        rendererText(&screen, row++, 0, " > Exit <"); // Highlight Exit when selected
+    } else {
+        rendererText(&screen, row++, 0, "   Exit");
+    }
+
+    rendererText(&screen, row++, 0, "---------------------------");
+    rendererText(&screen, row++, 0, "%s", launchStatus);
+    if (!menu->exit_selected) {
+        row = printCost(&catalog->entries[menu->selected], row);
+        printLeaderboard(&catalog->entries[menu->selected], row + 1);
+    } else {
+        row++;
+    }
 }
 
-// Signal handler for graceful exit
-void signalHandler(int signo) {
-    restoreInputMode(); // Restore terminal settings
-    printf("\nMain screen exited due to signal %d. Goodbye!\n", signo);
-    exit(0);
+// Fit the game window to the terminal; a short catalog gets a short window
+void menuResize(Menu* menu, const Catalog* catalog) {
+    int rows, cols;
+
+    terminalSize(&rows, &cols);
+    menu->window = rows - MENU_EXTRA_ROWS;
+    if (menu->window > catalog->count) menu->window = catalog->count;
+    if (menu->window < MENU_MIN_WINDOW) menu->window = MENU_MIN_WINDOW;
+    menuMove(menu, 0);
 }
 
-// Scan the current directory for games with names starting with "game_"
-int scanGames(char games[MAX_GAMES][MAX_NAME_LENGTH]) {
-    DIR* dir;
-    struct dirent* entry;
-    int count = 0;
+// Find the games matching the query and keep the selection among them;
+// with none, only Exit is left
+void menuFilter(Menu* menu, const Catalog* catalog) {
+    char prefix[MAX_NAME_LENGTH + 8];
 
-    dir = opendir(".");
-    if (dir == NULL) {
-        perror("Unable to open directory");
-        exit(EXIT_FAILURE);
+    snprintf(prefix, sizeof(prefix), "game_%s", menu->query);
+    catalogPrefix(catalog, prefix, &menu->first, &menu->last);
+    if (menu->first == menu->last) menu->exit_selected = 1;
+    menuMove(menu, 0);
+}
+
+// Move the selection 'step' rows through the matches and Exit, wrapping
+// around, then scroll the window to keep it in view
+void menuMove(Menu* menu, int step) {
+    if (menu->first == menu->last) {
+        menu->exit_selected = 1;
+        menu->top = menu->first;
+        return;
+    }
+    if (step < 0 && menu->exit_selected) {
+        menu->exit_selected = 0;
+        menu->selected = menu->last - 1; // From Exit to the last game
+    } else if (step < 0 && menu->selected <= menu->first) {
+        menu->exit_selected = 1; // From the first game to Exit
+    } else if (step > 0 && menu->exit_selected) {
+        menu->exit_selected = 0;
+        menu->selected = menu->first; // From Exit to the first game
+    } else if (step > 0 && menu->selected >= menu->last - 1) {
+        menu->exit_selected = 1; // From the last game to Exit
+    } else {
+        menu->selected += step;
     }
 
-    while ((entry = readdir(dir)) != NULL) {
-        if (strncmp(entry->d_name, "game_", 5) == 0 && strstr(entry->d_name, ".c") == NULL) {
-            strncpy(games[count], entry->d_name, MAX_NAME_LENGTH);
-            games[count][MAX_NAME_LENGTH - 1] = '\0'; // Ensure null termination
-            count++;
-            if (count >= MAX_GAMES) break; // Limit reached
+    if (menu->selected < menu->first) menu->selected = menu->first;
+    if (menu->selected >= menu->last) menu->selected = menu->last - 1;
+    if (menu->top > menu->selected) menu->top = menu->selected;
+    if (menu->top <= menu->selected - menu->window) menu->top = menu->selected - menu->window + 1;
+    if (menu->top > menu->last - menu->window) menu->top = menu->last - menu->window;
+    if (menu->top < menu->first) menu->top = menu->first;
+}
+
+// Handle one key; returns 1 to launch the selected game, -1 to quit, 0 otherwise.
+// While searching, letters go to the query instead of moving.
+int menuKey(Menu* menu, const Catalog* catalog, char key) {
+    size_t length = strlen(menu->query);
+
+    if (key == '\n') {
+        return menu->exit_selected ? -1 : 1;
+    } else if (key == KEY_UP || (!menu->searching && key == 'w')) {
+        menuMove(menu, -1);
+    } else if (key == KEY_DOWN || (!menu->searching && key == 's')) {
+        menuMove(menu, 1);
+    } else if (menu->searching) {
+        if (key == INPUT_KEY_ESCAPE) {
+            menu->searching = 0; // Back to every game
+            menu->query[0] = '\0';
+        } else if ((key == KEY_BACKSPACE || key == '\b') && length > 0) {
+            menu->query[length - 1] = '\0';
+        } else if (key > ' ' && key < 0x7f && length + 1 < sizeof(menu->query) - 8) {
+            menu->query[length] = key;
+            menu->query[length + 1] = '\0';
+        } else {
+            return 0;
         }
+        // The best match for a new query is the first one
+        menuFilter(menu, catalog);
+        menu->selected = menu->first;
+        menu->exit_selected = menu->first == menu->last;
+        menuMove(menu, 0);
+    } else if (key == 'q') {
+        return -1;
+    } else if (key == '/') {
+        menu->searching = 1;
+    } else if (key == 'a' || key == 'd' || key == KEY_LEFT || key == KEY_RIGHT) {
+        // Toggle focus between game list and Exit button
+        if (menu->first < menu->last) menu->exit_selected = !menu->exit_selected;
+    }
+    return 0;
+}
+
+// Print the best scores of 'game' from screen row 'row'; returns the first
+// row below them
+int printLeaderboard(GameEntry* game, int row) {
+    static const char* outcomes[] = { "", "lost", "won", "draw", "quit" };
+    ScoreRecord top[LEADERBOARD_SIZE];
+
+    if (!haveScores) {
+        return row;
+    }
+    size_t count = scoreTop(&scoreStore, game->name, top, LEADERBOARD_SIZE);
+    rendererText(&screen, row++, 0, "Top scores for %s (%llu sessions):", game->name,
+                 (unsigned long long)scoreCount(&scoreStore, game->name));
+    for (size_t i = 0; i < count; i++) {
+        char date[32];
+        time_t when = (time_t)top[i].time;
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&when));
+        rendererText(&screen, row++, 0, "  %zu. %8lld  %-4s  %s", i + 1, (long long)top[i].score,
+                     top[i].outcome <= SCORE_QUIT ? outcomes[top[i].outcome] : "", date);
+    }
+    return row;
+}
+
+// Print what 'game' costs per launch on row 'row'; returns the row below it
+int printCost(GameEntry* game, int row) {
+    const LaunchCost* cost = launchStatsCost(&launchStats, game->name);
+
+    if (cost == NULL) {
+        rendererText(&screen, row++, 0, "Cost: not run yet");
+        return row;
     }
-    closedir(dir);
-    return count;
+    double runs = (double)cost->runs;
+    char stopped[32] = "";
+    if (cost->stopped > 0) snprintf(stopped, sizeof(stopped), ", %llu stopped", (unsigned long long)cost->stopped);
+    rendererText(&screen, row++, 0, "Cost over %llu runs%s: %.2f s CPU in %.1f s, %.0f faults, %.0f switches per run; peak %.1f MB",
+                 (unsigned long long)cost->runs, stopped,
+                 (cost->total.user_ns + cost->total.system_ns) / 1e9 / runs, cost->total.wall_ns / 1e9 / runs,
+                 (cost->total.minor_faults + cost->total.major_faults) / runs,
+                 (cost->total.voluntary_switches + cost->total.involuntary_switches) / runs,
+                 cost->total.max_rss_kb / 1024.0);
+    return row;
 }
 
-// Print the main menu
-void printMenu(char games[MAX_GAMES][MAX_NAME_LENGTH], int gameCount, int selectedGame, int exitSelected) {
-    printf("=== Video Game Console ===\n");
-    printf("Use 'w' and 's' to navigate, 'a' and 'd' to toggle, 'Enter' to select, and 'q' to quit.\n");
-    printf("---------------------------\n");
+// Start the selected game in-process when it has a plugin, otherwise through
+// the launch server, or with fork() when the server is not running, and
+// record the time from keypress to first frame and what the game used.
+// Games from the cartridge are forked and fexecve()d from their memfd, and
+// games with limits (launch_stats.h) are always forked, so the limits are
+// set in the game's own process.
+void startGame(GameEntry* game, uint64_t keypressNs) {
+    uint64_t latencyNs = 0;
+    int execFd = -1;
+    int result = -1;
+    LaunchLimits limits;
+    LaunchUsage usage;
+
+    int limited = launchLimitsLoad(catalog.dir, game->name, &limits);
+    if (usePlugins && !limited && runPlugin(game, keypressNs) == 0) {
+        return;
+    }
 
-    for (int i = 0; i < gameCount; i++) {
-        if (!exitSelected && i == selectedGame) {
-            printf(" > %s <\n", games[i]); // Highlight selected game
+    if (game->slot > 0) {
+        execFd = cartridgeMemfd(&cartridge, game->slot - 1);
+        if (execFd == -1) {
+            snprintf(launchStatus, sizeof(launchStatus), "Failed to start %s: %s", game->name, strerror(errno));
+            return;
+        }
+    } else if (!limited) {
+        result = launchGame(&launchServer, game, keypressNs, &latencyNs, &usage);
+    }
+    if (result > 0) {
+        snprintf(launchStatus, sizeof(launchStatus), "Failed to start %s: %s", game->name, strerror(result));
+        return;
+    }
+
+    if (result == -1) {
+        int frame[2];
+        if (pipe(frame) == -1) {
+            perror("Failed to create pipe");
+            return;
+        }
+
+        uint64_t start = launchClockNs();
+        pid_t pid = fork();
+
+        if (pid == -1) {
+            perror("Failed to fork");
+            close(frame[0]);
+            close(frame[1]);
+            return;
+        }
+
+        if (pid == 0) {
+            // Child process: Execute the game
+            char frameEnv[16];
+            snprintf(frameEnv, sizeof(frameEnv), "%d", frame[1]);
+            setenv("VGC_LAUNCH_FD", frameEnv, 1);
+            close(frame[0]);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            if (launchLimitsApply(&limits) == -1) {
+                perror("Failed to set the game's limits");
+                exit(EXIT_FAILURE);
+            }
+            if (execFd != -1) {
+                char* args[] = { game->name, NULL };
+                fexecve(execFd, args, environ);
+            } else {
+                execl(game->path, game->name, (char *)NULL);
+            }
+
+            // If execl fails, print an error and exit
+            perror("Failed to start game");
+            exit(EXIT_FAILURE);
         } else {
-            printf("   %s\n", games[i]);
+            // Parent process: Wait for the first frame, then for the child to finish
+            uint64_t shown = 0;
+            close(frame[1]);
+            if (read(frame[0], &shown, sizeof(shown)) == sizeof(shown) && shown > keypressNs) {
+                latencyNs = shown - keypressNs;
+            }
+            close(frame[0]);
+
+            int status = 0;
+            struct rusage rusage;
+            memset(&rusage, 0, sizeof(rusage));
+            while (wait4(pid, &status, 0, &rusage) == -1 && errno == EINTR) {}
+            launchUsageSet(&usage, &rusage, status, launchClockNs() - start);
         }
     }
 
-    if (exitSelected) {
-        printf(" > Exit <\n"); // Highlight Exit when selected
-    } else {
-        printf("   Exit\n");
+    rendererInvalidate(&screen); // The game drew over the menu
+    logLaunch(game, execFd != -1 ? "memfd" : launchServer.fd != -1 && !limited ? "server" : "fork", latencyNs);
+    recordUsage(game, &usage);
+}
+
+// Run a game plugin inside the console's own loop, renderer and terminal
+// session; returns -1 if the game has no usable plugin
+int runPlugin(GameEntry* game, uint64_t keypressNs) {
+    const char* error;
+    char summary[256] = "";
+    char* argv[] = { game->name, NULL };
+    TickLoop loop;
+    VgcSession session;
+
+    const VgcGame* plugin = loadPlugin(game, &error);
+    if (plugin == NULL) {
+        if (error != NULL) {
+            snprintf(launchStatus, sizeof(launchStatus), "Plugin %s.so not loaded: %.80s", game->name, error);
+        }
+        return -1;
+    }
+
+    struct rusage before;
+    LaunchUsage usage;
+    uint64_t start = launchClockNs();
+    getrusage(RUSAGE_SELF, &before);
+
+    double tickRate = plugin->tick_rate;
+    uint64_t seed = vgcNewSeed();
+    void* state = vgcSessionStart(&session, plugin, 1, argv, &tickRate, seed, NULL, 0);
+    if (state == NULL) {
+        snprintf(launchStatus, sizeof(launchStatus), "Failed to start %s", game->name);
+        return 0;
+    }
+
+    uint64_t shown = vgcRun(plugin, state, tickRate, &screen, &loop, &session);
+    vgcSessionEnd(&session);
+    plugin->shutdown(state, summary, sizeof(summary));
+    launchUsageSince(&usage, &before, launchClockNs() - start);
+    logLaunch(game, "plugin", shown > keypressNs ? shown - keypressNs : 0);
+    recordUsage(game, &usage);
+    return 0;
+}
+
+// Have the highlighted game read ahead, with its plugin and libraries, once
+// the selection moves to it; moving on cancels what is left of the last one
+void prefetchSelected(const Menu* menu) {
+    PrefetchRange ranges[2];
+    int count = 0;
+
+    const GameEntry* game = menu->exit_selected ? NULL : &catalog.entries[menu->selected];
+    if (strcmp(game != NULL ? game->name : "", prefetchedName) == 0) return;
+    snprintf(prefetchedName, sizeof(prefetchedName), "%s", game != NULL ? game->name : "");
+    memset(ranges, 0, sizeof(ranges));
+
+    if (game != NULL && game->slot > 0) {
+        // Cartridge entries are byte ranges of the cartridge
+        char name[MAX_NAME_LENGTH + 4];
+        const CartridgeEntry* entry = &cartridge.entries[game->slot - 1];
+        snprintf(ranges[count].path, sizeof(ranges[count].path), "%s", cartridge.path);
+        ranges[count].offset = entry->offset;
+        ranges[count++].length = entry->size;
+
+        snprintf(name, sizeof(name), "%s.so", game->name);
+        int plugin = cartridgeFind(&cartridge, name);
+        if (usePlugins && plugin != -1 && cartridge.entries[plugin].kind == CARTRIDGE_PLUGIN) {
+            snprintf(ranges[count].path, sizeof(ranges[count].path), "%s", cartridge.path);
+            ranges[count].offset = cartridge.entries[plugin].offset;
+            ranges[count++].length = cartridge.entries[plugin].size;
+        }
+    } else if (game != NULL) {
+        snprintf(ranges[count++].path, sizeof(ranges[0].path), "%s", game->path);
+        if (usePlugins) snprintf(ranges[count++].path, sizeof(ranges[0].path), "%s.so", game->path);
     }
+    prefetchRequest(&prefetcher, ranges, count);
+}
+
+// The plugin of 'game': "<game>.so" next to it, or in the cartridge
+const VgcGame* loadPlugin(GameEntry* game, const char** error) {
+    char name[MAX_NAME_LENGTH + 4], path[32];
+
+    *error = NULL;
+    if (game->slot == 0) return pluginLoad(&pluginCache, game, error);
 
-    printf("---------------------------\n");
+    snprintf(name, sizeof(name), "%s.so", game->name);
+    int entry = cartridgeFind(&cartridge, name);
+    if (entry == -1 || cartridge.entries[entry].kind != CARTRIDGE_PLUGIN) return NULL;
+    int fd = cartridgeMemfd(&cartridge, entry);
+    if (fd == -1) {
+        *error = strerror(errno);
+        return NULL;
+    }
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    return pluginOpen(&pluginCache, path, error);
 }
 
-// Start the selected game using fork()
-void startGame(char* gameName) {
-    pid_t pid = fork();
+// Show the last launch latency and append it to the launch log
+void logLaunch(GameEntry* game, const char* mode, uint64_t latencyNs) {
+    char path[MAX_PATH_LENGTH + sizeof(LAUNCH_LOG)];
 
-    if (pid == -1) {
-        perror("Failed to fork");
+    if (latencyNs == 0) {
+        snprintf(launchStatus, sizeof(launchStatus), "Last launch: %s (no frame drawn)", game->name);
         return;
     }
+    snprintf(launchStatus, sizeof(launchStatus), "Last launch: %s, first frame after %.2f ms",
+             game->name, latencyNs / 1e6);
 
-    if (pid == 0) {
-        // Child process: Execute the game
-        char command[256];
-        snprintf(command, sizeof(command), "./%s", gameName); // Add "./" prefix
-        execlp(command, gameName, (char *)NULL);
+    snprintf(path, sizeof(path), "%s/%s", catalog.dir, LAUNCH_LOG);
+    FILE* log = fopen(path, "a");
+    if (log != NULL) {
+        fprintf(log, "%s %s %.3f ms\n", game->name, mode, latencyNs / 1e6);
+        fclose(log);
+    }
+}
 
-        // If execlp fails, print an error and exit
-        perror("Failed to start game");
-        exit(EXIT_FAILURE);
-    } else {
-        // Parent process: Wait for the child to finish
-        int status;
-        waitpid(pid, &status, 0);
+// Add a finished launch to launch.stats, and say so if the game was
+// stopped by a signal (SIGXCPU or SIGKILL for its CPU limit, for example)
+void recordUsage(GameEntry* game, const LaunchUsage* usage) {
+    if (usage->wall_ns == 0) {
+        return; // The launch server died before the game finished
+    }
+    launchStatsAppend(&launchStats, game->name, usage);
+    if (!usage->plugin && WIFSIGNALED(usage->status)) {
+        snprintf(launchStatus, sizeof(launchStatus), "%s was stopped: %s", game->name,
+                 strsignal(WTERMSIG(usage->status)));
+    }
+}
+
+// Point 'variable' at the directory 'name' next to the games (on the
+// storage image), unless it is already set; games keep their recordings
+// (VGC_RECORD_DIR) and save states (VGC_SAVE_DIR) there. An empty value
+// turns the feature off.
+void setStorageDir(const char* gameDir, const char* variable, const char* name) {
+    char path[MAX_PATH_LENGTH];
+
+    if (getenv(variable) != NULL) {
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/%s", gameDir, name);
+    if (mkdir(path, 0755) == 0 || errno == EEXIST) {
+        setenv(variable, path, 1);
     }
 }
@@ -0,0 +1,747 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "renderer.h"
+#include "tick_loop.h"
+#include "input_queue.h"
+#include "vgc_random.h"
+#include "vgc_plugin.h"
+
+// Netplay: two players on two terminals, over a Unix socket (an address
+// with a '/' in it) or TCP ("host:port", or ":port" for the loopback).
+//
+// One side hosts and plays player 0, the other joins as player 1. The host
+// sends the game's name, seed and arguments, so both sides start the same
+// game; from then on only keys cross the wire.
+//
+// Games with a tick rate run both copies of the simulation with rollback.
+// Every tick each side sends its keys for the tick 'delay' ticks ahead and
+// goes on without waiting for the other side's, guessing the other player
+// pressed nothing. When the other player's keys arrive for a tick already
+// simulated, the game is put back to its save() from before that tick and
+// the ticks since are simulated again: a remote key costs a resimulation,
+// not a stall. A side only waits when it gets NETPLAY_WINDOW ticks ahead of
+// the other's keys, and the game only ends on a tick both players' keys
+// are known for. Every NETPLAY_SYNC_INTERVAL ticks the sides compare
+// checksums of their save()s, which catches a game that is not
+// deterministic. Rolling back shuts the game down and resumes it, so a game
+// that starts threads in resume() should run with one.
+//
+// Games without a tick rate take turns in lockstep: a key the game accepts
+// from the local player (handle_player_input() does not return -1) is sent,
+// and the other player's keys are played as they arrive.
+//
+// To try all of this on one machine the host can add lag: every message is
+// held back for half the round trip, give or take up to the jitter, and
+// sent in order as a stream would deliver it.
+
+#define NETPLAY_WINDOW 16          // Ticks a side may run ahead of the other's keys
+#define NETPLAY_RING (2 * NETPLAY_WINDOW) // Ticks of keys kept
+#define NETPLAY_KEYS 8             // Keys per player per tick; more are dropped
+#define NETPLAY_SYNC_INTERVAL 64   // Ticks between checksums
+#define NETPLAY_PING_NS 1000000000ull
+#define NETPLAY_QUEUE 256          // Messages the lag can hold back; a power of two
+#define NETPLAY_DEFAULT_DELAY 1    // Ticks of input delay
+#define NETPLAY_NAME_LENGTH 64
+#define NETPLAY_HELLO_LENGTH 4096  // Arguments the host sends
+
+enum { NETPLAY_HELLO = 1, NETPLAY_INPUT, NETPLAY_KEY, NETPLAY_SYNC, NETPLAY_PING, NETPLAY_PONG };
+
+typedef struct {
+    uint32_t type;              // NETPLAY_*
+    uint32_t length;            // HELLO: bytes that follow
+    uint64_t tick;              // INPUT, SYNC: the tick
+    uint64_t value;             // SYNC: checksum; PING, PONG: when the ping was sent
+    char keys[NETPLAY_KEYS];    // INPUT: the tick's keys, '\0' after the last; KEY: one key
+} NetplayMessage;
+
+// What the host says first, followed by 'argc' arguments, each ending in
+// '\0'; the guest answers with an empty HELLO
+typedef struct {
+    char name[NETPLAY_NAME_LENGTH]; // VgcGame.name
+    uint64_t seed;
+    uint32_t delay;             // Ticks of input delay
+    uint32_t argc;
+    uint64_t lag_ns, jitter_ns; // Added round trip, 0 for none
+} NetplayHello;
+
+typedef struct {
+    void* data;                 // The game's save() from before the tick
+    size_t size, capacity;
+} NetplaySave;
+
+typedef struct {
+    int fd;                     // The connection
+    int player;                 // 0 hosting, 1 joined
+    int delay;                  // Ticks between a key and the tick it plays in
+    uint64_t lag_ns, jitter_ns;
+    VgcRandom rng;              // Jitter
+    NetplayMessage queue[NETPLAY_QUEUE]; // Held back by the lag
+    uint64_t due_ns[NETPLAY_QUEUE];
+    unsigned head, count;
+    char in[sizeof(NetplayMessage)]; // A message read in part
+    size_t in_length;
+    char** argv;                // The host's arguments, on the guest
+    char* args;                 // The strings argv points into
+
+    // Rollback
+    char keys[2][NETPLAY_RING][NETPLAY_KEYS]; // Per player and tick
+    NetplaySave saves[NETPLAY_WINDOW];
+    char pending[NETPLAY_KEYS]; // Local keys for the next tick sent
+    int pending_count;
+    uint64_t tick;              // Ticks simulated
+    uint64_t sent;              // Ticks the local keys were sent for
+    uint64_t confirmed;         // Ticks the other player's keys arrived for
+    uint64_t rollback;          // Earliest tick simulated on a wrong guess, UINT64_MAX for none
+    uint64_t ended;             // Ticks simulated when the game ended, 0 while it runs
+    uint64_t checked;           // Ticks checksums were considered for
+    uint64_t sync_tick, sync_sum;     // The last local checksum
+    uint64_t remote_tick, remote_sum; // The other side's last checksum
+    int waiting;                // Too far ahead of the other player
+    int closed;                 // The connection is gone
+    int left;                   // The other player left before the game ended
+    uint64_t desync;            // Tick the checksums differed at, 0 if they never did
+
+    unsigned long rollbacks, resimulated, stalls;
+    uint64_t max_rollback;      // Most ticks simulated again at once
+    uint64_t rtt_ns;            // Last measured round trip
+} Netplay;
+
+// FNV-1a, 64 bits
+static inline uint64_t netplayChecksum(const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static inline int netplayWriteAll(int fd, const void* data, size_t size) {
+    const char* bytes = data;
+    while (size > 0) {
+        ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        bytes += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static inline int netplayReadAll(int fd, void* data, size_t size) {
+    char* bytes = data;
+    while (size > 0) {
+        ssize_t n = recv(fd, bytes, size, 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = ECONNRESET;
+            return -1;
+        }
+        bytes += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+// Turn 'address' into a socket address: a path with a '/' in it, or
+// "host:port" with the loopback for an empty host; returns -1 with errno set
+static inline int netplayAddress(const char* address, struct sockaddr_storage* storage, socklen_t* length) {
+    memset(storage, 0, sizeof(*storage));
+    if (strchr(address, '/') != NULL) {
+        struct sockaddr_un* local = (struct sockaddr_un*)storage;
+        if (strlen(address) >= sizeof(local->sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        local->sun_family = AF_UNIX;
+        snprintf(local->sun_path, sizeof(local->sun_path), "%s", address);
+        *length = sizeof(*local);
+        return 0;
+    }
+
+    char host[256];
+    const char* colon = strrchr(address, ':');
+    const char* port = colon != NULL ? colon + 1 : address;
+    size_t hostLength = colon != NULL ? (size_t)(colon - address) : 0;
+    if (hostLength >= sizeof(host) || port[0] == '\0') {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, address, hostLength);
+    host[hostLength] = '\0';
+
+    struct addrinfo hints, *found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(hostLength > 0 ? host : "127.0.0.1", port, &hints, &found) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(storage, found->ai_addr, found->ai_addrlen);
+    *length = found->ai_addrlen;
+    freeaddrinfo(found);
+    return 0;
+}
+
+// A connected socket: wait for one player on 'address' when 'host', or
+// else connect to the one waiting there; -1 with errno set on failure
+static inline int netplayConnect(const char* address, int host) {
+    struct sockaddr_storage storage;
+    socklen_t length;
+    int one = 1;
+
+    if (netplayAddress(address, &storage, &length) == -1) return -1;
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    if (!host) {
+        if (connect(fd, (struct sockaddr*)&storage, length) == -1) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+    } else {
+        const char* path = storage.ss_family == AF_UNIX ? ((struct sockaddr_un*)&storage)->sun_path : NULL;
+        if (path != NULL) unlink(path); // Left behind by an earlier host
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr*)&storage, length) == -1 || listen(fd, 1) == -1) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        printf("Waiting for the other player on %s...\n", address);
+        fflush(stdout);
+        int player = accept(fd, NULL, NULL);
+        int error = errno;
+        if (player != -1) fcntl(player, F_SETFD, FD_CLOEXEC);
+        close(fd);
+        if (path != NULL) unlink(path);
+        errno = error;
+        fd = player;
+        if (fd == -1) return -1;
+    }
+    if (storage.ss_family != AF_UNIX) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Keys are tiny and late ones hurt
+    }
+    return fd;
+}
+
+static inline void netplayInit(Netplay* np, int fd, int player) {
+    memset(np, 0, sizeof(*np));
+    np->fd = fd;
+    np->player = player;
+    np->rollback = UINT64_MAX;
+    vgcRandomSeed(&np->rng, vgcNewSeed());
+}
+
+static inline void netplayClose(Netplay* np) {
+    if (np->fd != -1) close(np->fd);
+    np->fd = -1;
+    for (int i = 0; i < NETPLAY_WINDOW; i++) free(np->saves[i].data);
+    memset(np->saves, 0, sizeof(np->saves));
+    free(np->argv);
+    free(np->args);
+    np->argv = NULL;
+    np->args = NULL;
+}
+
+// Parse "rtt[,jitter]" in milliseconds; returns -1 if it is malformed
+static inline int netplayParseLag(const char* spec, uint64_t* lagNs, uint64_t* jitterNs) {
+    char* end;
+    double rtt = strtod(spec, &end), jitter = 0;
+
+    if (end == spec || rtt < 0) return -1;
+    if (*end == ',') {
+        const char* start = end + 1;
+        jitter = strtod(start, &end);
+        if (end == start || jitter < 0) return -1;
+    }
+    if (*end != '\0') return -1;
+    *lagNs = (uint64_t)(rtt * 1e6);
+    *jitterNs = (uint64_t)(jitter * 1e6);
+    return 0;
+}
+
+// Host 'game' on 'address': wait for the other player and tell them the
+// game, 'seed', 'delay', the lag and the arguments; returns -1 after
+// printing why on failure
+static inline int netplayHost(Netplay* np, const char* address, const VgcGame* game, int argc, char* argv[],
+                              uint64_t seed, int delay, uint64_t lagNs, uint64_t jitterNs) {
+    struct {
+        NetplayMessage message;
+        NetplayHello hello;
+        char args[NETPLAY_HELLO_LENGTH];
+    } out;
+    size_t used = 0;
+
+    memset(&out, 0, sizeof(out));
+    for (int i = 1; i < argc; i++) {
+        size_t length = strlen(argv[i]) + 1;
+        if (used + length > sizeof(out.args)) {
+            fprintf(stderr, "Too many arguments to send to the other player.\n");
+            return -1;
+        }
+        memcpy(out.args + used, argv[i], length);
+        used += length;
+    }
+    int fd = netplayConnect(address, 1);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to host on %s: %s\n", address, strerror(errno));
+        return -1;
+    }
+    netplayInit(np, fd, 0);
+    np->delay = delay;
+    np->lag_ns = lagNs;
+    np->jitter_ns = jitterNs;
+
+    NetplayMessage reply;
+    out.message.type = NETPLAY_HELLO;
+    out.message.length = (uint32_t)(sizeof(out.hello) + used);
+    snprintf(out.hello.name, sizeof(out.hello.name), "%s", game->name);
+    out.hello.seed = seed;
+    out.hello.delay = (uint32_t)delay;
+    out.hello.argc = (uint32_t)(argc - 1);
+    out.hello.lag_ns = lagNs;
+    out.hello.jitter_ns = jitterNs;
+    if (netplayWriteAll(fd, &out, sizeof(out.message) + out.message.length) == -1
+        || netplayReadAll(fd, &reply, sizeof(reply)) == -1 || reply.type != NETPLAY_HELLO) {
+        fprintf(stderr, "The other player did not join.\n");
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Join the game hosted on 'address'; '*argc', '*argv' and '*seed' become
+// the host's, keeping argv[0]. Returns -1 after printing why on failure.
+static inline int netplayJoin(Netplay* np, const char* address, const VgcGame* game, int* argc, char** argv[],
+                              uint64_t* seed) {
+    NetplayMessage message;
+    NetplayHello hello;
+
+    int fd = netplayConnect(address, 0);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to join %s: %s\n", address, strerror(errno));
+        return -1;
+    }
+    netplayInit(np, fd, 1);
+    if (netplayReadAll(fd, &message, sizeof(message)) == -1 || message.type != NETPLAY_HELLO
+        || message.length < sizeof(hello) || message.length > sizeof(hello) + NETPLAY_HELLO_LENGTH
+        || netplayReadAll(fd, &hello, sizeof(hello)) == -1) {
+        fprintf(stderr, "%s is not hosting a game.\n", address);
+        close(fd);
+        return -1;
+    }
+    size_t used = message.length - sizeof(hello);
+    if (hello.argc > used) { // Every argument takes at least its terminating byte
+        fprintf(stderr, "The host sent broken arguments.\n");
+        close(fd);
+        return -1;
+    }
+    np->args = malloc(used + 1);
+    np->argv = calloc((size_t)hello.argc + 2, sizeof(char*));
+    if (np->args == NULL || np->argv == NULL) {
+        perror("Unable to allocate the arguments");
+        exit(EXIT_FAILURE);
+    }
+    np->args[used] = '\0';
+    if (netplayReadAll(fd, np->args, used) == -1) {
+        fprintf(stderr, "The host left.\n");
+        netplayClose(np);
+        return -1;
+    }
+    if (strncmp(hello.name, game->name, sizeof(hello.name)) != 0) {
+        fprintf(stderr, "The host is playing %.*s, not %s.\n", (int)sizeof(hello.name), hello.name, game->name);
+        netplayClose(np);
+        return -1;
+    }
+    if (hello.delay > NETPLAY_WINDOW / 2) {
+        fprintf(stderr, "The host asked for %u ticks of delay, more than %d.\n", hello.delay, NETPLAY_WINDOW / 2);
+        netplayClose(np);
+        return -1;
+    }
+
+    np->argv[0] = (*argv)[0];
+    char* next = np->args;
+    for (uint32_t i = 0; i < hello.argc; i++) {
+        if (next >= np->args + used) {
+            fprintf(stderr, "The host sent broken arguments.\n");
+            netplayClose(np);
+            return -1;
+        }
+        np->argv[i + 1] = next;
+        next += strlen(next) + 1;
+    }
+    *argc = (int)hello.argc + 1;
+    *argv = np->argv;
+    *seed = hello.seed;
+    np->delay = (int)hello.delay;
+    np->lag_ns = hello.lag_ns;
+    np->jitter_ns = hello.jitter_ns;
+
+    memset(&message, 0, sizeof(message));
+    message.type = NETPLAY_HELLO;
+    if (netplayWriteAll(fd, &message, sizeof(message)) == -1) {
+        fprintf(stderr, "The host left.\n");
+        netplayClose(np);
+        return -1;
+    }
+    return 0;
+}
+
+// Send every held-back message due by 'now'
+static inline void netplayFlush(Netplay* np, uint64_t now) {
+    while (np->count > 0 && np->due_ns[np->head] <= now) {
+        if (!np->closed && netplayWriteAll(np->fd, &np->queue[np->head], sizeof(NetplayMessage)) == -1) {
+            np->closed = 1;
+        }
+        np->head = (np->head + 1) % NETPLAY_QUEUE;
+        np->count--;
+    }
+}
+
+// Send 'message' when the lag says it would arrive, never before the
+// message sent ahead of it
+static inline void netplaySend(Netplay* np, const NetplayMessage* message) {
+    uint64_t now = monotonicNs();
+    uint64_t due = now + np->lag_ns / 2;
+
+    if (np->jitter_ns > 0) {
+        uint64_t offset = vgcRandomNext(&np->rng) % (2 * np->jitter_ns + 1);
+        due = due + offset > np->jitter_ns ? due + offset - np->jitter_ns : now;
+    }
+    if (np->count > 0 && due < np->due_ns[(np->head + np->count - 1) % NETPLAY_QUEUE]) {
+        due = np->due_ns[(np->head + np->count - 1) % NETPLAY_QUEUE];
+    }
+    if (np->count == NETPLAY_QUEUE) {
+        netplayFlush(np, np->due_ns[np->head]); // Full: the oldest goes early
+    }
+    unsigned slot = (np->head + np->count) % NETPLAY_QUEUE;
+    np->queue[slot] = *message;
+    np->due_ns[slot] = due;
+    np->count++;
+    netplayFlush(np, now);
+}
+
+static inline void netplaySendValue(Netplay* np, int type, uint64_t tick, uint64_t value) {
+    NetplayMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = (uint32_t)type;
+    message.tick = tick;
+    message.value = value;
+    netplaySend(np, &message);
+}
+
+// Take the next whole message from the other side without blocking;
+// returns 1 for a message, 0 for none yet and -1 once they have left
+static inline int netplayRead(Netplay* np, NetplayMessage* message) {
+    while (np->in_length < sizeof(NetplayMessage)) {
+        ssize_t n = recv(np->fd, np->in + np->in_length, sizeof(NetplayMessage) - np->in_length, MSG_DONTWAIT);
+        if (n > 0) {
+            np->in_length += (size_t)n;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return 0;
+        } else {
+            np->closed = 1;
+            return -1;
+        }
+    }
+    memcpy(message, np->in, sizeof(NetplayMessage));
+    np->in_length = 0;
+    return 1;
+}
+
+// Add a local key to the keys sent with the next tick
+static inline void netplayKey(Netplay* np, char key) {
+    if (np->pending_count < NETPLAY_KEYS && key != '\0') np->pending[np->pending_count++] = key;
+}
+
+// Send the local keys for the next tick, 'delay' ticks ahead of the simulation
+static inline void netplaySendKeys(Netplay* np) {
+    NetplayMessage message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = NETPLAY_INPUT;
+    message.tick = np->sent;
+    memcpy(message.keys, np->pending, NETPLAY_KEYS);
+    memcpy(np->keys[np->player][np->sent % NETPLAY_RING], np->pending, NETPLAY_KEYS);
+    netplaySend(np, &message);
+    np->sent++;
+    memset(np->pending, 0, sizeof(np->pending));
+    np->pending_count = 0;
+}
+
+// Compare the checksums both sides took of the same tick
+static inline void netplayCompare(Netplay* np) {
+    if (np->sync_tick != 0 && np->sync_tick == np->remote_tick && np->sync_sum != np->remote_sum
+        && np->desync == 0) {
+        np->desync = np->sync_tick;
+    }
+}
+
+// React to a message from the other side other than a lockstep KEY
+static inline void netplayHandle(Netplay* np, const NetplayMessage* message) {
+    if (message->type == NETPLAY_INPUT && message->tick == np->confirmed) {
+        int other = 1 - np->player;
+        memcpy(np->keys[other][message->tick % NETPLAY_RING], message->keys, NETPLAY_KEYS);
+        np->confirmed++;
+        // Simulated on the guess that nothing was pressed
+        if (message->tick < np->tick && message->keys[0] != '\0' && message->tick < np->rollback) {
+            np->rollback = message->tick;
+        }
+    } else if (message->type == NETPLAY_SYNC) {
+        np->remote_tick = message->tick;
+        np->remote_sum = message->value;
+        netplayCompare(np);
+    } else if (message->type == NETPLAY_PING) {
+        netplaySendValue(np, NETPLAY_PONG, 0, message->value);
+    } else if (message->type == NETPLAY_PONG) {
+        np->rtt_ns = monotonicNs() - message->value;
+    }
+}
+
+// Simulate the next tick with both players' keys, guessing that the other
+// player pressed nothing when theirs have not arrived; returns 0 once the
+// game is over
+static inline int netplayTick(Netplay* np, const VgcGame* game, void* state) {
+    uint64_t tick = np->tick;
+    NetplaySave* save = &np->saves[tick % NETPLAY_WINDOW];
+    int running = 1;
+
+    save->size = game->save(state, NULL, 0);
+    if (save->size > save->capacity) {
+        free(save->data);
+        save->data = malloc(save->size);
+        if (save->data == NULL) {
+            perror("Unable to allocate a save state");
+            exit(EXIT_FAILURE);
+        }
+        save->capacity = save->size;
+    }
+    if (save->size > 0) game->save(state, save->data, save->size);
+
+    for (int player = 0; player < 2 && running; player++) {
+        if (player != np->player && tick >= np->confirmed) continue;
+        const char* keys = np->keys[player][tick % NETPLAY_RING];
+        for (int i = 0; i < NETPLAY_KEYS && keys[i] != '\0' && running; i++) {
+            running = game->handle_player_input(state, player, keys[i]) != 0;
+        }
+    }
+    if (running) running = game->tick(state);
+    np->tick++;
+    if (!running) np->ended = np->tick;
+    return running;
+}
+
+// Put the game back to before the earliest tick simulated on a wrong
+// guess and simulate up to where it was; returns the new game state, or
+// NULL if the save would not resume
+static inline void* netplayRollback(Netplay* np, const VgcGame* game, void* state) {
+    uint64_t from = np->rollback, to = np->tick;
+    NetplaySave* save = &np->saves[from % NETPLAY_WINDOW];
+    char summary[256];
+    double tickRate = game->tick_rate;
+
+    np->rollback = UINT64_MAX;
+    if (from >= to) return state; // The game ended before it
+    game->shutdown(state, summary, sizeof(summary));
+    state = save->size > 0 ? game->resume(save->data, save->size, &tickRate) : NULL;
+    if (state == NULL) return NULL;
+    game->seat(state, np->player);
+
+    np->tick = from;
+    np->ended = 0;
+    np->rollbacks++;
+    if (to - from > np->max_rollback) np->max_rollback = to - from;
+    while (np->tick < to && netplayTick(np, game, state)) np->resimulated++;
+    return state;
+}
+
+// Take and send checksums of the ticks every key is known for
+static inline void netplayChecksums(Netplay* np) {
+    uint64_t last = np->tick > 0 ? np->tick - 1 : 0;
+    if (np->confirmed < last) last = np->confirmed;
+    if (np->rollback < last) last = np->rollback;
+
+    for (; np->checked <= last; np->checked++) {
+        uint64_t tick = np->checked;
+        NetplaySave* save = &np->saves[tick % NETPLAY_WINDOW];
+        if (tick == 0 || tick % NETPLAY_SYNC_INTERVAL != 0 || tick >= np->tick
+            || tick + NETPLAY_WINDOW <= np->tick || save->size == 0) {
+            continue;
+        }
+        np->sync_tick = tick;
+        np->sync_sum = netplayChecksum(save->data, save->size);
+        netplaySendValue(np, NETPLAY_SYNC, tick, np->sync_sum);
+        netplayCompare(np);
+    }
+}
+
+// Run up to 'due' ticks: roll back first if a guess was wrong, then send
+// the local keys and simulate each tick unless too far ahead of the other
+// player. Returns the game state, which a rollback replaces, or NULL if
+// it could not roll back.
+static inline void* netplayAdvance(Netplay* np, const VgcGame* game, void* state, int due) {
+    if (np->rollback != UINT64_MAX) {
+        state = netplayRollback(np, game, state);
+        if (state == NULL) return NULL;
+    }
+    np->waiting = 0;
+    for (int i = 0; i < due && np->ended == 0; i++) {
+        if (np->tick + np->delay >= np->confirmed + NETPLAY_WINDOW) {
+            np->waiting = 1;
+            np->stalls += (unsigned long)(due - i);
+            break;
+        }
+        netplaySendKeys(np);
+        netplayTick(np, game, state);
+    }
+    netplayChecksums(np);
+    return state;
+}
+
+// Has the game ended on a tick both players' keys are known for?
+static inline int netplayOver(const Netplay* np) {
+    return np->ended != 0 && np->ended <= np->confirmed && np->rollback == UINT64_MAX;
+}
+
+// One line on the screen's last row, which games leave empty
+static inline void netplayStatus(const Netplay* np, Renderer* screen, int rollback) {
+    char state[64] = "";
+
+    if (np->left) {
+        snprintf(state, sizeof(state), " | the other player left");
+    } else if (np->desync != 0) {
+        snprintf(state, sizeof(state), " | OUT OF SYNC at tick %llu", (unsigned long long)np->desync);
+    } else if (np->waiting) {
+        snprintf(state, sizeof(state), " | waiting for the other player");
+    }
+    if (!rollback) {
+        rendererText(screen, screen->rows - 1, 0, "Player %d of 2 | rtt %.0f ms%s", np->player + 1,
+                     np->rtt_ns / 1e6, state);
+        return;
+    }
+    rendererText(screen, screen->rows - 1, 0, "Player %d of 2 | rtt %.0f ms | %lu rollbacks, up to %llu ticks%s",
+                 np->player + 1, np->rtt_ns / 1e6, np->rollbacks, (unsigned long long)np->max_rollback, state);
+}
+
+// Play 'game' with the other player on 'screen' until it ends, either
+// player quits or the other player leaves; returns the final game state,
+// NULL if a rollback failed
+static inline void* netplayRun(Netplay* np, const VgcGame* game, void* state, double tickRate,
+                               Renderer* screen, TickLoop* loop) {
+    InputParser parser;
+    InputQueue queue;
+    InputEvent event;
+    NetplayMessage message;
+    char input[64];
+    size_t inputLength;
+    uint64_t lastPing = 0;
+    int rollback = tickRate > 0;
+    int running = 1;
+
+    if (tickLoopInit(loop, tickRate) == -1) return state;
+    loop->wake_fd = np->fd;
+    inputParserInit(&parser, game->arrows);
+    inputQueueInit(&queue);
+    inputQueueCoalesce(&queue, rollback ? game->arrows : NULL);
+    while (rollback && np->sent < (uint64_t)np->delay) netplaySendKeys(np); // Nobody pressed anything yet
+
+    while (running) {
+        rendererClear(screen);
+        game->render(state, screen);
+        netplayStatus(np, screen, rollback);
+        rendererPresent(screen);
+        tickLoopPresented(loop);
+
+        loop->wake_ns = np->count > 0 ? np->due_ns[np->head] : 0;
+        int due = tickLoopWait(loop, STDIN_FILENO, input, sizeof(input), &inputLength);
+        uint64_t now = monotonicNs();
+        if (now - lastPing >= NETPLAY_PING_NS) {
+            netplaySendValue(np, NETPLAY_PING, 0, now);
+            lastPing = now;
+        }
+        netplayFlush(np, now);
+
+        // The other player's messages
+        while (running && netplayRead(np, &message) == 1) {
+            if (message.type == NETPLAY_KEY && !rollback) {
+                running = game->handle_player_input(state, 1 - np->player, message.keys[0]) != 0;
+            } else {
+                netplayHandle(np, &message);
+            }
+        }
+
+        // Local keys
+        inputFeed(&parser, &queue, input, inputLength, now);
+        inputFlush(&parser, &queue, now);
+        while (running && inputQueuePop(&queue, &event)) {
+            if (!rollback) {
+                int handled = game->handle_player_input(state, np->player, event.key);
+                if (handled != -1) {
+                    memset(&message, 0, sizeof(message));
+                    message.type = NETPLAY_KEY;
+                    message.keys[0] = event.key;
+                    netplaySend(np, &message);
+                }
+                running = handled != 0;
+            } else if (event.key == 'q' && (np->waiting || np->closed)) {
+                running = 0; // Nothing moves without the other player, so leave now
+            } else {
+                netplayKey(np, event.key);
+            }
+        }
+
+        if (running && rollback) {
+            // Once the other side has gone, play out the ticks it sent
+            if (np->closed && np->tick < np->confirmed) due = (int)(np->confirmed - np->tick);
+            state = netplayAdvance(np, game, state, due);
+            if (state == NULL) break;
+            running = !netplayOver(np);
+        }
+        if (running && (np->closed || !loop->input_open)) {
+            np->left = np->closed;
+            running = 0;
+        }
+    }
+
+    if (state != NULL) {
+        rendererClear(screen);
+        game->render(state, screen);
+        netplayStatus(np, screen, rollback);
+        rendererPresent(screen);
+    }
+    netplayFlush(np, UINT64_MAX); // The other side needs our last keys to end the game too
+    tickLoopClose(loop);
+    loop->keys = queue.keys;
+    loop->coalesced = queue.coalesced;
+    return state;
+}
+
+// Print how the session went
+static inline void netplayReport(const Netplay* np, int rollback) {
+    printf("\nNetplay as player %d: rtt %.1f ms", np->player + 1, np->rtt_ns / 1e6);
+    if (rollback) {
+        printf(", %llu ticks, %lu rollbacks (up to %llu ticks, %lu ticks simulated again), %lu ticks waited, %s",
+               (unsigned long long)np->tick, np->rollbacks, (unsigned long long)np->max_rollback,
+               np->resimulated, np->stalls, np->desync != 0 ? "OUT OF SYNC" : "in sync");
+    }
+    printf("%s\n", np->left ? "; the other player left" : "");
+}
+
+#endif
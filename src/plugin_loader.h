@@ -0,0 +1,107 @@
+#ifndef PLUGIN_LOADER_H
+#define PLUGIN_LOADER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include "catalog.h"
+#include "vgc_plugin.h"
+
+// Loads game plugins ("<game>.so" next to the game executable) into the
+// console. A plugin is dlopen()ed on first use and kept loaded; when the .so
+// file has been replaced since, it is closed and loaded again, so a rebuilt
+// game is picked up without restarting the console. Install new builds with
+// a rename (build to a temporary name, then mv) rather than overwriting the
+// loaded file in place.
+
+typedef struct {
+    char path[MAX_PATH_LENGTH + 4];
+    void* handle;
+    const VgcGame* game;
+    int64_t mtime_ns;     // Identity of the file that was loaded
+    ino_t inode;
+} LoadedPlugin;
+
+typedef struct {
+    LoadedPlugin* plugins; // Grows as games are first played
+    int count;
+    int capacity;
+} PluginCache;
+
+static inline void pluginUnload(LoadedPlugin* plugin) {
+    if (plugin->handle != NULL) dlclose(plugin->handle);
+    plugin->handle = NULL;
+    plugin->game = NULL;
+}
+
+// The plugin at 'path', or NULL if there is none or it cannot be loaded.
+// '*error' receives the reason for a failed load, or NULL.
+static inline const VgcGame* pluginOpen(PluginCache* cache, const char* path, const char** error) {
+    struct stat st;
+    LoadedPlugin* plugin = NULL;
+
+    *error = NULL;
+    if (stat(path, &st) == -1) return NULL;
+
+    for (int i = 0; i < cache->count; i++) {
+        if (strcmp(cache->plugins[i].path, path) == 0) {
+            plugin = &cache->plugins[i];
+            break;
+        }
+    }
+    if (plugin == NULL) {
+        if (cache->count == cache->capacity) {
+            int capacity = cache->capacity > 0 ? cache->capacity * 2 : 16;
+            LoadedPlugin* plugins = realloc(cache->plugins, sizeof(LoadedPlugin) * capacity);
+            if (plugins == NULL) return NULL;
+            cache->plugins = plugins;
+            cache->capacity = capacity;
+        }
+        plugin = &cache->plugins[cache->count++];
+        memset(plugin, 0, sizeof(*plugin));
+        snprintf(plugin->path, sizeof(plugin->path), "%s", path);
+    }
+
+    if (plugin->handle != NULL) {
+        if (plugin->mtime_ns == statMtimeNs(&st) && plugin->inode == st.st_ino) {
+            return plugin->game;
+        }
+        pluginUnload(plugin); // Rebuilt since it was loaded
+    }
+
+    plugin->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (plugin->handle == NULL) {
+        *error = dlerror();
+        return NULL;
+    }
+    plugin->game = dlsym(plugin->handle, VGC_PLUGIN_SYMBOL);
+    if (plugin->game == NULL || plugin->game->abi != VGC_PLUGIN_ABI) {
+        *error = "incompatible plugin";
+        pluginUnload(plugin);
+        return NULL;
+    }
+    plugin->mtime_ns = statMtimeNs(&st);
+    plugin->inode = st.st_ino;
+    return plugin->game;
+}
+
+// The plugin next to the executable of 'entry'
+static inline const VgcGame* pluginLoad(PluginCache* cache, const GameEntry* entry, const char** error) {
+    char path[MAX_PATH_LENGTH + 4];
+
+    snprintf(path, sizeof(path), "%s.so", entry->path);
+    return pluginOpen(cache, path, error);
+}
+
+static inline void pluginUnloadAll(PluginCache* cache) {
+    for (int i = 0; i < cache->count; i++) {
+        pluginUnload(&cache->plugins[i]);
+    }
+    free(cache->plugins);
+    cache->plugins = NULL;
+    cache->count = cache->capacity = 0;
+}
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Prefetching the highlighted game.
+//
+// Games are started cold from the game directory, typically the ext4 image
+// startup.sh mounts through a loop device, and the first launch of each one
+// waits for its pages to come in. While a title is highlighted, a
+// background thread reads its executable, its plugin and the shared
+// libraries the executable needs into the page cache instead, so that the
+// launch finds them there.
+//
+// Every request replaces the one before. The thread only starts once a
+// request has stood for PREFETCH_SETTLE_NS, so titles scrolled past cost
+// nothing, and it checks between chunks of PREFETCH_CHUNK bytes whether a
+// newer request came in, dropping the rest of the old one if so. Chunks go
+// through readahead(), which fills the page cache without copying anything
+// into this process. A cartridge entry is a byte range of the cartridge.
+//
+// The libraries are the executable's program interpreter and DT_NEEDED
+// entries, looked for in the directories of the libraries this process has
+// loaded and the usual system ones; RPATH and RUNPATH are not followed.
+//
+// readahead() needs _GNU_SOURCE, defined before the first #include. Build
+// with -pthread.
+
+#define PREFETCH_CHUNK (256 * 1024)     // Bytes read ahead between checks for a newer request
+#define PREFETCH_SETTLE_NS 100000000ull // How long a title stays highlighted before it is read
+#define PREFETCH_RANGES 4               // Files per request
+#define PREFETCH_LIBRARIES 32           // Libraries followed per executable
+#define PREFETCH_DIRS 16                // Directories libraries are looked for in
+#define PREFETCH_PATH_LENGTH 1024         // Room for a game path and a suffix
+#define PREFETCH_MAX_PHDRS 64
+#define PREFETCH_MAX_DYNAMIC (64 * 1024) // Bytes of dynamic section and string table read
+
+typedef struct {
+    char path[PREFETCH_PATH_LENGTH];
+    uint64_t offset, length;      // Byte range of the file; length 0 runs to its end
+} PrefetchRange;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    PrefetchRange pending[PREFETCH_RANGES]; // The latest request
+    int pending_count;
+    int has_pending;
+    int started;
+    int stop;
+    unsigned long generation;     // Requests made; atomic, so the thread sees a newer one mid-file
+    char dirs[PREFETCH_DIRS][PREFETCH_PATH_LENGTH];
+    int dir_count;
+
+    // Atomic statistics
+    unsigned long finished;       // Requests read ahead in full
+    unsigned long canceled;       // Requests replaced before they were
+    uint64_t bytes;               // Read ahead in all
+} Prefetcher;
+
+// Look for libraries in 'dir' too
+static inline void prefetchAddDir(Prefetcher* pf, const char* dir, size_t length) {
+    if (length == 0 || length >= PREFETCH_PATH_LENGTH || pf->dir_count == PREFETCH_DIRS) return;
+    for (int i = 0; i < pf->dir_count; i++) {
+        if (strlen(pf->dirs[i]) == length && memcmp(pf->dirs[i], dir, length) == 0) return;
+    }
+    memcpy(pf->dirs[pf->dir_count], dir, length);
+    pf->dirs[pf->dir_count++][length] = '\0';
+}
+
+static inline int prefetchLoadedDir(struct dl_phdr_info* info, size_t size, void* arg) {
+    const char* slash = strrchr(info->dlpi_name, '/');
+    (void)size;
+    if (slash != NULL) prefetchAddDir(arg, info->dlpi_name, (size_t)(slash - info->dlpi_name));
+    return 0;
+}
+
+// Set up without starting the thread; prefetchRun() then reads ahead on
+// the caller's thread
+static inline void prefetchInit(Prefetcher* pf) {
+    static const char* systemDirs[] = { "/lib64", "/usr/lib64", "/lib", "/usr/lib", "/usr/local/lib" };
+
+    memset(pf, 0, sizeof(*pf));
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->wake, NULL);
+    dl_iterate_phdr(prefetchLoadedDir, pf); // Where this system keeps libc and friends
+    for (size_t i = 0; i < sizeof(systemDirs) / sizeof(systemDirs[0]); i++) {
+        prefetchAddDir(pf, systemDirs[i], strlen(systemDirs[i]));
+    }
+}
+
+// File offset of virtual address 'address' in an ELF file, or -1
+static inline int64_t prefetchElfOffset(const Elf64_Phdr* phdrs, int count, uint64_t address) {
+    for (int i = 0; i < count; i++) {
+        if (phdrs[i].p_type == PT_LOAD && address >= phdrs[i].p_vaddr
+            && address < phdrs[i].p_vaddr + phdrs[i].p_filesz) {
+            return (int64_t)(address - phdrs[i].p_vaddr + phdrs[i].p_offset);
+        }
+    }
+    return -1;
+}
+
+// The program interpreter and needed libraries of the 64-bit ELF file in
+// bytes [base, base + size) of 'fd', as paths or bare names, into
+// 'libraries'; returns how many
+static inline int prefetchElfLibraries(int fd, uint64_t base, uint64_t size,
+                                       char libraries[][PREFETCH_PATH_LENGTH]) {
+    Elf64_Ehdr header;
+    Elf64_Phdr phdrs[PREFETCH_MAX_PHDRS];
+    const Elf64_Phdr* dynamic = NULL;
+    int count = 0;
+
+    if (size < sizeof(header) || pread(fd, &header, sizeof(header), (off_t)base) != (ssize_t)sizeof(header)
+        || memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 || header.e_ident[EI_CLASS] != ELFCLASS64
+        || header.e_phentsize != sizeof(Elf64_Phdr) || header.e_phnum > PREFETCH_MAX_PHDRS) {
+        return 0;
+    }
+    size_t phdrBytes = (size_t)header.e_phnum * sizeof(Elf64_Phdr);
+    if (header.e_phoff > size || phdrBytes > size - header.e_phoff
+        || pread(fd, phdrs, phdrBytes, (off_t)(base + header.e_phoff)) != (ssize_t)phdrBytes) {
+        return 0;
+    }
+
+    for (int i = 0; i < header.e_phnum; i++) {
+        const Elf64_Phdr* phdr = &phdrs[i];
+        if (phdr->p_type == PT_DYNAMIC) dynamic = phdr;
+        if (phdr->p_type == PT_INTERP && phdr->p_filesz < PREFETCH_PATH_LENGTH && phdr->p_offset < size
+            && phdr->p_filesz <= size - phdr->p_offset && count < PREFETCH_LIBRARIES) {
+            ssize_t n = pread(fd, libraries[count], phdr->p_filesz, (off_t)(base + phdr->p_offset));
+            if (n > 0) {
+                libraries[count][n] = '\0';
+                count++;
+            }
+        }
+    }
+    if (dynamic == NULL || dynamic->p_filesz > PREFETCH_MAX_DYNAMIC || dynamic->p_offset > size
+        || dynamic->p_filesz > size - dynamic->p_offset) {
+        return count;
+    }
+
+    // The dynamic section names the libraries by offsets into its string table
+    Elf64_Dyn* entries = malloc(dynamic->p_filesz + 1);
+    char* strings = NULL;
+    size_t entryCount = dynamic->p_filesz / sizeof(Elf64_Dyn);
+    uint64_t table = 0, tableSize = 0;
+    if (entries == NULL
+        || pread(fd, entries, dynamic->p_filesz, (off_t)(base + dynamic->p_offset)) != (ssize_t)dynamic->p_filesz) {
+        free(entries);
+        return count;
+    }
+    for (size_t i = 0; i < entryCount && entries[i].d_tag != DT_NULL; i++) {
+        if (entries[i].d_tag == DT_STRTAB) table = entries[i].d_un.d_ptr;
+        if (entries[i].d_tag == DT_STRSZ) tableSize = entries[i].d_un.d_val;
+    }
+    int64_t tableOffset = prefetchElfOffset(phdrs, header.e_phnum, table);
+    if (tableOffset >= 0 && tableSize > 0 && tableSize <= PREFETCH_MAX_DYNAMIC && (uint64_t)tableOffset < size
+        && tableSize <= size - (uint64_t)tableOffset && (strings = malloc(tableSize + 1)) != NULL
+        && pread(fd, strings, tableSize, (off_t)(base + (uint64_t)tableOffset)) == (ssize_t)tableSize) {
+        strings[tableSize] = '\0';
+        for (size_t i = 0; i < entryCount && entries[i].d_tag != DT_NULL && count < PREFETCH_LIBRARIES; i++) {
+            if (entries[i].d_tag == DT_NEEDED && entries[i].d_un.d_val < tableSize) {
+                snprintf(libraries[count++], PREFETCH_PATH_LENGTH, "%s", strings + entries[i].d_un.d_val);
+            }
+        }
+    }
+    free(strings);
+    free(entries);
+    return count;
+}
+
+// Read bytes [offset, offset + length) of 'fd' ahead a chunk at a time;
+// returns -1 as soon as a request newer than 'generation' comes in
+static inline int prefetchChunks(Prefetcher* pf, int fd, uint64_t offset, uint64_t length,
+                                 unsigned long generation) {
+    for (uint64_t done = 0; done < length; done += PREFETCH_CHUNK) {
+        if (__atomic_load_n(&pf->generation, __ATOMIC_ACQUIRE) != generation) return -1;
+        uint64_t chunk = length - done < PREFETCH_CHUNK ? length - done : PREFETCH_CHUNK;
+        if (readahead(fd, (off64_t)(offset + done), (size_t)chunk) == -1) {
+            posix_fadvise(fd, (off_t)(offset + done), (off_t)chunk, POSIX_FADV_WILLNEED); // No readahead() here
+        }
+        __atomic_add_fetch(&pf->bytes, chunk, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+// Read bytes [offset, offset + length) of 'path' ahead, to its end for
+// length 0, and for an executable the libraries it needs; returns -1 if a
+// newer request came in first. Files that are missing are skipped.
+static inline int prefetchFile(Prefetcher* pf, const char* path, uint64_t offset, uint64_t length,
+                               int followLibraries, unsigned long generation) {
+    char libraries[PREFETCH_LIBRARIES][PREFETCH_PATH_LENGTH];
+    char library[2 * PREFETCH_PATH_LENGTH];
+    struct stat st;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return 0;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || offset > (uint64_t)st.st_size) {
+        close(fd);
+        return 0;
+    }
+    if (length == 0 || length > (uint64_t)st.st_size - offset) length = (uint64_t)st.st_size - offset;
+    int result = prefetchChunks(pf, fd, offset, length, generation);
+    int count = result == 0 && followLibraries ? prefetchElfLibraries(fd, offset, length, libraries) : 0;
+    close(fd);
+
+    for (int i = 0; i < count && result == 0; i++) {
+        const char* name = libraries[i];
+        if (strchr(name, '/') != NULL) {
+            result = prefetchFile(pf, name, 0, 0, 0, generation);
+            continue;
+        }
+        for (int d = 0; d < pf->dir_count; d++) {
+            const char* dir = pf->dirs[d];
+            if (snprintf(library, sizeof(library), "%s/%s", dir, name) < (int)sizeof(library)
+                && access(library, R_OK) == 0) {
+                result = prefetchFile(pf, library, 0, 0, 0, generation);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// Read 'count' ranges ahead on the calling thread, the first one's
+// libraries too; returns -1 if a request newer than 'generation' stopped it
+static inline int prefetchRun(Prefetcher* pf, const PrefetchRange* ranges, int count, unsigned long generation) {
+    for (int i = 0; i < count; i++) {
+        const PrefetchRange* range = &ranges[i];
+        if (prefetchFile(pf, range->path, range->offset, range->length, i == 0, generation) == -1) return -1;
+    }
+    return 0;
+}
+
+static inline void* prefetchThread(void* arg) {
+    Prefetcher* pf = arg;
+    PrefetchRange ranges[PREFETCH_RANGES];
+
+    pthread_mutex_lock(&pf->lock);
+    for (;;) {
+        while (!pf->has_pending && !pf->stop) {
+            pthread_cond_wait(&pf->wake, &pf->lock);
+        }
+        if (pf->stop) break;
+
+        int count = pf->pending_count;
+        unsigned long generation = pf->generation;
+        memcpy(ranges, pf->pending, (size_t)count * sizeof(PrefetchRange));
+        pf->has_pending = 0;
+
+        // Wait for the selection to settle
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t)(PREFETCH_SETTLE_NS / 1000000000ull);
+        deadline.tv_nsec += (long)(PREFETCH_SETTLE_NS % 1000000000ull);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!pf->stop && pf->generation == generation
+               && pthread_cond_timedwait(&pf->wake, &pf->lock, &deadline) != ETIMEDOUT) {
+        }
+        if (pf->stop) break;
+        if (pf->generation != generation) {
+            pf->canceled++;
+            continue;
+        }
+        pthread_mutex_unlock(&pf->lock);
+
+        int result = prefetchRun(pf, ranges, count, generation);
+
+        pthread_mutex_lock(&pf->lock);
+        if (result == 0) pf->finished++;
+        else pf->canceled++;
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+// Set up and start the thread; returns -1 if it cannot start
+static inline int prefetchStart(Prefetcher* pf) {
+    prefetchInit(pf);
+    if (pthread_create(&pf->thread, NULL, prefetchThread, pf) != 0) {
+        return -1;
+    }
+    pf->started = 1;
+    return 0;
+}
+
+// Read 'count' ranges ahead once nothing newer has been asked for in
+// PREFETCH_SETTLE_NS, dropping whatever was asked for before; 0 ranges
+// only cancels
+static inline void prefetchRequest(Prefetcher* pf, const PrefetchRange* ranges, int count) {
+    if (count > PREFETCH_RANGES) count = PREFETCH_RANGES;
+    pthread_mutex_lock(&pf->lock);
+    if (count > 0) memcpy(pf->pending, ranges, (size_t)count * sizeof(PrefetchRange));
+    pf->pending_count = count;
+    pf->has_pending = count > 0;
+    __atomic_add_fetch(&pf->generation, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&pf->wake);
+    pthread_mutex_unlock(&pf->lock);
+}
+
+// Stop the thread, abandoning what it was reading
+static inline void prefetchStop(Prefetcher* pf) {
+    if (pf->started) {
+        pthread_mutex_lock(&pf->lock);
+        pf->stop = 1;
+        __atomic_add_fetch(&pf->generation, 1, __ATOMIC_RELEASE);
+        pthread_cond_signal(&pf->wake);
+        pthread_mutex_unlock(&pf->lock);
+        pthread_join(pf->thread, NULL);
+        pf->started = 0;
+    }
+    pthread_mutex_destroy(&pf->lock);
+    pthread_cond_destroy(&pf->wake);
+}
+
+#endif
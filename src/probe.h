@@ -0,0 +1,226 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Per-frame instrumentation exported through shared memory.
+//
+// Every instrumented loop owns a ring of PROBE_CAPACITY frame samples in a
+// POSIX shared-memory object named "/vgc-probe-<pid>-<n>". The loop is the
+// only writer and never waits: each slot carries a sequence number that is
+// cleared before the slot is rewritten and set after, and the ring's head is
+// published last, so a reader (vgc_top) copies slots without any lock and
+// drops the ones that changed under it. A reader that falls more than a ring
+// behind just loses samples; the game never notices it.
+//
+// A frame costs a few clock_gettime() calls (vDSO, no syscall) and one slot
+// write. Set VGC_PROBE=0 to turn probes off.
+
+#define PROBE_MAGIC "VPRB"
+#define PROBE_VERSION 1
+#define PROBE_CAPACITY 1024 // Power of two
+#define PROBE_PREFIX "vgc-probe-"
+#define PROBE_SHM_DIR "/dev/shm"
+
+typedef struct {
+    uint64_t seq;           // Frame number + 1 once the slot is complete, 0 while written
+    uint64_t start_ns;      // CLOCK_MONOTONIC start of the frame
+    uint32_t render_ns;     // Drawing into the back buffer
+    uint32_t write_ns;      // Diffing and writing to the terminal
+    uint32_t wait_ns;       // Asleep in poll() until input or a tick
+    uint32_t input_ns;      // Handling keys
+    uint32_t sim_ns;        // Running ticks
+    uint32_t bytes;         // Written to the terminal
+    uint32_t syscalls;
+    uint32_t ticks;         // Simulation steps run
+} ProbeSample;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t pid;
+    uint32_t capacity;
+    char name[32];          // What is being measured
+    uint64_t head;          // Frames published; read and written atomically
+    uint64_t reserved;
+} ProbeHeader;
+
+typedef struct {
+    ProbeHeader header;
+    ProbeSample samples[PROBE_CAPACITY];
+} ProbeRing;
+
+// Writer side
+typedef struct {
+    ProbeRing* ring;        // NULL when probes are off
+    char shm_name[64];
+    uint64_t mark_ns;       // End of the previous lap
+    ProbeSample frame;      // Frame being measured
+} Probe;
+
+static inline uint64_t probeClockNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Create the ring for 'name'; the probe stays off (and every call a no-op)
+// when VGC_PROBE=0 or the shared memory cannot be set up
+static inline void probeOpen(Probe* probe, const char* name) {
+    static int rings = 0;
+    const char* enabled = getenv("VGC_PROBE");
+
+    memset(probe, 0, sizeof(*probe));
+    if (enabled != NULL && strcmp(enabled, "0") == 0) {
+        return;
+    }
+
+    snprintf(probe->shm_name, sizeof(probe->shm_name), "/%s%d-%d", PROBE_PREFIX, (int)getpid(), rings++);
+    int fd = shm_open(probe->shm_name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        return;
+    }
+    if (ftruncate(fd, sizeof(ProbeRing)) == -1) {
+        close(fd);
+        shm_unlink(probe->shm_name);
+        return;
+    }
+    void* map = mmap(NULL, sizeof(ProbeRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(probe->shm_name);
+        return;
+    }
+
+    probe->ring = map;
+    ProbeHeader* header = &probe->ring->header;
+    header->version = PROBE_VERSION;
+    header->pid = (int32_t)getpid();
+    header->capacity = PROBE_CAPACITY;
+    snprintf(header->name, sizeof(header->name), "%s", name);
+    __atomic_store_n(&header->head, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(header->magic, PROBE_MAGIC, 4); // Valid from here on
+}
+
+static inline void probeClose(Probe* probe) {
+    if (probe->ring == NULL) return;
+    munmap(probe->ring, sizeof(ProbeRing));
+    shm_unlink(probe->shm_name);
+    probe->ring = NULL;
+}
+
+// Start measuring a frame
+static inline void probeBegin(Probe* probe) {
+    if (probe->ring == NULL) return;
+    memset(&probe->frame, 0, sizeof(probe->frame));
+    probe->mark_ns = probeClockNs();
+    probe->frame.start_ns = probe->mark_ns;
+}
+
+// Time since the previous lap (or probeBegin()), e.g.
+// probeLap(&probe, &probe.frame.render_ns)
+static inline void probeLap(Probe* probe, uint32_t* field) {
+    if (probe->ring == NULL) return;
+    uint64_t now = probeClockNs();
+    uint64_t elapsed = now - probe->mark_ns;
+    *field = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    probe->mark_ns = now;
+}
+
+// Publish the frame with its output and syscall counts
+static inline void probeEnd(Probe* probe, unsigned long bytes, unsigned long syscalls, unsigned ticks) {
+    if (probe->ring == NULL) return;
+    ProbeHeader* header = &probe->ring->header;
+    uint64_t frame = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+    ProbeSample* slot = &probe->ring->samples[frame & (PROBE_CAPACITY - 1)];
+
+    probe->frame.bytes = (uint32_t)bytes;
+    probe->frame.syscalls = (uint32_t)syscalls;
+    probe->frame.ticks = ticks;
+
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char*)slot + sizeof(slot->seq), (char*)&probe->frame + sizeof(slot->seq),
+           sizeof(ProbeSample) - sizeof(slot->seq));
+    __atomic_store_n(&slot->seq, frame + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->head, frame + 1, __ATOMIC_RELEASE);
+}
+
+// Reader side
+typedef struct {
+    const ProbeRing* ring;
+    uint64_t cursor;        // Next frame to read
+    unsigned long lost;     // Frames overwritten before they were read
+} ProbeReader;
+
+// Map the ring in shared-memory object 'shmName' read-only; returns -1 if
+// it is not a probe ring
+static inline int probeAttach(ProbeReader* reader, const char* shmName) {
+    struct stat st;
+
+    memset(reader, 0, sizeof(*reader));
+    int fd = shm_open(shmName, O_RDONLY, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ProbeRing)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, sizeof(ProbeRing), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    const ProbeRing* ring = map;
+    if (memcmp(ring->header.magic, PROBE_MAGIC, 4) != 0 || ring->header.version != PROBE_VERSION
+        || ring->header.capacity != PROBE_CAPACITY) {
+        munmap(map, sizeof(ProbeRing));
+        return -1;
+    }
+    reader->ring = ring;
+    reader->cursor = __atomic_load_n(&ring->header.head, __ATOMIC_ACQUIRE); // Only new frames
+    return 0;
+}
+
+static inline void probeDetach(ProbeReader* reader) {
+    if (reader->ring != NULL) munmap((void*)reader->ring, sizeof(ProbeRing));
+    reader->ring = NULL;
+}
+
+// Copy up to 'max' frames published since the last read into 'out';
+// returns how many were copied
+static inline size_t probeRead(ProbeReader* reader, ProbeSample* out, size_t max) {
+    uint64_t head = __atomic_load_n(&reader->ring->header.head, __ATOMIC_ACQUIRE);
+    size_t count = 0;
+
+    if (head - reader->cursor > PROBE_CAPACITY) {
+        reader->lost += head - reader->cursor - PROBE_CAPACITY;
+        reader->cursor = head - PROBE_CAPACITY;
+    }
+    while (reader->cursor < head && count < max) {
+        const ProbeSample* slot = &reader->ring->samples[reader->cursor & (PROBE_CAPACITY - 1)];
+        uint64_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        out[count] = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        if (before == reader->cursor + 1 && after == before) {
+            count++;
+        } else {
+            reader->lost++; // Rewritten while we copied it
+        }
+        reader->cursor++;
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "spectator.h"
+
+// Double-buffered terminal renderer shared by the console and the games.
+//
+// Each frame is drawn into the back buffer. rendererPresent() compares it
+// with the front buffer (what the terminal currently shows), emits ANSI
+// cursor-positioning sequences for the cells that changed only, and hands
+// the whole frame to the terminal with a single write(). This replaces the
+// old system("clear") + one printf per cell approach.
+//
+// With VGC_SPECTATE=<name> in the environment, every frame presented is
+// also published for spectators (spectator.h): the changed runs found for
+// the terminal become the delta, and full repaints become keyframes.
+
+// Unchanged cells shorter than this between two changed runs are re-sent
+// rather than skipped: a cursor jump costs more bytes than a few cells.
+#define RENDER_MERGE_GAP 6
+
+// Per-frame cost counters
+typedef struct {
+    unsigned long frames;
+    unsigned long bytes;    // Bytes handed to write()
+    unsigned long syscalls; // write() calls issued
+} RenderStats;
+
+typedef struct {
+    int fd;             // Output terminal
+    int rows, cols;     // Frame size in cells
+    char* front;        // What the terminal is showing
+    char* back;         // The frame being drawn
+    char* out;          // Escape-sequence output buffer
+    size_t out_len, out_cap;
+    int full_redraw;    // Clear the screen and repaint everything next frame
+    int launch_fd;      // Where to report the first frame to the console, or -1
+    int nonblocking;    // 'fd' is a non-blocking socket: keep what it refuses
+    RenderStats last;   // Cost of the most recent frame
+    RenderStats total;  // Cost since rendererInit()
+    SpectatorProducer* spectators; // Broadcasting the frames, or NULL
+} Renderer;
+
+// Grow the output buffer so that at least 'extra' more bytes fit
+static inline void rendererReserve(Renderer* r, size_t extra) {
+    if (r->out_len + extra <= r->out_cap) return;
+
+    size_t cap = r->out_cap ? r->out_cap : 4096;
+    while (cap < r->out_len + extra) cap *= 2;
+    char* out = realloc(r->out, cap);
+    if (out == NULL) {
+        perror("Unable to allocate render buffer");
+        exit(EXIT_FAILURE);
+    }
+    r->out = out;
+    r->out_cap = cap;
+}
+
+static inline void rendererEmit(Renderer* r, const char* bytes, size_t len) {
+    rendererReserve(r, len);
+    memcpy(r->out + r->out_len, bytes, len);
+    r->out_len += len;
+}
+
+// Append a cursor move to 1-based (row, col)
+static inline void rendererMoveTo(Renderer* r, int row, int col) {
+    char seq[32];
+    int len = snprintf(seq, sizeof(seq), "\x1b[%d;%dH", row, col);
+    rendererEmit(r, seq, (size_t)len);
+}
+
+// Resize the frame; the next present repaints the whole screen
+static inline void rendererResize(Renderer* r, int rows, int cols) {
+    size_t cells = (size_t)rows * (size_t)cols;
+    char* front = realloc(r->front, cells ? cells : 1);
+    char* back = realloc(r->back, cells ? cells : 1);
+    if (front == NULL || back == NULL) {
+        perror("Unable to allocate render buffer");
+        exit(EXIT_FAILURE);
+    }
+    r->front = front;
+    r->back = back;
+    r->rows = rows;
+    r->cols = cols;
+    memset(r->front, ' ', cells);
+    memset(r->back, ' ', cells);
+    r->full_redraw = 1;
+}
+
+// Resize only when the frame size actually changes
+static inline void rendererEnsureSize(Renderer* r, int rows, int cols) {
+    if (r->rows != rows || r->cols != cols) rendererResize(r, rows, cols);
+}
+
+// Query the terminal size, falling back to 24x80 when it is unknown
+static inline void terminalSize(int* rows, int* cols) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+    } else {
+        *rows = 24;
+        *cols = 80;
+    }
+}
+
+// Initialize a renderer of the given size writing to standard output
+static inline void rendererInit(Renderer* r, int rows, int cols) {
+    const char* launch = getenv("VGC_LAUNCH_FD");
+
+    memset(r, 0, sizeof(*r));
+    r->fd = STDOUT_FILENO;
+    r->launch_fd = launch != NULL ? atoi(launch) : -1;
+    unsetenv("VGC_LAUNCH_FD");
+    rendererResize(r, rows, cols);
+
+    // Broadcast unless another renderer already does under this name
+    const char* spectate = getenv("VGC_SPECTATE");
+    if (spectate != NULL && spectate[0] != '\0') {
+        r->spectators = malloc(sizeof(SpectatorProducer));
+        if (r->spectators != NULL && spectatorStart(r->spectators, spectate) == -1) {
+            free(r->spectators);
+            r->spectators = NULL;
+        }
+    }
+}
+
+static inline void rendererFree(Renderer* r) {
+    if (r->spectators != NULL) {
+        spectatorStop(r->spectators);
+        free(r->spectators);
+    }
+    free(r->front);
+    free(r->back);
+    free(r->out);
+    memset(r, 0, sizeof(*r));
+}
+
+// Forget what the terminal shows, e.g. after another program drew on it
+static inline void rendererInvalidate(Renderer* r) {
+    r->full_redraw = 1;
+}
+
+// Blank the back buffer
+static inline void rendererClear(Renderer* r) {
+    memset(r->back, ' ', (size_t)r->rows * (size_t)r->cols);
+}
+
+// Draw a single cell; out-of-frame cells are ignored
+static inline void rendererPut(Renderer* r, int row, int col, char ch) {
+    if (row < 0 || row >= r->rows || col < 0 || col >= r->cols) return;
+    r->back[(size_t)row * r->cols + col] = ch;
+}
+
+// Draw formatted text starting at (row, col), clipped to the frame width
+static inline void rendererText(Renderer* r, int row, int col, const char* fmt, ...) {
+    char line[1024];
+    va_list args;
+
+    if (row < 0 || row >= r->rows) return;
+
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+
+    for (int i = 0; i < len; i++) {
+        rendererPut(r, row, col + i, line[i]);
+    }
+}
+
+// Emit the changed cells of one row as a few cursor-positioned runs
+static inline void rendererDiffRow(Renderer* r, int row) {
+    const char* front = r->front + (size_t)row * r->cols;
+    const char* back = r->back + (size_t)row * r->cols;
+    int col = 0;
+
+    while (col < r->cols) {
+        if (front[col] == back[col]) {
+            col++;
+            continue;
+        }
+
+        // Extend the run across short stretches of unchanged cells
+        int start = col;
+        int end = col + 1;
+        int same = 0;
+        for (int i = end; i < r->cols && same < RENDER_MERGE_GAP; i++) {
+            if (front[i] == back[i]) {
+                same++;
+            } else {
+                same = 0;
+                end = i + 1;
+            }
+        }
+
+        rendererMoveTo(r, row + 1, start + 1);
+        rendererEmit(r, back + start, (size_t)(end - start));
+        if (r->spectators != NULL) spectatorRun(r->spectators, row, start, back + start, end - start);
+        col = end;
+    }
+}
+
+// Write the output buffer with as few write() calls as the terminal allows.
+// A non-blocking descriptor that fills up keeps the rest of the buffer in
+// 'out' for the next rendererPresent().
+static inline void rendererFlush(Renderer* r) {
+    size_t done = 0;
+
+    while (done < r->out_len) {
+        ssize_t n = write(r->fd, r->out + done, r->out_len - done);
+        r->last.syscalls++;
+        if (n < 0) {
+            if (errno == EAGAIN && r->nonblocking) {
+                memmove(r->out, r->out + done, r->out_len - done);
+                r->out_len -= done;
+                r->last.bytes += done;
+                return;
+            }
+            if (errno == EINTR || errno == EAGAIN) continue;
+            break; // Terminal is gone; drop the frame
+        }
+        done += (size_t)n;
+    }
+    r->last.bytes += done;
+    r->out_len = 0;
+}
+
+// Show the back buffer on the terminal. While a non-blocking descriptor
+// still holds back part of an earlier frame, the frame is skipped: the front
+// buffer keeps what was sent, so the next frame carries the difference.
+static inline void rendererPresent(Renderer* r) {
+    memset(&r->last, 0, sizeof(r->last));
+    if (r->out_len > 0) {
+        rendererFlush(r);
+        if (r->out_len > 0) return;
+    }
+    r->last.frames = 1;
+
+    if (r->full_redraw) {
+        // Clear once, then paint each row without its trailing blanks
+        rendererEmit(r, "\x1b[H\x1b[2J", 7);
+        for (int row = 0; row < r->rows; row++) {
+            const char* line = r->back + (size_t)row * r->cols;
+            int len = r->cols;
+            while (len > 0 && line[len - 1] == ' ') len--;
+            if (len == 0) continue;
+            rendererMoveTo(r, row + 1, 1);
+            rendererEmit(r, line, (size_t)len);
+        }
+        r->full_redraw = 0;
+        if (r->spectators != NULL) spectatorKeyframe(r->spectators, r->back, r->rows, r->cols);
+    } else {
+        int keyframe = r->spectators != NULL && spectatorWantsKeyframe(r->spectators);
+        if (r->spectators != NULL && !keyframe) spectatorDeltaBegin(r->spectators, r->rows, r->cols);
+        for (int row = 0; row < r->rows; row++) {
+            rendererDiffRow(r, row);
+        }
+        if (keyframe) spectatorKeyframe(r->spectators, r->back, r->rows, r->cols);
+        else if (r->spectators != NULL) spectatorDeltaEnd(r->spectators);
+    }
+
+    if (r->out_len > 0) {
+        // Park the cursor below the frame so stray output cannot corrupt it
+        rendererMoveTo(r, r->rows + 1, 1);
+        rendererFlush(r);
+    }
+    memcpy(r->front, r->back, (size_t)r->rows * (size_t)r->cols);
+
+    if (r->launch_fd >= 0) {
+        // Tell the console launcher when the first frame went out
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t shown = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+        if (write(r->launch_fd, &shown, sizeof(shown)) == -1) {
+            // The console stopped listening; nothing to report
+        }
+        close(r->launch_fd);
+        r->launch_fd = -1;
+    }
+
+    r->total.frames += r->last.frames;
+    r->total.bytes += r->last.bytes;
+    r->total.syscalls += r->last.syscalls;
+}
+
+// Leave the cursor below the frame and, when VGC_RENDER_STATS is set in the
+// environment, report the average cost per frame
+static inline void rendererFinish(Renderer* r) {
+    if (r->spectators != NULL) spectatorEnd(r->spectators); // Also when a signal ends the game
+    r->out_len = 0;
+    rendererMoveTo(r, r->rows + 1, 1);
+    rendererFlush(r);
+
+    if (getenv("VGC_RENDER_STATS") != NULL && r->total.frames > 0) {
+        printf("Renderer: %lu frames, %.1f bytes/frame, %.2f syscalls/frame\n",
+               r->total.frames,
+               (double)r->total.bytes / r->total.frames,
+               (double)r->total.syscalls / r->total.frames);
+    }
+}
+
+#endif
@@ -0,0 +1,434 @@
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// High scores and match history.
+//
+// scores.log is append-only: one 64-byte checksummed ScoreRecord per
+// finished session, which names its game by a 64-bit key of the whole name
+// (scoreGameKey()), so games whose names only differ late keep apart. Writers append with O_APPEND and fdatasync() in batches
+// (every SCORE_SYNC_BATCH records or SCORE_SYNC_INTERVAL_NS, and on close).
+// A torn or corrupt record, e.g. after a power cut, fails its checksum and is
+// skipped, never trusted.
+//
+// scores.idx is the leaderboard index: every record's (game, score,
+// position) sorted by game and then best score first, mapped read-only. A
+// top-k query is a binary search for the game plus k steps. Records appended
+// since the index was built are kept sorted in memory (the delta) and merged
+// into each answer; once the delta grows past SCORE_DELTA_LIMIT, the index is
+// rewritten by merging it with the delta, through a temporary file and a
+// rename.
+
+#define SCORE_LOG_FILE "scores.log"
+#define SCORE_INDEX_FILE "scores.idx"
+#define SCORE_RECORD_MAGIC 0x32435356u // "VSC2"
+#define SCORE_RECORD_MAGIC_V1 0x52435356u // "VSCR": the name's first 23 bytes instead of game_key and game
+#define SCORE_V1_GAME_LENGTH 24
+#define SCORE_INDEX_MAGIC "VSCI"
+#define SCORE_INDEX_VERSION 1
+#define SCORE_SYNC_BATCH 64
+#define SCORE_SYNC_INTERVAL_NS 1000000000ull
+#define SCORE_DELTA_LIMIT 4096
+#define SCORE_GAME_LENGTH 16
+#define SCORE_PATH_LENGTH 512
+
+// How a session ended (see VgcGame.result)
+#define SCORE_NONE 0    // Nothing to record
+#define SCORE_LOST 1
+#define SCORE_WON 2
+#define SCORE_DRAW 3
+#define SCORE_QUIT 4
+
+typedef struct {
+    uint32_t magic;
+    uint32_t outcome;
+    int64_t score;
+    int64_t time;               // Unix time the session ended
+    uint64_t ticks;             // Length of the session in game ticks
+    uint64_t game_key;          // scoreGameKey() of the whole name
+    char game[SCORE_GAME_LENGTH]; // Start of the name, for reading the log by hand
+    uint64_t checksum;          // scoreChecksum() of the bytes above
+} ScoreRecord;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t log_size;          // Bytes of scores.log the index covers
+    uint64_t reserved;
+} ScoreIndexHeader;
+
+typedef struct {
+    uint64_t game;              // scoreGameKey() of the record's game
+    int64_t score;
+    uint64_t record;            // Position of the record in scores.log
+} ScoreIndexEntry;
+
+// Appending side, used by every game session
+typedef struct {
+    int fd;
+    unsigned pending;           // Records written since the last fdatasync()
+    uint64_t last_sync_ns;
+} ScoreLog;
+
+// Reading side, used by the leaderboards
+typedef struct {
+    char dir[SCORE_PATH_LENGTH];
+    ScoreLog log;
+    void* index_map;
+    size_t index_map_size;
+    const ScoreIndexEntry* index;
+    uint64_t index_count;
+    uint64_t indexed_size;      // Log bytes covered by the index
+    ScoreIndexEntry* delta;     // Records after indexed_size, sorted like the index
+    size_t delta_count;
+    size_t delta_capacity;
+    uint64_t scanned_size;      // Log bytes read so far
+} ScoreStore;
+
+static inline uint64_t scoreHash(const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static inline uint64_t scoreChecksum(const ScoreRecord* record) {
+    return scoreHash(record, offsetof(ScoreRecord, checksum));
+}
+
+// Key of a game's records. A name that fit the old records' 24-byte field
+// hashes as that field did, so those records stay on its leaderboard and
+// the index keeps its keys; a longer name hashes whole.
+static inline uint64_t scoreGameKey(const char* game) {
+    size_t length = strlen(game);
+
+    if (length < SCORE_V1_GAME_LENGTH) {
+        char name[SCORE_V1_GAME_LENGTH] = { 0 };
+        memcpy(name, game, length);
+        return scoreHash(name, sizeof(name));
+    }
+    return scoreHash(game, length);
+}
+
+static inline uint64_t scoreRecordKey(const ScoreRecord* record) {
+    if (record->magic == SCORE_RECORD_MAGIC_V1) return scoreHash(&record->game_key, SCORE_V1_GAME_LENGTH);
+    return record->game_key;
+}
+
+static inline int scoreRecordValid(const ScoreRecord* record) {
+    return (record->magic == SCORE_RECORD_MAGIC || record->magic == SCORE_RECORD_MAGIC_V1)
+        && record->checksum == scoreChecksum(record);
+}
+
+// Index order: by game, then best score first, then oldest first
+static inline int scoreEntryCompare(const void* a, const void* b) {
+    const ScoreIndexEntry* x = a;
+    const ScoreIndexEntry* y = b;
+    if (x->game != y->game) return x->game < y->game ? -1 : 1;
+    if (x->score != y->score) return x->score > y->score ? -1 : 1;
+    return (x->record > y->record) - (x->record < y->record);
+}
+
+static inline uint64_t scoreClockNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Open scores.log in 'dir' for appending; returns -1 on failure
+static inline int scoreLogOpen(ScoreLog* log, const char* dir) {
+    char path[SCORE_PATH_LENGTH + sizeof(SCORE_LOG_FILE)];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, SCORE_LOG_FILE);
+    log->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    log->pending = 0;
+    log->last_sync_ns = scoreClockNs();
+    if (log->fd == -1) {
+        return -1;
+    }
+    // Drop a record torn by a crash so the next ones stay aligned
+    if (fstat(log->fd, &st) == 0 && st.st_size % sizeof(ScoreRecord) != 0) {
+        if (ftruncate(log->fd, st.st_size - st.st_size % sizeof(ScoreRecord)) == -1) {
+            close(log->fd);
+            log->fd = -1;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void scoreLogSync(ScoreLog* log) {
+    if (log->fd == -1 || log->pending == 0) return;
+    fdatasync(log->fd);
+    log->pending = 0;
+    log->last_sync_ns = scoreClockNs();
+}
+
+// Append one result; durable at the next batched sync
+static inline int scoreLogAppend(ScoreLog* log, const char* game, int outcome, int64_t score, uint64_t ticks) {
+    ScoreRecord record;
+
+    if (log->fd == -1) return -1;
+    memset(&record, 0, sizeof(record));
+    record.magic = SCORE_RECORD_MAGIC;
+    record.outcome = (uint32_t)outcome;
+    record.score = score;
+    record.time = (int64_t)time(NULL);
+    record.ticks = ticks;
+    record.game_key = scoreGameKey(game);
+    memcpy(record.game, game, strnlen(game, sizeof(record.game) - 1));
+    record.checksum = scoreChecksum(&record);
+
+    if (write(log->fd, &record, sizeof(record)) != (ssize_t)sizeof(record)) {
+        return -1;
+    }
+    log->pending++;
+    if (log->pending >= SCORE_SYNC_BATCH || scoreClockNs() - log->last_sync_ns >= SCORE_SYNC_INTERVAL_NS) {
+        scoreLogSync(log);
+    }
+    return 0;
+}
+
+static inline void scoreLogClose(ScoreLog* log) {
+    if (log->fd == -1) return;
+    scoreLogSync(log);
+    close(log->fd);
+    log->fd = -1;
+}
+
+static inline void scoreIndexUnmap(ScoreStore* store) {
+    if (store->index_map != NULL) munmap(store->index_map, store->index_map_size);
+    store->index_map = NULL;
+    store->index = NULL;
+    store->index_count = 0;
+    store->indexed_size = 0;
+}
+
+// Map scores.idx if it is valid for the current log
+static inline void scoreIndexMap(ScoreStore* store, uint64_t logSize) {
+    char path[SCORE_PATH_LENGTH + sizeof(SCORE_INDEX_FILE)];
+    struct stat st;
+
+    scoreIndexUnmap(store);
+    snprintf(path, sizeof(path), "%s/%s", store->dir, SCORE_INDEX_FILE);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ScoreIndexHeader)) {
+        close(fd);
+        return;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return;
+
+    const ScoreIndexHeader* header = map;
+    if (memcmp(header->magic, SCORE_INDEX_MAGIC, 4) != 0 || header->version != SCORE_INDEX_VERSION
+        || header->log_size > logSize
+        || (uint64_t)st.st_size != sizeof(ScoreIndexHeader) + header->count * sizeof(ScoreIndexEntry)) {
+        munmap(map, (size_t)st.st_size); // Stale or damaged; rebuilt from the log
+        return;
+    }
+    store->index_map = map;
+    store->index_map_size = (size_t)st.st_size;
+    store->index = (const ScoreIndexEntry*)(header + 1);
+    store->index_count = header->count;
+    store->indexed_size = header->log_size;
+}
+
+// Write the merged index and delta as the new scores.idx and map it
+static inline int scoreIndexRebuild(ScoreStore* store) {
+    char path[SCORE_PATH_LENGTH + sizeof(SCORE_INDEX_FILE)];
+    char temporary[sizeof(path) + 4];
+    ScoreIndexHeader header;
+
+    snprintf(path, sizeof(path), "%s/%s", store->dir, SCORE_INDEX_FILE);
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE* file = fopen(temporary, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCORE_INDEX_MAGIC, 4);
+    header.version = SCORE_INDEX_VERSION;
+    header.count = store->index_count + store->delta_count;
+    header.log_size = store->scanned_size;
+    fwrite(&header, sizeof(header), 1, file);
+
+    // Both runs are sorted: a single merge pass
+    uint64_t i = 0;
+    size_t j = 0;
+    while (i < store->index_count || j < store->delta_count) {
+        if (j == store->delta_count
+            || (i < store->index_count && scoreEntryCompare(&store->index[i], &store->delta[j]) <= 0)) {
+            fwrite(&store->index[i++], sizeof(ScoreIndexEntry), 1, file);
+        } else {
+            fwrite(&store->delta[j++], sizeof(ScoreIndexEntry), 1, file);
+        }
+    }
+    if (fflush(file) != 0 || fsync(fileno(file)) == -1) {
+        fclose(file);
+        unlink(temporary);
+        return -1;
+    }
+    fclose(file);
+    if (rename(temporary, path) == -1) {
+        unlink(temporary);
+        return -1;
+    }
+
+    store->delta_count = 0;
+    scoreIndexMap(store, store->scanned_size);
+    return 0;
+}
+
+static inline void scoreDeltaAdd(ScoreStore* store, const ScoreRecord* record, uint64_t position) {
+    if (store->delta_count == store->delta_capacity) {
+        size_t capacity = store->delta_capacity ? store->delta_capacity * 2 : 256;
+        ScoreIndexEntry* delta = realloc(store->delta, capacity * sizeof(ScoreIndexEntry));
+        if (delta == NULL) {
+            perror("Unable to allocate the score index");
+            exit(EXIT_FAILURE);
+        }
+        store->delta = delta;
+        store->delta_capacity = capacity;
+    }
+    ScoreIndexEntry* entry = &store->delta[store->delta_count++];
+    entry->game = scoreRecordKey(record);
+    entry->score = record->score;
+    entry->record = position;
+}
+
+// Pick up records appended since the last look (by any process); returns
+// the number of new records
+static inline size_t scoreStoreRefresh(ScoreStore* store) {
+    ScoreRecord records[256];
+    struct stat st;
+    size_t added = 0;
+
+    if (store->log.fd == -1 || fstat(store->log.fd, &st) == -1) return 0;
+    uint64_t end = (uint64_t)st.st_size - (uint64_t)st.st_size % sizeof(ScoreRecord);
+
+    while (store->scanned_size < end) {
+        size_t want = (size_t)((end - store->scanned_size) / sizeof(ScoreRecord));
+        if (want > sizeof(records) / sizeof(records[0])) want = sizeof(records) / sizeof(records[0]);
+        ssize_t n = pread(store->log.fd, records, want * sizeof(ScoreRecord), (off_t)store->scanned_size);
+        if (n < (ssize_t)sizeof(ScoreRecord)) break;
+
+        size_t count = (size_t)n / sizeof(ScoreRecord);
+        for (size_t i = 0; i < count; i++) {
+            if (scoreRecordValid(&records[i])) {
+                scoreDeltaAdd(store, &records[i], store->scanned_size / sizeof(ScoreRecord) + i);
+                added++;
+            }
+        }
+        store->scanned_size += count * sizeof(ScoreRecord);
+    }
+
+    if (added > 0) {
+        qsort(store->delta, store->delta_count, sizeof(ScoreIndexEntry), scoreEntryCompare);
+        if (store->delta_count >= SCORE_DELTA_LIMIT) scoreIndexRebuild(store);
+    }
+    return added;
+}
+
+// Open the store in 'dir' (created files included); returns -1 on failure
+static inline int scoreStoreOpen(ScoreStore* store, const char* dir) {
+    struct stat st;
+
+    memset(store, 0, sizeof(*store));
+    snprintf(store->dir, sizeof(store->dir), "%s", dir);
+    if (scoreLogOpen(&store->log, dir) == -1) {
+        return -1;
+    }
+    if (fstat(store->log.fd, &st) == 0) {
+        scoreIndexMap(store, (uint64_t)st.st_size);
+    }
+    store->scanned_size = store->indexed_size;
+    scoreStoreRefresh(store);
+    return 0;
+}
+
+static inline void scoreStoreClose(ScoreStore* store) {
+    if (store->delta_count > 0) scoreIndexRebuild(store); // Next open starts from a full index
+    scoreIndexUnmap(store);
+    scoreLogClose(&store->log);
+    free(store->delta);
+    store->delta = NULL;
+    store->delta_count = store->delta_capacity = 0;
+}
+
+// First entry of 'game' in a sorted run
+static inline size_t scoreLowerBound(const ScoreIndexEntry* entries, size_t count, uint64_t game) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (entries[mid].game < game) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// The best 'k' records of 'game', best first; returns how many were found
+static inline size_t scoreTop(ScoreStore* store, const char* game, ScoreRecord* out, size_t k) {
+    uint64_t key = scoreGameKey(game);
+    size_t i = scoreLowerBound(store->index, store->index_count, key);
+    size_t j = scoreLowerBound(store->delta, store->delta_count, key);
+    size_t found = 0;
+
+    while (found < k) {
+        int fromIndex = i < store->index_count && store->index[i].game == key;
+        int fromDelta = j < store->delta_count && store->delta[j].game == key;
+        const ScoreIndexEntry* entry;
+
+        if (fromIndex && (!fromDelta || scoreEntryCompare(&store->index[i], &store->delta[j]) <= 0)) {
+            entry = &store->index[i++];
+        } else if (fromDelta) {
+            entry = &store->delta[j++];
+        } else {
+            break;
+        }
+
+        ScoreRecord* record = &out[found];
+        if (pread(store->log.fd, record, sizeof(*record), (off_t)(entry->record * sizeof(ScoreRecord)))
+                == (ssize_t)sizeof(*record)
+            && scoreRecordValid(record) && scoreRecordKey(record) == key) {
+            found++;
+        }
+    }
+    return found;
+}
+
+// Records of 'game' in the store
+static inline uint64_t scoreCount(const ScoreStore* store, const char* game) {
+    uint64_t key = scoreGameKey(game);
+    uint64_t count = 0;
+    size_t i = scoreLowerBound(store->index, store->index_count, key);
+    size_t j = scoreLowerBound(store->delta, store->delta_count, key);
+
+    // Upper bound by searching for the next key
+    if (key != UINT64_MAX) {
+        count += scoreLowerBound(store->index, store->index_count, key + 1) - i;
+        count += scoreLowerBound(store->delta, store->delta_count, key + 1) - j;
+    } else {
+        count += store->index_count - i + store->delta_count - j;
+    }
+    return count;
+}
+
+#endif
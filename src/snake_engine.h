@@ -0,0 +1,278 @@
+#ifndef SNAKE_ENGINE_H
+#define SNAKE_ENGINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vgc_random.h"
+
+// Snake game state with O(1) moves on boards of any size.
+//
+// - The body is a ring buffer of cell indices: a move writes the new head and
+//   drops the tail without shifting the rest of the snake.
+// - An occupancy bitmap answers "is this cell part of the snake?" in O(1).
+// - The free cells are kept in an index set (array + position table), so the
+//   bait is placed with a single random pick however full the board is.
+// - The display grid is patched in place, only the cells that changed.
+//
+// All arrays live in one allocation sized from the board at runtime.
+
+// Result of moveSnake()
+#define SNAKE_BLOCKED 0   // Border or body in the way; nothing changed
+#define SNAKE_MOVED 1
+#define SNAKE_ATE_BAIT 2  // Moved onto the bait and grew by one
+
+#define SNAKE_MAX_CELLS (INT32_MAX / 2) // Largest board; cell indices stay ints
+
+typedef struct {
+    int row, col;
+} SnakePart;
+
+typedef struct {
+    int rows, cols;
+    int cells;            // rows * cols
+    int* body;            // Ring buffer of cell indices, capacity 'cells'
+    int head;             // Ring position of the head
+    int length;
+    uint64_t* occupied;   // One bit per cell covered by the snake
+    int* free_cells;      // Cells not covered by the snake, in any order
+    int* free_slot;       // Position of each cell in free_cells, -1 if covered
+    int free_count;
+    int bait;             // Cell of the bait, -1 when there is no room left
+    char* grid;           // Display characters, rows * cols
+    void* block;          // The single allocation backing the arrays above
+    VgcRandom rng;        // Where the bait goes; seed it after snakeInit()
+} SnakeGame;
+
+static inline int snakeCell(const SnakeGame* game, int row, int col) {
+    return row * game->cols + col;
+}
+
+static inline int snakeIsOccupied(const SnakeGame* game, int cell) {
+    return (game->occupied[cell >> 6] >> (cell & 63)) & 1;
+}
+
+static inline SnakePart snakePart(const SnakeGame* game, int cell) {
+    SnakePart part = { cell / game->cols, cell % game->cols };
+    return part;
+}
+
+// Ring position of the i-th segment counted from the head
+static inline int snakeSegment(const SnakeGame* game, int i) {
+    int pos = game->head - i;
+    return pos < 0 ? pos + game->cells : pos;
+}
+
+static inline SnakePart snakeHead(const SnakeGame* game) {
+    return snakePart(game, game->body[game->head]);
+}
+
+// Mark a cell as covered by the snake and take it out of the free set
+static inline void snakeOccupy(SnakeGame* game, int cell) {
+    int slot = game->free_slot[cell];
+    int last = game->free_cells[--game->free_count];
+
+    game->free_cells[slot] = last;
+    game->free_slot[last] = slot;
+    game->free_slot[cell] = -1;
+    game->occupied[cell >> 6] |= 1ull << (cell & 63);
+}
+
+// Return a cell to the free set
+static inline void snakeRelease(SnakeGame* game, int cell) {
+    game->free_slot[cell] = game->free_count;
+    game->free_cells[game->free_count++] = cell;
+    game->occupied[cell >> 6] &= ~(1ull << (cell & 63));
+}
+
+// Bytes of the single allocation behind a rows x cols board
+static inline size_t snakeBlockSize(int rows, int cols) {
+    size_t cells = (size_t)rows * (size_t)cols;
+    return (cells + 63) / 64 * sizeof(uint64_t) + 3 * cells * sizeof(int) + cells;
+}
+
+// Set up an empty board with a one-cell snake in the middle; returns -1 if
+// it cannot be allocated
+static inline int snakeInit(SnakeGame* game, int rows, int cols) {
+    size_t cells = (size_t)rows * (size_t)cols;
+    size_t words = (cells + 63) / 64;
+    size_t size = snakeBlockSize(rows, cols);
+
+    memset(game, 0, sizeof(*game));
+    game->block = malloc(size);
+    if (game->block == NULL) {
+        return -1;
+    }
+
+    game->rows = rows;
+    game->cols = cols;
+    game->cells = (int)cells;
+    game->occupied = game->block;
+    game->body = (int*)(game->occupied + words);
+    game->free_cells = game->body + cells;
+    game->free_slot = game->free_cells + cells;
+    game->grid = (char*)(game->free_slot + cells);
+
+    memset(game->occupied, 0, words * sizeof(uint64_t));
+    memset(game->grid, '.', cells);
+    for (int i = 0; i < game->cells; i++) {
+        game->free_cells[i] = i;
+        game->free_slot[i] = i;
+    }
+    game->free_count = game->cells;
+
+    int start = snakeCell(game, rows / 2, cols / 2);
+    game->head = 0;
+    game->length = 1;
+    game->body[0] = start;
+    snakeOccupy(game, start);
+    game->grid[start] = 'O';
+    game->bait = -1;
+    return 0;
+}
+
+static inline void snakeFree(SnakeGame* game) {
+    free(game->block);
+    memset(game, 0, sizeof(*game));
+}
+
+// Check that the body, bitmap, free set, bait and grid agree; returns what
+// is wrong, or NULL. O(cells): for soak tests, not for every tick.
+static inline const char* snakeCheck(const SnakeGame* game) {
+    int covered = 0;
+
+    if (game->length < 1 || game->length > game->cells || game->free_count != game->cells - game->length) {
+        return "length and free count disagree";
+    }
+    for (int i = 0; i < game->length; i++) {
+        int cell = game->body[snakeSegment(game, i)];
+        if (cell < 0 || cell >= game->cells || !snakeIsOccupied(game, cell)) return "body cell not occupied";
+    }
+    for (int cell = 0; cell < game->cells; cell++) {
+        int slot = game->free_slot[cell];
+        if (snakeIsOccupied(game, cell)) {
+            covered++;
+            if (slot != -1) return "occupied cell in the free set";
+        } else if (slot < 0 || slot >= game->free_count || game->free_cells[slot] != cell) {
+            return "free cell missing from the free set";
+        }
+    }
+    if (covered != game->length) return "snake crosses itself";
+    if (game->grid[game->body[game->head]] != 'O') return "head not drawn";
+    if (game->bait >= 0 && (snakeIsOccupied(game, game->bait) || game->grid[game->bait] != 'X')) {
+        return "bait under the snake";
+    }
+    return NULL;
+}
+
+// Saved board: this header followed by the board's single allocation, which
+// holds no pointers, only cell indices and bits
+typedef struct {
+    int32_t rows, cols;
+    int32_t head, length;
+    int32_t free_count, bait;
+    uint64_t rng;
+} SnakeSnapshot;
+
+static inline size_t snakeSnapshotSize(const SnakeGame* game) {
+    return sizeof(SnakeSnapshot) + snakeBlockSize(game->rows, game->cols);
+}
+
+static inline void snakeSnapshotWrite(const SnakeGame* game, void* out) {
+    SnakeSnapshot* snapshot = out;
+    snapshot->rows = game->rows;
+    snapshot->cols = game->cols;
+    snapshot->head = game->head;
+    snapshot->length = game->length;
+    snapshot->free_count = game->free_count;
+    snapshot->bait = game->bait;
+    snapshot->rng = game->rng.state;
+    memcpy(snapshot + 1, game->block, snakeBlockSize(game->rows, game->cols));
+}
+
+// Set up a board from a snapshot of 'size' bytes; returns -1 if it does not
+// describe a valid board or cannot be allocated
+static inline int snakeSnapshotRead(SnakeGame* game, const void* in, size_t size) {
+    const SnakeSnapshot* snapshot = in;
+    if (size < sizeof(SnakeSnapshot) || snapshot->rows <= 0 || snapshot->cols <= 0
+        || (long)snapshot->rows * snapshot->cols > SNAKE_MAX_CELLS
+        || size != sizeof(SnakeSnapshot) + snakeBlockSize(snapshot->rows, snapshot->cols)) {
+        return -1;
+    }
+    int cells = snapshot->rows * snapshot->cols;
+    if (snapshot->length < 1 || snapshot->length > cells || snapshot->head < 0 || snapshot->head >= cells
+        || snapshot->free_count != cells - snapshot->length || snapshot->bait < -1 || snapshot->bait >= cells) {
+        return -1;
+    }
+
+    if (snakeInit(game, snapshot->rows, snapshot->cols) == -1) {
+        return -1;
+    }
+    memcpy(game->block, snapshot + 1, snakeBlockSize(game->rows, game->cols));
+    game->head = snapshot->head;
+    game->length = snapshot->length;
+    game->free_count = snapshot->free_count;
+    game->bait = snapshot->bait;
+    game->rng.state = snapshot->rng;
+    return 0;
+}
+
+// Place bait on a random free cell; returns 0 when the board is full
+static inline int placeBait(SnakeGame* game) {
+    if (game->free_count == 0) {
+        game->bait = -1;
+        return 0;
+    }
+    game->bait = game->free_cells[vgcRandomRange(&game->rng, game->free_count)];
+    game->grid[game->bait] = 'X';
+    return 1;
+}
+
+// Move the snake one step in 'direction' ('w', 'a', 's' or 'd')
+static inline int moveSnake(SnakeGame* game, char direction) {
+    SnakePart next = snakeHead(game);
+
+    switch (direction) {
+        case 'w': next.row--; break;
+        case 'a': next.col--; break;
+        case 's': next.row++; break;
+        case 'd': next.col++; break;
+    }
+
+    // Check for border collision
+    if (next.row < 0 || next.row >= game->rows || next.col < 0 || next.col >= game->cols) {
+        return SNAKE_BLOCKED;
+    }
+
+    // Check for self-collision
+    int cell = snakeCell(game, next.row, next.col);
+    if (snakeIsOccupied(game, cell)) {
+        return SNAKE_BLOCKED;
+    }
+
+    int ate = (cell == game->bait);
+    if (ate) {
+        game->length++;
+        game->bait = -1;
+    } else {
+        // Drop the tail
+        int tail = game->body[snakeSegment(game, game->length - 1)];
+        snakeRelease(game, tail);
+        game->grid[tail] = '.';
+    }
+
+    int oldHead = game->body[game->head];
+    if (snakeIsOccupied(game, oldHead)) {
+        game->grid[oldHead] = '#';
+    }
+
+    game->head = (game->head + 1) % game->cells;
+    game->body[game->head] = cell;
+    snakeOccupy(game, cell);
+    game->grid[cell] = 'O';
+
+    return ate ? SNAKE_ATE_BAIT : SNAKE_MOVED;
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Save states.
+//
+// A snapshot file is a 64-byte SnapshotHeader followed by the game's state
+// in a fixed, pointer-free layout that the game defines (and versions).
+// Resuming maps the file and checks the header and checksum; the payload is
+// then used in place, with no parsing.
+//
+// Saving never blocks the game: the game copies its state into a staging
+// buffer, hands it to the writer thread with a pointer swap, and the thread
+// writes "<path>.tmp", fsync()s it and renames it over the old snapshot, so
+// a crash at any point leaves either the old or the new snapshot intact.
+//
+// Build with -pthread.
+
+#define SNAPSHOT_MAGIC "VSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_PATH_LENGTH 512
+
+typedef struct {
+    char magic[4];
+    uint32_t version;         // SNAPSHOT_VERSION, the layout of this header
+    char game[32];            // VgcGame name
+    uint32_t state_version;   // The game's own payload layout
+    uint32_t reserved;
+    uint64_t size;            // Payload bytes after the header
+    uint64_t checksum;        // snapshotChecksum() of the payload
+} SnapshotHeader;
+
+typedef struct {
+    char* data;               // Header followed by the payload
+    size_t size;
+    size_t capacity;
+} SnapshotBuffer;
+
+typedef struct {
+    char path[SNAPSHOT_PATH_LENGTH];
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    SnapshotBuffer staging;   // Filled by the game
+    SnapshotBuffer pending;   // Handed over, not yet written
+    SnapshotBuffer writing;   // Owned by the writer thread
+    int has_pending;          // 'pending' holds a snapshot, or a removal if empty
+    int stop;
+    unsigned long written;
+    unsigned long failed;
+} SnapshotWriter;
+
+// FNV-1a, 64 bits
+static inline uint64_t snapshotChecksum(const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Write 'buffer' to the snapshot path through a temporary file and rename;
+// an empty buffer removes the snapshot instead
+static inline int snapshotWriteFile(const char* path, const SnapshotBuffer* buffer) {
+    char temporary[SNAPSHOT_PATH_LENGTH + 4];
+
+    if (buffer->size == 0) {
+        return unlink(path) == -1 && errno != ENOENT ? -1 : 0;
+    }
+
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    size_t done = 0;
+    while (done < buffer->size) {
+        ssize_t n = write(fd, buffer->data + done, buffer->size - done);
+        if (n <= 0) {
+            close(fd);
+            unlink(temporary);
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    if (fsync(fd) == -1 || close(fd) == -1 || rename(temporary, path) == -1) {
+        unlink(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void* snapshotWriterThread(void* arg) {
+    SnapshotWriter* writer = arg;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (!writer->has_pending && !writer->stop) {
+            pthread_cond_wait(&writer->wake, &writer->lock);
+        }
+        if (!writer->has_pending) break; // Stopping and nothing left to write
+
+        SnapshotBuffer next = writer->pending;
+        writer->pending = writer->writing;
+        writer->writing = next;
+        writer->has_pending = 0;
+        pthread_mutex_unlock(&writer->lock);
+
+        int result = snapshotWriteFile(writer->path, &writer->writing);
+
+        pthread_mutex_lock(&writer->lock);
+        if (result == 0) writer->written++;
+        else writer->failed++;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+// Start a writer for the snapshot at 'path'; returns -1 on failure
+static inline int snapshotWriterStart(SnapshotWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+    snprintf(writer->path, sizeof(writer->path), "%s", path);
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+    if (pthread_create(&writer->thread, NULL, snapshotWriterThread, writer) != 0) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->wake);
+        return -1;
+    }
+    return 0;
+}
+
+// Make room for a payload of 'size' bytes in the staging buffer and return
+// where the payload goes
+static inline void* snapshotStage(SnapshotWriter* writer, size_t size) {
+    SnapshotBuffer* staging = &writer->staging;
+    size_t total = sizeof(SnapshotHeader) + size;
+
+    if (total > staging->capacity) {
+        char* data = realloc(staging->data, total);
+        if (data == NULL) {
+            perror("Unable to allocate the snapshot");
+            exit(EXIT_FAILURE);
+        }
+        staging->data = data;
+        staging->capacity = total;
+    }
+    staging->size = total;
+    return staging->data + sizeof(SnapshotHeader);
+}
+
+// Seal the staged payload and hand it to the writer thread. A snapshot that
+// has not been written yet is replaced, never queued behind.
+static inline void snapshotCommit(SnapshotWriter* writer, const char* game, uint32_t stateVersion) {
+    SnapshotBuffer* staging = &writer->staging;
+    SnapshotHeader* header = (SnapshotHeader*)staging->data;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SNAPSHOT_MAGIC, 4);
+    header->version = SNAPSHOT_VERSION;
+    snprintf(header->game, sizeof(header->game), "%s", game);
+    header->state_version = stateVersion;
+    header->size = staging->size - sizeof(SnapshotHeader);
+    header->checksum = snapshotChecksum(header + 1, header->size);
+
+    pthread_mutex_lock(&writer->lock);
+    SnapshotBuffer swap = writer->pending;
+    writer->pending = *staging;
+    *staging = swap;
+    writer->has_pending = 1;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+// Ask the writer thread to delete the snapshot, e.g. once the game is over
+static inline void snapshotRemove(SnapshotWriter* writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->pending.size = 0;
+    writer->has_pending = 1;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+// Finish the last write and stop the thread
+static inline void snapshotWriterStop(SnapshotWriter* writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->stop = 1;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->wake);
+    free(writer->staging.data);
+    free(writer->pending.data);
+    free(writer->writing.data);
+}
+
+// Map the snapshot at 'path' and validate it for 'game'. Returns the payload
+// (valid until snapshotUnmap()) and its size, or NULL if there is no usable
+// snapshot. The mapping is private: the game may modify it in place.
+static inline void* snapshotMap(const char* path, const char* game, uint32_t stateVersion,
+                                size_t* size, void** mapping, size_t* mappingSize) {
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    SnapshotHeader* header = map;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, 4) != 0
+        || header->version != SNAPSHOT_VERSION
+        || strncmp(header->game, game, sizeof(header->game)) != 0
+        || header->state_version != stateVersion
+        || header->size != (uint64_t)st.st_size - sizeof(SnapshotHeader)
+        || header->checksum != snapshotChecksum(header + 1, header->size)) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    *size = header->size;
+    *mapping = map;
+    *mappingSize = (size_t)st.st_size;
+    return header + 1;
+}
+
+static inline void snapshotUnmap(void* mapping, size_t mappingSize) {
+    if (mapping != NULL) munmap(mapping, mappingSize);
+}
+
+#endif
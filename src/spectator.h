@@ -0,0 +1,423 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Read-only spectators of a renderer's frames, through shared memory.
+// The fields shared with the producer are read and written atomically.
+//
+// A renderer started with VGC_SPECTATE=<name> in the environment publishes
+// every frame it presents into the ring /vgc-spectate-<name>, and
+// vgc_spectate attaches to it by that name. A name has one producer: the
+// ring is flock()ed, and a second renderer asking for the same name (a game
+// started from a broadcasting console, say) stays private.
+//
+// The ring holds records one after another: a keyframe (the whole frame)
+// on the first frame, after a resize, every SPECTATOR_KEYFRAME_FRAMES frames
+// and whenever a quarter of the ring has gone by since the last one; a
+// delta (the runs of changed cells the renderer found anyway) otherwise.
+// The producer writes a record and then publishes 'head'; 'keyframe' is
+// where the last keyframe starts. Spectators write nothing and the producer
+// never reads what they do, so a frame costs the game the same with any
+// number of spectators, none included.
+//
+// Positions only grow; a record at position p sits at p % capacity and may
+// wrap. Before writing, the producer moves 'reserve' past the record. A
+// spectator copies a record out and then checks 'reserve' (seqlock-style):
+// if the producer has come within a lap of the record, the copy may be torn
+// and the spectator resyncs from the latest keyframe. So does a spectator
+// that falls a lap behind.
+
+#define SPECTATOR_MAGIC "VSPC"
+#define SPECTATOR_VERSION 1
+#define SPECTATOR_RING_BYTES (1u << 20) // A power of two
+#define SPECTATOR_KEYFRAME_FRAMES 120
+#define SPECTATOR_NAME_LENGTH 64
+#define SPECTATOR_PREFIX "vgc-spectate-"
+
+enum { SPECTATOR_KEYFRAME = 1, SPECTATOR_DELTA = 2 };
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t capacity;              // Ring bytes
+    uint64_t generation;            // Changes with every new producer
+    uint64_t reserve;               // The producer may be writing up to here
+    uint64_t head;                  // End of the last record published
+    uint64_t keyframe;              // Start of the last keyframe published
+    uint64_t frames;                // Frames published
+    int32_t ended;                  // The producer has finished
+    int32_t pid;                    // Of the producer
+    char pad[8];                    // The ring starts on a cache line
+} SpectatorHeader;
+
+typedef struct {
+    uint32_t type;                  // SPECTATOR_KEYFRAME or SPECTATOR_DELTA
+    uint32_t size;                  // Whole record, a multiple of 8
+    uint64_t frame;                 // Frame number
+    uint16_t rows, cols;
+    uint32_t runs;                  // Delta runs that follow
+} SpectatorRecord;
+
+// A delta is runs of changed cells: this, then 'length' cells
+typedef struct {
+    uint16_t row, col, length;
+} SpectatorRun;
+
+// Publishing side, one per broadcasting renderer
+typedef struct {
+    char path[SPECTATOR_NAME_LENGTH + 16];  // shm_open() name
+    int fd;
+    SpectatorHeader* ring;
+    unsigned char* data;
+    uint64_t head;                  // Copy of ring->head
+    uint64_t last_keyframe;
+    uint64_t frame;
+    unsigned since_keyframe;        // Frames
+    unsigned char* record;          // The delta being built
+    size_t length, capacity;
+    int building;                   // A delta is open for runs
+} SpectatorProducer;
+
+// Following side, in vgc_spectate
+typedef struct {
+    const SpectatorHeader* ring;
+    const unsigned char* data;
+    uint64_t capacity;
+    uint64_t generation;
+    uint64_t pos;                   // Next record to read
+    int synced;                     // 'cells' matches the frame before 'pos'
+    unsigned char* record;          // Copy of the record being applied
+    size_t record_capacity;
+    char* cells;                    // The frame so far
+    int rows, cols;
+    uint64_t frame;                 // Number of the frame in 'cells'
+    unsigned long records, resyncs;
+    unsigned long skipped;          // Frames never seen
+} Spectator;
+
+static inline void spectatorPath(char* path, size_t size, const char* name) {
+    snprintf(path, size, "/" SPECTATOR_PREFIX "%.*s", SPECTATOR_NAME_LENGTH, name);
+}
+
+// Copy 'length' bytes to or from ring position 'pos', wrapping around
+static inline void spectatorRingWrite(unsigned char* data, uint64_t capacity, uint64_t pos,
+                                      const void* bytes, size_t length) {
+    size_t at = (size_t)(pos & (capacity - 1));
+    size_t first = length < capacity - at ? length : (size_t)(capacity - at);
+    memcpy(data + at, bytes, first);
+    memcpy(data, (const unsigned char*)bytes + first, length - first);
+}
+
+static inline void spectatorRingRead(const unsigned char* data, uint64_t capacity, uint64_t pos,
+                                     void* bytes, size_t length) {
+    size_t at = (size_t)(pos & (capacity - 1));
+    size_t first = length < capacity - at ? length : (size_t)(capacity - at);
+    memcpy(bytes, data + at, first);
+    memcpy((unsigned char*)bytes + first, data, length - first);
+}
+
+// Create or take over the ring called 'name'; returns -1 if it cannot be
+// made or another producer holds it
+static inline int spectatorStart(SpectatorProducer* p, const char* name) {
+    size_t size = sizeof(SpectatorHeader) + SPECTATOR_RING_BYTES;
+
+    memset(p, 0, sizeof(*p));
+    spectatorPath(p->path, sizeof(p->path), name);
+    p->fd = shm_open(p->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (p->fd == -1) return -1;
+    if (flock(p->fd, LOCK_EX | LOCK_NB) == -1 || ftruncate(p->fd, (off_t)size) == -1) {
+        close(p->fd);
+        return -1;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+    if (map == MAP_FAILED) {
+        close(p->fd);
+        return -1;
+    }
+
+    // Spectators left from an earlier producer see the generation change
+    p->ring = map;
+    p->data = (unsigned char*)(p->ring + 1);
+    p->head = __atomic_load_n(&p->ring->head, __ATOMIC_RELAXED);
+    memcpy(p->ring->magic, SPECTATOR_MAGIC, 4);
+    p->ring->version = SPECTATOR_VERSION;
+    p->ring->capacity = SPECTATOR_RING_BYTES;
+    p->ring->pid = (int32_t)getpid();
+    __atomic_store_n(&p->ring->ended, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->ring->keyframe, p->head, __ATOMIC_RELAXED); // None of ours yet
+    __atomic_fetch_add(&p->ring->generation, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Publish one finished record of 'size' bytes
+static inline void spectatorPublish(SpectatorProducer* p, const void* record, size_t size, int keyframe) {
+    SpectatorHeader* ring = p->ring;
+    uint64_t start = p->head;
+
+    __atomic_store_n(&ring->reserve, start + size, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); // 'reserve' moves before the bytes do
+    spectatorRingWrite(p->data, SPECTATOR_RING_BYTES, start, record, size);
+    p->head = start + size;
+    __atomic_store_n(&ring->head, p->head, __ATOMIC_RELEASE);
+    if (keyframe) {
+        __atomic_store_n(&ring->keyframe, start, __ATOMIC_RELEASE);
+        p->last_keyframe = start;
+        p->since_keyframe = 0;
+    }
+    __atomic_store_n(&ring->frames, p->frame, __ATOMIC_RELAXED);
+}
+
+// Does the next frame have to be a keyframe?
+static inline int spectatorWantsKeyframe(const SpectatorProducer* p) {
+    return p->frame == 0 || p->since_keyframe >= SPECTATOR_KEYFRAME_FRAMES
+        || p->head - p->last_keyframe >= SPECTATOR_RING_BYTES / 4;
+}
+
+// Make room for 'extra' more bytes of the record being built
+static inline int spectatorReserve(SpectatorProducer* p, size_t extra) {
+    if (p->length + extra <= p->capacity) return 0;
+
+    size_t capacity = p->capacity ? p->capacity : 4096;
+    while (capacity < p->length + extra) capacity *= 2;
+    unsigned char* record = realloc(p->record, capacity);
+    if (record == NULL) return -1;
+    p->record = record;
+    p->capacity = capacity;
+    return 0;
+}
+
+// Publish the whole frame; a frame too big for the ring is not published
+static inline void spectatorKeyframe(SpectatorProducer* p, const char* cells, int rows, int cols) {
+    SpectatorRecord header;
+    size_t cellCount = (size_t)rows * (size_t)cols;
+    size_t size = (sizeof(header) + cellCount + 7) & ~(size_t)7;
+
+    p->frame++;
+    p->building = 0;
+    if (size > SPECTATOR_RING_BYTES / 8 || rows > UINT16_MAX || cols > UINT16_MAX) return;
+    p->length = 0;
+    if (spectatorReserve(p, size) == -1) return;
+    memset(&header, 0, sizeof(header));
+    header.type = SPECTATOR_KEYFRAME;
+    header.size = (uint32_t)size;
+    header.frame = p->frame;
+    header.rows = (uint16_t)rows;
+    header.cols = (uint16_t)cols;
+    memcpy(p->record, &header, sizeof(header));
+    memcpy(p->record + sizeof(header), cells, cellCount);
+    memset(p->record + sizeof(header) + cellCount, 0, size - sizeof(header) - cellCount);
+    spectatorPublish(p, p->record, size, 1);
+}
+
+// Start a delta against the frame before; runs follow with spectatorRun()
+static inline void spectatorDeltaBegin(SpectatorProducer* p, int rows, int cols) {
+    SpectatorRecord header;
+
+    memset(&header, 0, sizeof(header));
+    header.type = SPECTATOR_DELTA;
+    header.rows = (uint16_t)rows;
+    header.cols = (uint16_t)cols;
+    p->length = 0;
+    p->building = spectatorReserve(p, sizeof(header)) == 0;
+    if (p->building) {
+        memcpy(p->record, &header, sizeof(header));
+        p->length = sizeof(header);
+    }
+}
+
+static inline void spectatorRun(SpectatorProducer* p, int row, int col, const char* cells, int length) {
+    SpectatorRun run = { (uint16_t)row, (uint16_t)col, (uint16_t)length };
+
+    if (!p->building) return;
+    if (spectatorReserve(p, sizeof(run) + (size_t)length) == -1) {
+        p->building = 0; // Spectators resync from the next keyframe
+        p->since_keyframe = SPECTATOR_KEYFRAME_FRAMES;
+        return;
+    }
+    memcpy(p->record + p->length, &run, sizeof(run));
+    memcpy(p->record + p->length + sizeof(run), cells, (size_t)length);
+    p->length += sizeof(run) + (size_t)length;
+    ((SpectatorRecord*)p->record)->runs++;
+}
+
+// Publish the delta, unless nothing changed
+static inline void spectatorDeltaEnd(SpectatorProducer* p) {
+    if (!p->building) return;
+    p->building = 0;
+
+    SpectatorRecord* header = (SpectatorRecord*)p->record;
+    size_t size = (p->length + 7) & ~(size_t)7;
+    if (header->runs == 0) return;
+    if (size > SPECTATOR_RING_BYTES / 8 || spectatorReserve(p, size - p->length) == -1) {
+        p->since_keyframe = SPECTATOR_KEYFRAME_FRAMES; // Too big: send the frame whole next time
+        return;
+    }
+    memset(p->record + p->length, 0, size - p->length);
+    header->size = (uint32_t)size;
+    header->frame = ++p->frame;
+    p->since_keyframe++;
+    spectatorPublish(p, p->record, size, 0);
+}
+
+// Tell spectators the broadcast is over and remove the name; spectators
+// still attached keep the last frame
+static inline void spectatorEnd(SpectatorProducer* p) {
+    if (p->ring == NULL || p->ring->ended) return;
+    __atomic_store_n(&p->ring->ended, 1, __ATOMIC_RELEASE);
+    shm_unlink(p->path);
+}
+
+static inline void spectatorStop(SpectatorProducer* p) {
+    if (p->ring == NULL) return;
+    spectatorEnd(p);
+    munmap(p->ring, sizeof(SpectatorHeader) + SPECTATOR_RING_BYTES);
+    close(p->fd); // Drops the lock
+    free(p->record);
+    memset(p, 0, sizeof(*p));
+}
+
+// Attach to the broadcast called 'name'; returns -1 with errno set if
+// there is none
+static inline int spectatorAttach(Spectator* s, const char* name) {
+    char path[SPECTATOR_NAME_LENGTH + 16];
+    struct stat st;
+
+    memset(s, 0, sizeof(*s));
+    spectatorPath(path, sizeof(path), name);
+    int fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size != sizeof(SpectatorHeader) + SPECTATOR_RING_BYTES) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    s->ring = map;
+    s->data = (const unsigned char*)(s->ring + 1);
+    s->capacity = SPECTATOR_RING_BYTES;
+    if (memcmp(s->ring->magic, SPECTATOR_MAGIC, 4) != 0 || s->ring->version != SPECTATOR_VERSION) {
+        munmap(map, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+static inline void spectatorDetach(Spectator* s) {
+    if (s->ring != NULL) munmap((void*)s->ring, sizeof(SpectatorHeader) + SPECTATOR_RING_BYTES);
+    free(s->record);
+    free(s->cells);
+    memset(s, 0, sizeof(*s));
+}
+
+// Copy the record at 'pos' into s->record; returns 0 if the producer may
+// have overwritten it meanwhile
+static inline int spectatorCopy(Spectator* s, uint64_t pos, uint64_t head) {
+    SpectatorRecord header;
+
+    if (head - pos < sizeof(header) || head - pos > s->capacity) return 0;
+    spectatorRingRead(s->data, s->capacity, pos, &header, sizeof(header));
+    if (header.size < sizeof(header) || header.size > head - pos) return 0;
+    if (header.size > s->record_capacity) {
+        unsigned char* record = realloc(s->record, header.size);
+        if (record == NULL) return 0;
+        s->record = record;
+        s->record_capacity = header.size;
+    }
+    spectatorRingRead(s->data, s->capacity, pos, s->record, header.size);
+
+    // Anything the producer reserved up to a lap past 'pos' may be in the copy
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t reserve = __atomic_load_n(&s->ring->reserve, __ATOMIC_RELAXED);
+    return reserve - pos <= s->capacity && memcmp(&header, s->record, sizeof(header)) == 0;
+}
+
+// Apply the copied record to the frame; returns 0 if it does not fit
+static inline int spectatorApply(Spectator* s) {
+    const SpectatorRecord* header = (const SpectatorRecord*)s->record;
+    const unsigned char* at = s->record + sizeof(*header);
+    const unsigned char* end = s->record + header->size;
+
+    if (header->type == SPECTATOR_KEYFRAME) {
+        size_t cells = (size_t)header->rows * header->cols;
+        if (cells > (size_t)(end - at)) return 0;
+        if (header->rows != s->rows || header->cols != s->cols) {
+            char* resized = realloc(s->cells, cells ? cells : 1);
+            if (resized == NULL) return 0;
+            s->cells = resized;
+            s->rows = header->rows;
+            s->cols = header->cols;
+        }
+        memcpy(s->cells, at, cells);
+    } else {
+        if (header->type != SPECTATOR_DELTA || header->rows != s->rows || header->cols != s->cols) return 0;
+        for (uint32_t i = 0; i < header->runs; i++) {
+            SpectatorRun run;
+            if ((size_t)(end - at) < sizeof(run)) return 0;
+            memcpy(&run, at, sizeof(run));
+            at += sizeof(run);
+            if (run.row >= s->rows || run.col + run.length > s->cols || (size_t)(end - at) < run.length) return 0;
+            memcpy(s->cells + (size_t)run.row * s->cols + run.col, at, run.length);
+            at += run.length;
+        }
+    }
+    if (s->frame > 0 && header->frame > s->frame + 1) s->skipped += header->frame - s->frame - 1;
+    s->frame = header->frame;
+    return 1;
+}
+
+// Bring s->cells up to the newest frame published; returns the number of
+// records applied, or -1 once the producer has finished and everything it
+// published has been seen
+static inline int spectatorFollow(Spectator* s) {
+    const SpectatorHeader* ring = s->ring;
+    int applied = 0;
+
+    uint64_t generation = __atomic_load_n(&ring->generation, __ATOMIC_ACQUIRE);
+    if (generation != s->generation) {
+        s->generation = generation; // A new producer: start over
+        s->synced = 0;
+    }
+    int ended = __atomic_load_n(&ring->ended, __ATOMIC_ACQUIRE)
+        || (kill(ring->pid, 0) == -1 && errno == ESRCH); // Killed before it could say so
+    if (!s->synced) {
+        // Start from the latest keyframe
+        uint64_t keyframe = __atomic_load_n(&ring->keyframe, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head == keyframe || !spectatorCopy(s, keyframe, head) || !spectatorApply(s)) {
+            return ended ? -1 : 0; // Nothing yet, or it was overwritten: try again later
+        }
+        s->pos = keyframe + ((const SpectatorRecord*)s->record)->size;
+        s->synced = 1;
+        s->resyncs++;
+        s->records++;
+        applied++;
+    }
+
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    while (s->pos != head) {
+        if (!spectatorCopy(s, s->pos, head) || !spectatorApply(s)) {
+            s->synced = 0; // Lapped or torn: the next call resyncs
+            return applied;
+        }
+        s->pos += ((const SpectatorRecord*)s->record)->size;
+        s->records++;
+        applied++;
+    }
+    return ended && applied == 0 ? -1 : applied;
+}
+
+#endif
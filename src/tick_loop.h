@@ -0,0 +1,198 @@
+#ifndef TICK_LOOP_H
+#define TICK_LOOP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+// Fixed-timestep game loop driven by poll() on the input descriptor and a
+// periodic timerfd.
+//
+// tickLoopWait() sleeps until input arrives or the next tick is due, drains
+// every pending input byte, and returns how many simulation steps to run.
+// If the process was descheduled and missed ticks, the missed steps are
+// returned together (up to max_catchup) so the simulation keeps real-time
+// pace instead of slowing down. A loop may also be woken by one more
+// descriptor becoming readable (wake_fd) or at a given time (wake_ns); it
+// then returns with nothing due.
+
+#define TICK_LOOP_MAX_CATCHUP 5
+#define LATENCY_BUCKETS 24 // Powers of two of microseconds, up to 8 s
+
+typedef struct {
+    unsigned long samples;
+    uint64_t total_ns;
+    uint64_t min_ns, max_ns;
+    unsigned long buckets[LATENCY_BUCKETS]; // Samples under 2^(i+1) us
+} LatencyStats;
+
+typedef struct {
+    int timer_fd;
+    int input_open;         // Cleared once the input reaches end of file
+    long period_ns;
+    int max_catchup;
+    unsigned long ticks;    // Simulation steps handed out
+    unsigned long late;     // Wakeups that found more than one tick due
+    unsigned long dropped;  // Steps skipped because catch-up was capped
+    unsigned long syscalls; // poll() and read() calls made
+    unsigned long keys;     // Keys read, repeats included (see input_queue.h)
+    unsigned long coalesced; // Of those, auto-repeats folded into one event
+    uint64_t input_ns;      // Arrival of the oldest input not yet shown, 0 if none
+    LatencyStats latency;   // Input arrival to frame presented
+    int wake_fd;            // Also wake when this is readable, -1 for none
+    uint64_t wake_ns;       // Also wake at this CLOCK_MONOTONIC time, 0 for never
+} TickLoop;
+
+static inline uint64_t monotonicNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Start a loop ticking 'hz' times per second, or a loop that only waits for
+// input when 'hz' is 0; returns -1 on failure
+static inline int tickLoopInit(TickLoop* loop, double hz) {
+    struct itimerspec spec;
+
+    memset(loop, 0, sizeof(*loop));
+    loop->input_open = 1;
+    loop->max_catchup = TICK_LOOP_MAX_CATCHUP;
+    loop->timer_fd = -1;
+    loop->wake_fd = -1;
+    if (hz <= 0) return 0;
+
+    loop->period_ns = (long)(1e9 / hz);
+    if (loop->period_ns <= 0) loop->period_ns = 1;
+
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (loop->timer_fd == -1) {
+        perror("Unable to create tick timer");
+        return -1;
+    }
+
+    spec.it_interval.tv_sec = loop->period_ns / 1000000000L;
+    spec.it_interval.tv_nsec = loop->period_ns % 1000000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(loop->timer_fd, 0, &spec, NULL) == -1) {
+        perror("Unable to start tick timer");
+        close(loop->timer_fd);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void tickLoopClose(TickLoop* loop) {
+    if (loop->timer_fd >= 0) close(loop->timer_fd);
+    loop->timer_fd = -1;
+}
+
+// Wait for input or the next tick. All pending input from 'in_fd' is read
+// into 'buf' (at most 'cap' bytes) and its length stored in '*len'.
+// Returns the number of simulation steps due now, possibly 0.
+static inline int tickLoopWait(TickLoop* loop, int in_fd, char* buf, size_t cap, size_t* len) {
+    struct pollfd fds[3];
+    int timeout = -1;
+
+    *len = 0;
+    fds[0].fd = loop->timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = loop->input_open ? in_fd : -1; // poll() skips negative descriptors
+    fds[1].events = POLLIN;
+    fds[2].fd = loop->wake_fd;
+    fds[2].events = POLLIN;
+    if (loop->wake_ns != 0) {
+        uint64_t now = monotonicNs();
+        timeout = loop->wake_ns <= now ? 0 : (int)((loop->wake_ns - now + 999999) / 1000000);
+    }
+
+    if (loop->timer_fd == -1 && !loop->input_open && loop->wake_fd == -1 && timeout == -1) {
+        return 0; // Nothing left to wait for
+    }
+    loop->syscalls++;
+    if (poll(fds, 3, timeout) == -1) {
+        return 0; // Interrupted by a signal; the caller simply waits again
+    }
+
+    if (fds[1].revents & (POLLIN | POLLHUP)) {
+        uint64_t now = monotonicNs();
+        while (*len < cap) {
+            ssize_t n = read(in_fd, buf + *len, cap - *len);
+            loop->syscalls++;
+            if (n > 0) {
+                *len += (size_t)n;
+            } else {
+                if (n == 0 && *len == 0) loop->input_open = 0; // End of input
+                break;
+            }
+        }
+        if (*len > 0 && loop->input_ns == 0) loop->input_ns = now;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        uint64_t expirations = 0;
+        loop->syscalls++;
+        if (read(loop->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)
+            && expirations > 0) {
+            if (expirations > 1) loop->late++;
+            if (expirations > (uint64_t)loop->max_catchup) {
+                loop->dropped += expirations - loop->max_catchup;
+                expirations = loop->max_catchup;
+            }
+            loop->ticks += expirations;
+            return (int)expirations;
+        }
+    }
+    return 0;
+}
+
+// Record that a frame reflecting all input read so far is now on screen
+static inline void tickLoopPresented(TickLoop* loop) {
+    if (loop->input_ns == 0) return;
+
+    uint64_t elapsed = monotonicNs() - loop->input_ns;
+    LatencyStats* stats = &loop->latency;
+    if (stats->samples == 0 || elapsed < stats->min_ns) stats->min_ns = elapsed;
+    if (elapsed > stats->max_ns) stats->max_ns = elapsed;
+    stats->total_ns += elapsed;
+    stats->samples++;
+    int bucket = 0;
+    for (uint64_t us = elapsed / 1000; us > 1 && bucket < LATENCY_BUCKETS - 1; us >>= 1) bucket++;
+    stats->buckets[bucket]++;
+    loop->input_ns = 0;
+}
+
+// Upper bound of the 'p'-th percentile (0-100) of the latencies, to the
+// power of two
+static inline uint64_t latencyPercentile(const LatencyStats* stats, double p) {
+    unsigned long rank = (unsigned long)(p / 100.0 * stats->samples), seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen > rank) return (2000ull << i) < stats->max_ns ? 2000ull << i : stats->max_ns;
+    }
+    return stats->max_ns;
+}
+
+// Print tick and latency statistics when VGC_LATENCY_STATS is set
+static inline void tickLoopReport(const TickLoop* loop) {
+    const LatencyStats* stats = &loop->latency;
+
+    if (getenv("VGC_LATENCY_STATS") == NULL) return;
+
+    printf("Ticks: %lu (%lu late wakeups, %lu dropped)\n", loop->ticks, loop->late, loop->dropped);
+    printf("Keys: %lu (%lu repeats coalesced)\n", loop->keys, loop->coalesced);
+    if (stats->samples > 0) {
+        printf("Input-to-display latency: min %.3f ms, avg %.3f ms, p50 <= %.3f ms, p99 <= %.3f ms, "
+               "max %.3f ms over %lu inputs\n",
+               stats->min_ns / 1e6, stats->total_ns / 1e6 / stats->samples,
+               latencyPercentile(stats, 50) / 1e6, latencyPercentile(stats, 99) / 1e6,
+               stats->max_ns / 1e6, stats->samples);
+    }
+}
+
+#endif
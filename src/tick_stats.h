@@ -0,0 +1,71 @@
+#ifndef TICK_STATS_H
+#define TICK_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Per-step timing samples for headless runs and benchmarks. The sample array
+// is allocated once up front, so recording a step never allocates and does
+// not disturb what is being measured.
+
+typedef struct {
+    uint64_t* samples;    // Nanoseconds per step
+    size_t count;
+    size_t capacity;
+    uint64_t steps;       // Every step added, sampled or not
+    uint64_t total_ns;    // Over all the steps
+} TickStats;
+
+static inline void tickStatsInit(TickStats* stats, size_t capacity) {
+    stats->samples = malloc((capacity > 0 ? capacity : 1) * sizeof(uint64_t));
+    if (stats->samples == NULL) {
+        perror("Unable to allocate tick samples");
+        exit(EXIT_FAILURE);
+    }
+    stats->count = 0;
+    stats->capacity = capacity;
+    stats->steps = 0;
+    stats->total_ns = 0;
+}
+
+static inline void tickStatsFree(TickStats* stats) {
+    free(stats->samples);
+    stats->samples = NULL;
+    stats->count = stats->capacity = 0;
+}
+
+// Steps beyond the capacity are not sampled but still count towards the rate
+static inline void tickStatsAdd(TickStats* stats, uint64_t ns) {
+    if (stats->count < stats->capacity) stats->samples[stats->count++] = ns;
+    stats->steps++;
+    stats->total_ns += ns;
+}
+
+static inline int tickStatsCompare(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts the samples; call once after the run, before tickStatsPercentile()
+static inline void tickStatsSort(TickStats* stats) {
+    qsort(stats->samples, stats->count, sizeof(uint64_t), tickStatsCompare);
+}
+
+// The 'p'-th percentile (0-100) of the sorted samples
+static inline uint64_t tickStatsPercentile(const TickStats* stats, double p) {
+    if (stats->count == 0) return 0;
+    size_t i = (size_t)(p / 100.0 * (stats->count - 1) + 0.5);
+    return stats->samples[i < stats->count ? i : stats->count - 1];
+}
+
+// One report line: steps per second and p50/p99/max step time
+static inline void tickStatsPrint(TickStats* stats, const char* label) {
+    tickStatsSort(stats);
+    printf("%-28s %12.0f ticks/s  p50 %8.0f ns  p99 %8.0f ns  max %10.0f ns",
+           label, stats->total_ns > 0 ? stats->steps * 1e9 / stats->total_ns : 0.0,
+           (double)tickStatsPercentile(stats, 50), (double)tickStatsPercentile(stats, 99),
+           (double)tickStatsPercentile(stats, 100));
+}
+
+#endif
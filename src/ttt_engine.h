@@ -0,0 +1,222 @@
+#ifndef TTT_ENGINE_H
+#define TTT_ENGINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// N x N, k-in-a-row engine (tic-tac-toe up to Gomoku).
+//
+// Each player's stones are a bitboard of up to 256 cells. Every possible
+// k-cell line (rows, columns and both diagonals) is precomputed as a mask,
+// together with the list of lines passing through each cell. After a move
+// only the lines through that cell are tested, with a handful of word-wide
+// AND/compare operations each. A move counter makes draw detection O(1).
+
+#define TTT_MAX_SIZE 15
+#define TTT_WORDS 4 // 4 x 64 bits >= 15 x 15 cells
+
+typedef struct {
+    uint64_t w[TTT_WORDS];
+} TttBits;
+
+typedef struct {
+    int size, k;
+    int cells;            // size * size
+    int line_count;
+    TttBits* lines;       // Mask of every k-cell line
+    int* cell_lines;      // Lines through each cell, grouped by cell
+    int* cell_line_start; // cell_lines[cell_line_start[c] .. cell_line_start[c + 1]]
+    TttBits stones[2];    // Player 1 and player 2
+    int moves;
+    int winner;           // 0 while undecided, otherwise the winning player
+} TttGame;
+
+static inline void tttSet(TttBits* bits, int cell) {
+    bits->w[cell >> 6] |= 1ull << (cell & 63);
+}
+
+static inline void tttReset(TttBits* bits, int cell) {
+    bits->w[cell >> 6] &= ~(1ull << (cell & 63));
+}
+
+static inline int tttTest(const TttBits* bits, int cell) {
+    return (bits->w[cell >> 6] >> (cell & 63)) & 1;
+}
+
+// Does 'bits' cover every cell of 'mask'?
+static inline int tttCovers(const TttBits* bits, const TttBits* mask) {
+    uint64_t missing = 0;
+    for (int i = 0; i < TTT_WORDS; i++) {
+        missing |= mask->w[i] & ~bits->w[i];
+    }
+    return missing == 0;
+}
+
+// Set up an empty board; returns -1 when size or k is out of range
+static inline int tttInit(TttGame* game, int size, int k) {
+    // Row, column, diagonal and anti-diagonal steps
+    static const int steps[4][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, -1 } };
+
+    memset(game, 0, sizeof(*game));
+    if (size < 1 || size > TTT_MAX_SIZE || k < 1 || k > size) {
+        return -1;
+    }
+    game->size = size;
+    game->k = k;
+    game->cells = size * size;
+
+    int span = size - k + 1;
+    int maxLines = 2 * size * span + 2 * span * span;
+    game->lines = calloc(maxLines, sizeof(TttBits));
+    game->cell_lines = malloc(sizeof(int) * maxLines * k);
+    game->cell_line_start = calloc(game->cells + 1, sizeof(int));
+    if (game->lines == NULL || game->cell_lines == NULL || game->cell_line_start == NULL) {
+        perror("Unable to allocate the board");
+        exit(EXIT_FAILURE);
+    }
+
+    // Enumerate every line that fits on the board
+    for (int d = 0; d < 4; d++) {
+        for (int row = 0; row < size; row++) {
+            for (int col = 0; col < size; col++) {
+                int endRow = row + steps[d][0] * (k - 1);
+                int endCol = col + steps[d][1] * (k - 1);
+                if (endRow < 0 || endRow >= size || endCol < 0 || endCol >= size) continue;
+                if (k == 1 && d > 0) continue; // A single cell is one line, not four
+
+                TttBits* line = &game->lines[game->line_count++];
+                for (int i = 0; i < k; i++) {
+                    int cell = (row + steps[d][0] * i) * size + col + steps[d][1] * i;
+                    tttSet(line, cell);
+                    game->cell_line_start[cell + 1]++;
+                }
+            }
+        }
+    }
+
+    // Group line indices by cell
+    for (int c = 0; c < game->cells; c++) {
+        game->cell_line_start[c + 1] += game->cell_line_start[c];
+    }
+    int* fill = malloc(sizeof(int) * game->cells);
+    if (fill == NULL) {
+        perror("Unable to allocate the board");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(fill, game->cell_line_start, sizeof(int) * game->cells);
+    for (int l = 0; l < game->line_count; l++) {
+        for (int c = 0; c < game->cells; c++) {
+            if (tttTest(&game->lines[l], c)) {
+                game->cell_lines[fill[c]++] = l;
+            }
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+static inline void tttFree(TttGame* game) {
+    free(game->lines);
+    free(game->cell_lines);
+    free(game->cell_line_start);
+    memset(game, 0, sizeof(*game));
+}
+
+static inline int tttIsEmpty(const TttGame* game, int cell) {
+    return !tttTest(&game->stones[0], cell) && !tttTest(&game->stones[1], cell);
+}
+
+// 'X', 'O' or ' ' for the given cell
+static inline char tttSymbol(const TttGame* game, int cell) {
+    if (tttTest(&game->stones[0], cell)) return 'X';
+    if (tttTest(&game->stones[1], cell)) return 'O';
+    return ' ';
+}
+
+// Would 'player' complete a line by owning 'cell'? Only the lines through
+// that cell are tested.
+static inline int tttWinsAt(const TttGame* game, int player, int cell) {
+    const TttBits* stones = &game->stones[player - 1];
+    for (int i = game->cell_line_start[cell]; i < game->cell_line_start[cell + 1]; i++) {
+        if (tttCovers(stones, &game->lines[game->cell_lines[i]])) return 1;
+    }
+    return 0;
+}
+
+// Put a stone for 'player' (1 or 2) on an empty cell; returns 1 if it wins
+static inline int tttPlay(TttGame* game, int player, int cell) {
+    tttSet(&game->stones[player - 1], cell);
+    game->moves++;
+    if (tttWinsAt(game, player, cell)) {
+        game->winner = player;
+        return 1;
+    }
+    return 0;
+}
+
+// Take back the stone on 'cell'
+static inline void tttUndo(TttGame* game, int player, int cell) {
+    tttReset(&game->stones[player - 1], cell);
+    game->moves--;
+    game->winner = 0;
+}
+
+// Saved board
+typedef struct {
+    int32_t size, k;
+    int32_t moves, winner;
+    TttBits stones[2];
+} TttSnapshot;
+
+static inline void tttSnapshotWrite(const TttGame* game, TttSnapshot* snapshot) {
+    snapshot->size = game->size;
+    snapshot->k = game->k;
+    snapshot->moves = game->moves;
+    snapshot->winner = game->winner;
+    snapshot->stones[0] = game->stones[0];
+    snapshot->stones[1] = game->stones[1];
+}
+
+// Set up a board from a snapshot; returns -1 if it does not describe a
+// valid position
+static inline int tttSnapshotRead(TttGame* game, const TttSnapshot* snapshot) {
+    int stones = 0;
+
+    if (snapshot->winner < 0 || snapshot->winner > 2
+        || tttInit(game, snapshot->size, snapshot->k) == -1) {
+        return -1;
+    }
+    for (int i = 0; i < TTT_WORDS; i++) {
+        uint64_t inside = 0;
+        for (int bit = 0; bit < 64 && i * 64 + bit < game->cells; bit++) inside |= 1ull << bit;
+        if ((snapshot->stones[0].w[i] & snapshot->stones[1].w[i])
+            || ((snapshot->stones[0].w[i] | snapshot->stones[1].w[i]) & ~inside)) {
+            tttFree(game);
+            return -1; // Overlapping stones or stones off the board
+        }
+        stones += __builtin_popcountll(snapshot->stones[0].w[i] | snapshot->stones[1].w[i]);
+    }
+    if (stones != snapshot->moves) {
+        tttFree(game);
+        return -1;
+    }
+    game->stones[0] = snapshot->stones[0];
+    game->stones[1] = snapshot->stones[1];
+    game->moves = snapshot->moves;
+    game->winner = snapshot->winner;
+    return 0;
+}
+
+// Check if a player has won
+static inline int checkWin(const TttGame* game) {
+    return game->winner != 0;
+}
+
+// Check if the game is a draw
+static inline int isDraw(const TttGame* game) {
+    return game->winner == 0 && game->moves == game->cells;
+}
+
+#endif
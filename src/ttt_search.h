@@ -0,0 +1,449 @@
+#ifndef TTT_SEARCH_H
+#define TTT_SEARCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tick_loop.h"
+#include "ttt_engine.h"
+#include "vgc_random.h"
+#include "work_pool.h"
+
+// Computer player for the k-in-a-row engine (ttt_engine.h).
+//
+// Iterative-deepening negamax alpha-beta. Every worker keeps its own copy
+// of the position (sharing the board's line tables) plus, per line, how
+// many stones each player has on it. Playing a stone updates the lines
+// through its cell, which gives both the win test and an incremental
+// evaluation: a line only one player has stones on is worth weight[stones]
+// to that player. Moves are tried in the order: the move the table
+// remembers, the two killer moves of the ply, then by a static value
+// (wins, forced blocks, lines extended) plus the history of cut-offs.
+// Only cells within two of a stone are tried on boards larger than 5x5.
+//
+// Positions are keyed by Zobrist hashing and kept in one transposition
+// table shared by every worker without locks: an entry is two 64-bit words
+// and the first holds the key XORed with the second, so an entry torn by
+// two writers no longer matches any key and is ignored.
+//
+// Lazy SMP: every worker of the pool searches the same position at the
+// same time, sharing only the table. Odd workers start one ply deeper and
+// all but the first shuffle equal moves, so they fill the table with
+// positions the first will need. The move played is that of the worker
+// that completed the deepest iteration. Searches stop at the move-time
+// budget, at a depth limit, or once the result is known.
+//
+// Which positions the other workers store first changes from run to run,
+// so with more than one worker or a time budget the move chosen can too.
+
+#define TTT_SEARCH_MAX_DEPTH 64
+#define TTT_MAX_CELLS (TTT_MAX_SIZE * TTT_MAX_SIZE)
+#define TTT_MAX_LINES (4 * TTT_MAX_CELLS)  // Lines of any k on the largest board
+#define TTT_WIN 1000000000                 // Score of a win on the move
+#define TTT_WON (TTT_WIN - 1000)           // Scores above this are forced wins
+#define TTT_NEAR 2                         // Candidate moves lie this close to a stone
+#define TTT_WEIGHT_MAX (1 << 18)
+#define TTT_CHECK_NODES 1024               // Nodes between looks at the clock
+#define TTT_TABLE_BITS 20                  // 2^20 entries of 16 bytes
+
+enum { TTT_BOUND_EXACT, TTT_BOUND_LOWER, TTT_BOUND_UPPER };
+
+// Score (32 bits), depth (8), bound (2), cell + 1 (8) and generation (8)
+typedef struct {
+    uint64_t check;       // Key XOR data
+    uint64_t data;
+} TttEntry;
+
+typedef struct TttSearch TttSearch;
+
+typedef struct {
+    TttSearch* search;
+    int index;
+    TttGame board;        // Private stones; line tables shared with the root
+    int16_t counts[2][TTT_MAX_LINES]; // Stones of each player per line
+    int eval;             // Sum of line values, player 1's point of view
+    uint64_t hash;
+    int history[2][TTT_MAX_CELLS];
+    int killers[TTT_SEARCH_MAX_DEPTH][2];
+    uint64_t nodes;
+    int aborted;
+    int depth_done;       // Deepest completed iteration
+    int best_cell, best_score; // Its result
+    int root_cell, root_score; // Best so far in the running iteration
+} TttWorker;
+
+struct TttSearch {
+    TttEntry* table;
+    uint64_t mask;        // Entries - 1
+    uint64_t zobrist[2][TTT_MAX_CELLS];
+    uint64_t side;        // XORed in when player 2 is to move
+    uint8_t generation;   // Bumped every search; older entries are replaced first
+    TttBits near[TTT_MAX_CELLS]; // Cells within TTT_NEAR of each cell
+    int all_near;         // Small board: every empty cell is a candidate
+    int weight[TTT_MAX_SIZE + 2]; // Line value by stones on it
+    const TttGame* root;
+    int player;           // To move at the root
+    int max_depth;
+    uint64_t deadline_ns; // 0 for none
+    int stop;             // Atomic
+    WorkPool* pool;       // NULL searches on the calling thread
+    int workers;
+    TttWorker* worker;
+};
+
+// Outcome of one search
+typedef struct {
+    int cell;
+    int score;            // For the player to move
+    int depth;
+    uint64_t nodes;       // All workers
+    uint64_t ns;
+} TttSearchResult;
+
+// Set up a search with a table of 2^tableBits entries, run on 'pool' (NULL
+// for the calling thread only)
+static inline void tttSearchInit(TttSearch* search, int tableBits, WorkPool* pool) {
+    VgcRandom rng;
+
+    memset(search, 0, sizeof(*search));
+    search->mask = (1ull << tableBits) - 1;
+    search->table = calloc(search->mask + 1, sizeof(TttEntry));
+    search->pool = pool;
+    search->workers = pool != NULL ? pool->threads : 1;
+    search->worker = calloc((size_t)search->workers, sizeof(TttWorker));
+    if (search->table == NULL || search->worker == NULL) {
+        perror("Unable to allocate the search");
+        exit(EXIT_FAILURE);
+    }
+    vgcRandomSeed(&rng, 0x7474742d7a6f62ull); // Same keys every run
+    for (int p = 0; p < 2; p++) {
+        for (int c = 0; c < TTT_MAX_CELLS; c++) search->zobrist[p][c] = vgcRandomNext(&rng);
+    }
+    search->side = vgcRandomNext(&rng);
+    for (int i = 0; i < search->workers; i++) {
+        search->worker[i].search = search;
+        search->worker[i].index = i;
+    }
+}
+
+static inline void tttSearchFree(TttSearch* search) {
+    free(search->table);
+    free(search->worker);
+    memset(search, 0, sizeof(*search));
+}
+
+// Value of a line with 'a' stones of player 1 and 'b' of player 2
+static inline int tttLineValue(const TttSearch* search, int a, int b) {
+    if (b == 0) return search->weight[a];
+    if (a == 0) return -search->weight[b];
+    return 0;
+}
+
+// Put 'player's stone on 'cell'; returns 1 if it completes a line
+static inline int tttSearchPlay(TttWorker* worker, int player, int cell) {
+    const TttSearch* search = worker->search;
+    TttGame* board = &worker->board;
+    int16_t* mine = worker->counts[player - 1];
+    int win = 0;
+
+    tttSet(&board->stones[player - 1], cell);
+    board->moves++;
+    worker->hash ^= search->zobrist[player - 1][cell];
+    for (int i = board->cell_line_start[cell]; i < board->cell_line_start[cell + 1]; i++) {
+        int line = board->cell_lines[i];
+        worker->eval -= tttLineValue(search, worker->counts[0][line], worker->counts[1][line]);
+        if (++mine[line] == board->k) win = 1;
+        worker->eval += tttLineValue(search, worker->counts[0][line], worker->counts[1][line]);
+    }
+    return win;
+}
+
+static inline void tttSearchUndo(TttWorker* worker, int player, int cell) {
+    const TttSearch* search = worker->search;
+    TttGame* board = &worker->board;
+    int16_t* mine = worker->counts[player - 1];
+
+    tttReset(&board->stones[player - 1], cell);
+    board->moves--;
+    worker->hash ^= search->zobrist[player - 1][cell];
+    for (int i = board->cell_line_start[cell]; i < board->cell_line_start[cell + 1]; i++) {
+        int line = board->cell_lines[i];
+        worker->eval -= tttLineValue(search, worker->counts[0][line], worker->counts[1][line]);
+        mine[line]--;
+        worker->eval += tttLineValue(search, worker->counts[0][line], worker->counts[1][line]);
+    }
+}
+
+// Table entry for 'key', or 0 if there is none
+static inline int tttProbe(const TttSearch* search, uint64_t key, uint64_t* data) {
+    const TttEntry* entry = &search->table[key & search->mask];
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    *data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    return (check ^ *data) == key;
+}
+
+// Keep a deeper result of the running search over a shallower one
+static inline void tttStore(TttSearch* search, uint64_t key, int score, int depth, int bound, int cell) {
+    TttEntry* entry = &search->table[key & search->mask];
+    uint64_t old = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+
+    if ((uint8_t)(old >> 50) == search->generation && (int)((old >> 32) & 0xff) > depth) return;
+    uint64_t data = (uint32_t)score | (uint64_t)depth << 32 | (uint64_t)bound << 40
+                    | (uint64_t)(cell + 1) << 42 | (uint64_t)search->generation << 50;
+    __atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
+
+// Forced wins are stored relative to the position, not the root
+static inline int tttScoreToTable(int score, int ply) {
+    if (score > TTT_WON) return score + ply;
+    if (score < -TTT_WON) return score - ply;
+    return score;
+}
+
+static inline int tttScoreFromTable(int score, int ply) {
+    if (score > TTT_WON) return score - ply;
+    if (score < -TTT_WON) return score + ply;
+    return score;
+}
+
+// Empty cells worth trying for 'player', with their ordering scores
+static inline int tttGenerate(TttWorker* worker, int player, int ply, int tableCell, int* cells, int* scores) {
+    const TttSearch* search = worker->search;
+    const TttGame* board = &worker->board;
+    const int16_t* mine = worker->counts[player - 1];
+    const int16_t* theirs = worker->counts[2 - player];
+    TttBits occupied;
+    int count = 0;
+
+    for (int i = 0; i < TTT_WORDS; i++) occupied.w[i] = board->stones[0].w[i] | board->stones[1].w[i];
+    if (board->moves == 0) {
+        cells[0] = board->size / 2 * board->size + board->size / 2;
+        scores[0] = 0;
+        return 1;
+    }
+    for (int cell = 0; cell < board->cells; cell++) {
+        if (tttTest(&occupied, cell)) continue;
+        if (!search->all_near) {
+            uint64_t near = 0;
+            for (int i = 0; i < TTT_WORDS; i++) near |= search->near[cell].w[i] & occupied.w[i];
+            if (near == 0) continue;
+        }
+
+        int score = 0;
+        if (cell == tableCell) {
+            score = 1 << 30;
+        } else if (cell == worker->killers[ply][0] || cell == worker->killers[ply][1]) {
+            score = 1 << 26;
+        } else {
+            for (int i = board->cell_line_start[cell]; i < board->cell_line_start[cell + 1]; i++) {
+                int line = board->cell_lines[i];
+                if (theirs[line] == 0) {
+                    score += mine[line] == board->k - 1 ? 1 << 28 : search->weight[mine[line] + 1];
+                }
+                if (mine[line] == 0) {
+                    score += theirs[line] == board->k - 1 ? 1 << 27 : search->weight[theirs[line] + 1] / 2;
+                }
+            }
+            score += worker->history[player - 1][cell];
+            if (worker->index > 0) {
+                score += (int)((worker->hash ^ (uint64_t)cell * 0x9e3779b97f4a7c15ull) >> (58 - worker->index % 4));
+            }
+        }
+        cells[count] = cell;
+        scores[count++] = score;
+    }
+    return count;
+}
+
+static inline int tttNegamax(TttWorker* worker, int depth, int ply, int alpha, int beta, int player) {
+    TttSearch* search = worker->search;
+    TttGame* board = &worker->board;
+    int cells[TTT_MAX_CELLS], scores[TTT_MAX_CELLS];
+
+    if ((++worker->nodes & (TTT_CHECK_NODES - 1)) == 0 && search->deadline_ns != 0
+        && monotonicNs() >= search->deadline_ns) {
+        __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+    }
+    if (worker->depth_done > 0 && __atomic_load_n(&search->stop, __ATOMIC_RELAXED)) {
+        worker->aborted = 1;
+        return 0;
+    }
+    if (board->moves == board->cells) return 0; // Draw
+    if (depth == 0) return player == 1 ? worker->eval : -worker->eval;
+
+    uint64_t key = worker->hash ^ (player == 2 ? search->side : 0);
+    uint64_t data;
+    int tableCell = -1;
+    int alphaStart = alpha;
+    if (tttProbe(search, key, &data)) {
+        tableCell = (int)((data >> 42) & 0xff) - 1;
+        int score = tttScoreFromTable((int32_t)(uint32_t)data, ply);
+        int bound = (int)((data >> 40) & 3);
+        if (ply > 0 && (int)((data >> 32) & 0xff) >= depth) {
+            if (bound == TTT_BOUND_EXACT) return score;
+            if (bound == TTT_BOUND_LOWER && score > alpha) alpha = score;
+            if (bound == TTT_BOUND_UPPER && score < beta) beta = score;
+            if (alpha >= beta) return score;
+        }
+    }
+
+    int count = tttGenerate(worker, player, ply, tableCell, cells, scores);
+    int best = -TTT_WIN - 1, bestCell = -1;
+    for (int n = 0; n < count; n++) {
+        // Selection sort step: the best of the moves left
+        int pick = n;
+        for (int i = n + 1; i < count; i++) {
+            if (scores[i] > scores[pick]) pick = i;
+        }
+        int cell = cells[pick];
+        cells[pick] = cells[n];
+        scores[pick] = scores[n];
+
+        int score;
+        if (tttSearchPlay(worker, player, cell)) {
+            score = TTT_WIN - ply;
+        } else {
+            score = -tttNegamax(worker, depth - 1, ply + 1, -beta, -alpha, 3 - player);
+        }
+        tttSearchUndo(worker, player, cell);
+        if (worker->aborted) return 0;
+
+        if (score > best) {
+            best = score;
+            bestCell = cell;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (ply == 0) {
+                worker->root_cell = cell;
+                worker->root_score = score;
+            }
+        }
+        if (alpha >= beta) {
+            if (cell != worker->killers[ply][0]) {
+                worker->killers[ply][1] = worker->killers[ply][0];
+                worker->killers[ply][0] = cell;
+            }
+            int* history = &worker->history[player - 1][cell];
+            *history += depth * depth;
+            if (*history > 1 << 20) {
+                for (int c = 0; c < board->cells; c++) worker->history[player - 1][c] /= 2;
+            }
+            break;
+        }
+    }
+
+    int bound = best <= alphaStart ? TTT_BOUND_UPPER : best >= beta ? TTT_BOUND_LOWER : TTT_BOUND_EXACT;
+    tttStore(search, key, tttScoreToTable(best, ply), depth, bound, bestCell);
+    return best;
+}
+
+// Iterative deepening on one worker until the search is stopped
+static inline void tttSearchTask(void* arg) {
+    TttWorker* worker = arg;
+    TttSearch* search = worker->search;
+    const TttGame* root = search->root;
+    int empty = root->cells - root->moves;
+
+    // Own copy of the position, with the stones per line counted once
+    worker->board = *root;
+    worker->hash = 0;
+    worker->eval = 0;
+    worker->nodes = 0;
+    worker->aborted = 0;
+    worker->depth_done = 0;
+    worker->best_cell = -1;
+    memset(worker->history, 0, sizeof(worker->history));
+    memset(worker->killers, -1, sizeof(worker->killers));
+    for (int line = 0; line < root->line_count; line++) {
+        for (int p = 0; p < 2; p++) {
+            int stones = 0;
+            for (int i = 0; i < TTT_WORDS; i++) {
+                stones += __builtin_popcountll(root->lines[line].w[i] & root->stones[p].w[i]);
+            }
+            worker->counts[p][line] = (int16_t)stones;
+        }
+        worker->eval += tttLineValue(search, worker->counts[0][line], worker->counts[1][line]);
+    }
+    for (int cell = 0; cell < root->cells; cell++) {
+        for (int p = 0; p < 2; p++) {
+            if (tttTest(&root->stones[p], cell)) worker->hash ^= search->zobrist[p][cell];
+        }
+    }
+
+    int depth = 1 + (worker->index & 1);
+    for (; depth <= search->max_depth && depth <= empty; depth++) {
+        worker->root_cell = -1;
+        int score = tttNegamax(worker, depth, 0, -TTT_WIN - 1, TTT_WIN + 1, search->player);
+        if (worker->aborted) break;
+        worker->depth_done = depth;
+        worker->best_cell = worker->root_cell;
+        worker->best_score = score;
+        if (score > TTT_WON || score < -TTT_WON) break; // Decided
+    }
+    if (!worker->aborted) __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+}
+
+// Pick a move for 'player' on 'game', searching at most 'maxDepth' plies
+// (0 for no limit) and 'budgetNs' nanoseconds (0 for no limit); returns the
+// cell, or -1 if the board is full
+static inline int tttSearchMove(TttSearch* search, const TttGame* game, int player, int maxDepth,
+                                uint64_t budgetNs, TttSearchResult* result) {
+    uint64_t start = monotonicNs();
+
+    memset(result, 0, sizeof(*result));
+    result->cell = -1;
+    if (game->moves == game->cells || game->winner != 0) return -1;
+
+    // Line weights grow eightfold per stone
+    search->weight[0] = 0;
+    for (int stones = 1; stones <= game->k + 1; stones++) {
+        int weight = 1 << (3 * (stones - 1) < 18 ? 3 * (stones - 1) : 18);
+        search->weight[stones] = weight < TTT_WEIGHT_MAX ? weight : TTT_WEIGHT_MAX;
+    }
+    search->all_near = game->size <= 5;
+    for (int cell = 0; cell < game->cells && !search->all_near; cell++) {
+        int row = cell / game->size, col = cell % game->size;
+        memset(&search->near[cell], 0, sizeof(TttBits));
+        for (int r = row - TTT_NEAR; r <= row + TTT_NEAR; r++) {
+            for (int c = col - TTT_NEAR; c <= col + TTT_NEAR; c++) {
+                if (r >= 0 && r < game->size && c >= 0 && c < game->size) tttSet(&search->near[cell], r * game->size + c);
+            }
+        }
+    }
+
+    search->root = game;
+    search->player = player;
+    search->max_depth = maxDepth > 0 && maxDepth < TTT_SEARCH_MAX_DEPTH ? maxDepth : TTT_SEARCH_MAX_DEPTH - 1;
+    search->deadline_ns = budgetNs > 0 ? start + budgetNs : 0;
+    search->generation++;
+    if (search->pool != NULL) {
+        for (int i = 0; i < search->workers; i++) workPoolSubmit(search->pool, tttSearchTask, &search->worker[i]);
+        workPoolWait(search->pool);
+    } else {
+        tttSearchTask(&search->worker[0]);
+    }
+
+    // The deepest completed iteration wins
+    for (int i = 0; i < search->workers; i++) {
+        TttWorker* worker = &search->worker[i];
+        result->nodes += worker->nodes;
+        if (worker->best_cell >= 0 && worker->depth_done > result->depth) {
+            result->depth = worker->depth_done;
+            result->cell = worker->best_cell;
+            result->score = worker->best_score;
+        }
+    }
+    result->ns = monotonicNs() - start;
+    __atomic_store_n(&search->stop, 0, __ATOMIC_RELAXED); // Cleared after, so a cancel can come early
+    return result->cell;
+}
+
+// Have a search running on another thread return as soon as it has a move
+static inline void tttSearchCancel(TttSearch* search) {
+    __atomic_store_n(&search->stop, 1, __ATOMIC_RELAXED);
+}
+
+#endif
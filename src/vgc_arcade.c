@@ -0,0 +1,769 @@
+#define _GNU_SOURCE // accept4()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include "catalog.h"
+#include "input_queue.h"
+#include "plugin_loader.h"
+#include "tick_loop.h"
+#include "tick_stats.h"
+#include "vgc_random.h"
+#include "work_pool.h"
+
+// Arcade server: many game sessions in one process.
+//
+//   vgc_arcade [-s socket] [-t threads] [game_directory]
+//
+// Clients connect to a Unix domain socket (ARCADE_SOCKET by default) and
+// send one line naming a game and its arguments, e.g. "game_snake -r 20\n".
+// Everything after that line is keys; the server answers with the game's
+// frames, as a terminal would receive them. Any game in the directory that
+// is built as a plugin (see vgc_plugin.h) can be played, with arguments
+// held to arcadeLimits and arcadeFixed, since every game runs inside the
+// server. A "stats" line
+// instead returns one line of counters since the previous "stats" request
+// and closes the connection (used by vgc_arcade_load).
+//
+// One thread runs epoll over the listening socket, every client and a
+// timerfd armed for the earliest tick due (a min-heap of sessions by next
+// tick). It does not run games: a session with keys waiting, a tick due or
+// a frame to finish sending is handed to the work-stealing pool of
+// work_pool.h, where a worker reads its keys, runs the ticks that are due,
+// renders and writes the frame without blocking. A session runs on at most
+// one worker at a time; what happens to it meanwhile makes the worker go
+// around once more. A client that reads slowly skips frames rather than
+// stalling a worker (see rendererPresent()).
+//
+// Build with -pthread -ldl.
+
+#define ARCADE_SOCKET "/tmp/vgc-arcade.sock"
+#define ARCADE_LINE_LENGTH 256
+#define ARCADE_MAX_ARGS 16
+#define ARCADE_MAX_FIXED 4                // Options arcadeFixed adds to one game's arguments
+#define ARCADE_MAX_EVENTS 256
+#define ARCADE_LATENESS_SAMPLES (1 << 20) // Per worker, per stats window
+#define ARCADE_MAX_NUMBER 10000           // Largest number in any client argument
+
+// Where a session is in its life; changed atomically
+enum { SESSION_IDLE, SESSION_QUEUED, SESSION_RUNNING, SESSION_RERUN, SESSION_DONE };
+
+typedef struct ArcadeSession {
+    int fd;
+    const VgcGame* game;
+    void* state;
+    Renderer screen;
+    uint64_t start_ns;
+    uint64_t period_ns;               // 0 for input-driven games
+    uint64_t slots;                   // Tick times passed so far (run or dropped)
+    char line[ARCADE_LINE_LENGTH];    // Handshake, then the keys that came with it
+    size_t line_length;
+    InputParser parser;               // Keys arrive as a terminal sends them
+    InputQueue input;
+    int status;                       // SESSION_*
+    int backlog;                      // Part of a frame waits for the socket to drain
+
+    // Owned by the event thread
+    int started;
+    int in_heap;
+    int reaped;
+    uint64_t due_ns;                  // Next tick
+    struct ArcadeSession* next_done;  // On the finished list
+} ArcadeSession;
+
+// What the workers measure, each under its own lock
+typedef struct {
+    pthread_mutex_t lock;
+    TickStats lateness;               // Tick due to tick run, in nanoseconds
+    unsigned long ticks;
+    unsigned long dropped;            // Ticks skipped because catch-up was capped
+    unsigned long frames;
+    unsigned long bytes;
+} ArcadeStats;
+
+typedef struct {
+    const char* name;                 // Catalog name, e.g. "game_snake"
+    const VgcGame* game;
+} ArcadeGame;
+
+// What a client may ask of a game: option 'option' of 'game' must lie
+// between 'min' and 'max'
+typedef struct {
+    const char* game;
+    char option;
+    double min, max;
+} ArcadeLimit;
+
+// An option the server passes to 'game' after the client's, whatever they
+// say, so it is the one that counts
+typedef struct {
+    const char* game;
+    const char* option;
+} ArcadeFixed;
+
+static const ArcadeLimit arcadeLimits[] = {
+    { "game_snake", 'r', 1, 200 },
+    { "game_snake", 'c', 1, 200 },
+    { "game_snake_arena", 'r', 1, 200 },
+    { "game_snake_arena", 'c', 1, 200 },
+    { "game_snake_arena", 'n', 0, 1000 },
+    { "game_snake_arena", 'l', 1, 1000 },
+    { "game_snake_arena", 't', 1, 1 },
+    { "game_tic_tac_toe", 'm', 1, 1000 }, // 0 would search without a deadline
+    { "game_tic_tac_toe", 't', 1, 1 },
+    { "game_falling_stars", 'r', 2, 200 },
+    { "game_falling_stars", 'c', 1, 400 },
+    { "game_falling_stars", 't', 1, 60 },
+};
+
+// Games tick on the server's workers, so none starts a pool of its own; the
+// tic-tac-toe computer still thinks on one thread while it is its turn
+static const ArcadeFixed arcadeFixed[] = {
+    { "game_snake_arena", "-t1" },
+    { "game_tic_tac_toe", "-t1" },
+};
+
+static Catalog catalog;
+static PluginCache plugins;
+static ArcadeGame* games; // Games with a plugin, at most one per catalog entry
+static int gameCount = 0;
+
+static WorkPool pool;
+static ArcadeStats workerStats[WORK_POOL_MAX_THREADS];
+
+static ArcadeSession** heap = NULL;   // Ticking sessions by due_ns
+static size_t heapCount = 0, heapCapacity = 0;
+static unsigned long liveSessions = 0;
+
+static pthread_mutex_t doneLock = PTHREAD_MUTEX_INITIALIZER;
+static ArcadeSession* doneList = NULL;
+static int doneFd = -1;
+static int timerFd = -1;              // Armed for heap[0]
+
+static uint64_t windowStart;          // Start of the current stats window
+static double windowCpu;
+static volatile sig_atomic_t stopping = 0;
+
+// epoll tags for the descriptors that are not sessions
+static int listenTag, timerTag, doneTag;
+
+// Function prototypes
+void loadGames(const char* dir);
+int openListener(const char* path);
+void acceptClients(int listenFd, int epollFd);
+void handshake(ArcadeSession* session);
+int withinLimits(int argc, char* argv[]);
+int addFixed(int argc, char* argv[]);
+void scheduleSession(ArcadeSession* session);
+void runSession(void* arg);
+int stepSession(ArcadeSession* session, ArcadeStats* stats);
+void finishSession(ArcadeSession* session);
+void dropSession(ArcadeSession* session);
+void fireTimers(void);
+void armTimer(void);
+void reapSessions(void);
+void sendStats(int fd);
+void heapPush(ArcadeSession* session);
+ArcadeSession* heapPop(void);
+
+static void stopServer(int signo) {
+    (void)signo;
+    stopping = 1;
+}
+
+static double cpuSeconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+           + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    const char* socketPath = ARCADE_SOCKET;
+    int threads = 0;
+    int opt;
+    struct epoll_event events[ARCADE_MAX_EVENTS];
+    struct sigaction action;
+    struct rlimit limit;
+
+    while ((opt = getopt(argc, argv, "s:t:")) != -1) {
+        if (opt == 's') {
+            socketPath = optarg;
+        } else if (opt == 't' && atoi(optarg) > 0) {
+            threads = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-s socket] [-t threads] [game_directory]\n", argv[0]);
+            return 1;
+        }
+    }
+    loadGames(optind < argc ? argv[optind] : ".");
+    if (gameCount == 0) {
+        fprintf(stderr, "No game plugins (game_*.so) found\n");
+        return 1;
+    }
+
+    // One descriptor per client
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN); // Clients that hang up show up as write errors
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServer; // No SA_RESTART: epoll_wait() returns
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    int listenFd = openListener(socketPath);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    doneFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listenFd == -1 || epollFd == -1 || timerFd == -1 || doneFd == -1) {
+        perror("Unable to set up the server");
+        return 1;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = &listenTag };
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.ptr = &timerTag;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+    event.data.ptr = &doneTag;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, doneFd, &event);
+
+    if (workPoolStart(&pool, threads) == -1) {
+        perror("Unable to start the workers");
+        workPoolStop(&pool);
+        return 1;
+    }
+    pool.fifo = 1; // Ticks have deadlines: oldest first
+    for (int i = 0; i < pool.threads; i++) {
+        pthread_mutex_init(&workerStats[i].lock, NULL);
+        tickStatsInit(&workerStats[i].lateness, ARCADE_LATENESS_SAMPLES);
+    }
+    windowStart = monotonicNs();
+    windowCpu = cpuSeconds();
+    printf("Serving %d game%s on %s with %d worker%s\n", gameCount, gameCount == 1 ? "" : "s",
+           socketPath, pool.threads, pool.threads == 1 ? "" : "s");
+    fflush(stdout);
+
+    while (!stopping) {
+        int count = epoll_wait(epollFd, events, ARCADE_MAX_EVENTS, -1);
+        if (count == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == &listenTag) {
+                acceptClients(listenFd, epollFd);
+            } else if (tag == &timerTag) {
+                fireTimers();
+            } else if (tag != &doneTag) {
+                ArcadeSession* session = tag;
+                if (!session->started) {
+                    handshake(session);
+                } else if ((events[i].events & ~EPOLLOUT)
+                           || __atomic_load_n(&session->backlog, __ATOMIC_SEQ_CST)) {
+                    scheduleSession(session); // Room to send the rest of a frame
+                }
+            }
+        }
+        // Only now: a session freed earlier could still have had an event
+        // in this batch
+        reapSessions();
+    }
+
+    workPoolStop(&pool);
+    printf("\nStopped with %lu session%s open\n", liveSessions, liveSessions == 1 ? "" : "s");
+    unlink(socketPath);
+    pluginUnloadAll(&plugins);
+    catalogClose(&catalog);
+    free(games);
+    return 0;
+}
+
+// Load every game that has a plugin
+void loadGames(const char* dir) {
+    const char* error;
+
+    catalogOpen(&catalog, dir);
+    games = calloc((size_t)catalog.count + 1, sizeof(ArcadeGame));
+    if (games == NULL) {
+        perror("Unable to allocate the games");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < catalog.count; i++) {
+        const VgcGame* game = pluginLoad(&plugins, &catalog.entries[i], &error);
+        if (game != NULL) {
+            games[gameCount].name = catalog.entries[i].name;
+            games[gameCount].game = game;
+            gameCount++;
+        } else if (error != NULL) {
+            fprintf(stderr, "Skipping %s: %s\n", catalog.entries[i].name, error);
+        }
+    }
+}
+
+int openListener(const char* path) {
+    struct sockaddr_un address;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path, strlen(path) + 1);
+    unlink(path); // Left over from an earlier run
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void acceptClients(int listenFd, int epollFd) {
+    for (;;) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EINTR) perror("accept");
+            return;
+        }
+
+        ArcadeSession* session = calloc(1, sizeof(ArcadeSession));
+        if (session == NULL) {
+            close(fd);
+            continue;
+        }
+        session->fd = fd;
+        struct epoll_event event = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = session };
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            close(fd);
+            free(session);
+        }
+    }
+}
+
+static int findGame(const char* name) {
+    for (int i = 0; i < gameCount; i++) {
+        if (strcmp(games[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Read the client's first line and start the game it names
+void handshake(ArcadeSession* session) {
+    char* argv[ARCADE_MAX_ARGS + ARCADE_MAX_FIXED + 1];
+    int argc = 0;
+    char* end;
+
+    for (;;) {
+        size_t room = sizeof(session->line) - 1 - session->line_length;
+        ssize_t n = read(session->fd, session->line + session->line_length, room);
+        if (n > 0) {
+            session->line_length += (size_t)n;
+            session->line[session->line_length] = '\0';
+            if (memchr(session->line, '\n', session->line_length) != NULL) break;
+            if (session->line_length == sizeof(session->line) - 1) {
+                dropSession(session); // No line in sight
+                return;
+            }
+        } else if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+            return; // Wait for the rest of the line
+        } else {
+            dropSession(session);
+            return;
+        }
+    }
+
+    end = memchr(session->line, '\n', session->line_length);
+    *end = '\0';
+    for (char* token = strtok(session->line, " \t\r"); token != NULL && argc < ARCADE_MAX_ARGS;
+         token = strtok(NULL, " \t\r")) {
+        argv[argc++] = token;
+    }
+    argv[argc] = NULL;
+
+    if (argc == 1 && strcmp(argv[0], "stats") == 0) {
+        sendStats(session->fd);
+        dropSession(session);
+        return;
+    }
+    int index = argc > 0 ? findGame(argv[0]) : -1;
+    if (index == -1) {
+        dprintf(session->fd, "Unknown game\n");
+        dropSession(session);
+        return;
+    }
+
+    if (!withinLimits(argc, argv)) {
+        dprintf(session->fd, "%s: arguments beyond the arcade's limits\n", argv[0]);
+        dropSession(session);
+        return;
+    }
+    argc = addFixed(argc, argv);
+
+    const VgcGame* game = games[index].game;
+    double tickRate = game->tick_rate;
+    session->state = game->init(argc, argv, &tickRate, vgcNewSeed());
+    if (session->state == NULL) {
+        dprintf(session->fd, "Unable to start %s\n", argv[0]);
+        dropSession(session);
+        return;
+    }
+
+    // Keep the keys that arrived with the line
+    size_t rest = session->line_length - (size_t)(end + 1 - session->line);
+    memmove(session->line, end + 1, rest);
+    session->line_length = rest;
+
+    session->game = game;
+    inputParserInit(&session->parser, game->arrows);
+    inputQueueInit(&session->input);
+    inputQueueCoalesce(&session->input, tickRate > 0 ? game->arrows : NULL);
+    rendererInit(&session->screen, 1, 1);
+    session->screen.fd = session->fd;
+    session->screen.nonblocking = 1;
+    session->start_ns = monotonicNs();
+    session->period_ns = tickRate > 0 ? (uint64_t)(1e9 / tickRate) : 0;
+    session->started = 1;
+    liveSessions++;
+    if (session->period_ns > 0) {
+        session->due_ns = session->start_ns + session->period_ns;
+        heapPush(session);
+        if (heap[0] == session) armTimer();
+    }
+    scheduleSession(session); // First frame
+}
+
+// Does the client's command line for game argv[0] keep to arcadeLimits and
+// ARCADE_MAX_NUMBER? Options are taken one per word, as "-r 20" or "-r20".
+int withinLimits(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const ArcadeLimit* limit = NULL;
+        const char* value = argv[i];
+
+        if (value[0] == '-' && isalpha((unsigned char)value[1])) {
+            for (size_t l = 0; l < sizeof(arcadeLimits) / sizeof(arcadeLimits[0]); l++) {
+                if (arcadeLimits[l].option == value[1] && strcmp(arcadeLimits[l].game, argv[0]) == 0) {
+                    limit = &arcadeLimits[l];
+                }
+            }
+            if (limit == NULL && value[2] != '\0') return 0; // Grouped flags could hide a limited option
+            if (limit == NULL) continue;
+            value = value[2] != '\0' ? value + 2 : i + 1 < argc ? argv[++i] : "";
+        }
+
+        char* end;
+        double number = strtod(value, &end);
+        if (end == value || *end != '\0') {
+            if (limit != NULL) return 0;
+            continue; // Not a number
+        }
+        if (!(number >= -ARCADE_MAX_NUMBER && number <= ARCADE_MAX_NUMBER)
+            || (limit != NULL && !(number >= limit->min && number <= limit->max))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Append arcadeFixed's options for game argv[0]; returns the new argc
+int addFixed(int argc, char* argv[]) {
+    int added = 0;
+
+    for (size_t f = 0; f < sizeof(arcadeFixed) / sizeof(arcadeFixed[0]) && added < ARCADE_MAX_FIXED; f++) {
+        if (strcmp(arcadeFixed[f].game, argv[0]) == 0) {
+            argv[argc + added++] = (char*)arcadeFixed[f].option;
+        }
+    }
+    argv[argc + added] = NULL;
+    return argc + added;
+}
+
+// Close a connection that never became a session
+void dropSession(ArcadeSession* session) {
+    close(session->fd);
+    free(session);
+}
+
+// Make sure the session runs soon: queue it, or have the worker running it
+// go around once more
+void scheduleSession(ArcadeSession* session) {
+    for (;;) {
+        int status = __atomic_load_n(&session->status, __ATOMIC_SEQ_CST);
+        if (status == SESSION_IDLE) {
+            if (__atomic_compare_exchange_n(&session->status, &status, SESSION_QUEUED, 0,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                workPoolSubmit(&pool, runSession, session);
+                return;
+            }
+        } else if (status == SESSION_RUNNING) {
+            if (__atomic_compare_exchange_n(&session->status, &status, SESSION_RERUN, 0,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                return;
+            }
+        } else {
+            return; // Already queued, already going around again, or over
+        }
+    }
+}
+
+// Worker task
+void runSession(void* arg) {
+    ArcadeSession* session = arg;
+    ArcadeStats* stats = &workerStats[workPoolCurrent() >= 0 ? workPoolCurrent() : 0];
+
+    __atomic_store_n(&session->status, SESSION_RUNNING, __ATOMIC_SEQ_CST);
+    for (;;) {
+        if (!stepSession(session, stats)) {
+            finishSession(session);
+            return;
+        }
+        int status = SESSION_RUNNING;
+        if (__atomic_compare_exchange_n(&session->status, &status, SESSION_IDLE, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            return;
+        }
+        __atomic_store_n(&session->status, SESSION_RUNNING, __ATOMIC_SEQ_CST);
+    }
+}
+
+// Handle the keys that arrived, run the ticks that are due and send the
+// frame; returns 0 once the game is over or the client is gone
+int stepSession(ArcadeSession* session, ArcadeStats* stats) {
+    const VgcGame* game = session->game;
+    char keys[256];
+    InputEvent event;
+    int running = 1, hungUp = 0;
+    int changed = session->screen.total.frames == 0;
+    unsigned long ran = 0, dropped = 0;
+    uint64_t lateness = 0;
+    uint64_t now = monotonicNs();
+
+    inputFeed(&session->parser, &session->input, session->line, session->line_length, now);
+    session->line_length = 0;
+    for (;;) {
+        ssize_t n = read(session->fd, keys, sizeof(keys));
+        if (n > 0) {
+            inputFeed(&session->parser, &session->input, keys, (size_t)n, now);
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || errno != EAGAIN) hungUp = 1;
+            break;
+        }
+    }
+    inputFlush(&session->parser, &session->input, now);
+    while (running && inputQueuePop(&session->input, &event)) {
+        running = game->handle_input(session->state, event.key);
+        changed = 1;
+    }
+    if (hungUp) running = 0;
+
+    if (running && session->period_ns > 0) {
+        now = monotonicNs();
+        uint64_t slots = (now - session->start_ns) / session->period_ns;
+        if (slots > session->slots) {
+            uint64_t due = slots - session->slots;
+            if (due > TICK_LOOP_MAX_CATCHUP) {
+                dropped = due - TICK_LOOP_MAX_CATCHUP;
+                due = TICK_LOOP_MAX_CATCHUP;
+            }
+            lateness = now - (session->start_ns + slots * session->period_ns);
+            for (; ran < due && running; ran++) {
+                running = game->tick(session->state);
+            }
+            session->slots = slots;
+            changed = 1;
+        }
+    }
+
+    if (changed || session->screen.out_len > 0) {
+        rendererClear(&session->screen);
+        game->render(session->state, &session->screen);
+        rendererPresent(&session->screen);
+        __atomic_store_n(&session->backlog, session->screen.out_len > 0, __ATOMIC_SEQ_CST);
+    }
+
+    pthread_mutex_lock(&stats->lock);
+    if (ran > 0) tickStatsAdd(&stats->lateness, lateness);
+    stats->ticks += ran;
+    stats->dropped += dropped;
+    stats->frames += session->screen.last.frames;
+    stats->bytes += session->screen.last.bytes;
+    pthread_mutex_unlock(&stats->lock);
+    return running;
+}
+
+// End the game, say goodbye and hand the session back to the event thread
+void finishSession(ArcadeSession* session) {
+    char summary[256] = "";
+
+    session->game->shutdown(session->state, summary, sizeof(summary));
+    if (summary[0] != '\0') {
+        dprintf(session->fd, "\x1b[%d;1H%s\r\n", session->screen.rows + 1, summary);
+    }
+    close(session->fd);
+    rendererFree(&session->screen);
+    session->state = NULL;
+    __atomic_store_n(&session->status, SESSION_DONE, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&doneLock);
+    session->next_done = doneList;
+    doneList = session;
+    pthread_mutex_unlock(&doneLock);
+    uint64_t one = 1;
+    if (write(doneFd, &one, sizeof(one)) == -1) {
+        // The counter is saturated; the event thread is already awake
+    }
+}
+
+// Free the sessions the workers finished, unless the heap still holds them
+void reapSessions(void) {
+    uint64_t count;
+
+    if (read(doneFd, &count, sizeof(count)) == -1) return; // Nothing finished
+    pthread_mutex_lock(&doneLock);
+    ArcadeSession* session = doneList;
+    doneList = NULL;
+    pthread_mutex_unlock(&doneLock);
+
+    while (session != NULL) {
+        ArcadeSession* next = session->next_done;
+        session->reaped = 1;
+        liveSessions--;
+        if (!session->in_heap) free(session);
+        session = next;
+    }
+}
+
+// Schedule every session whose tick is due and re-arm the timer
+void fireTimers(void) {
+    uint64_t expirations;
+    uint64_t now = monotonicNs();
+
+    if (read(timerFd, &expirations, sizeof(expirations)) == -1) {
+        // Spurious wakeup; the heap says what is due
+    }
+    while (heapCount > 0 && heap[0]->due_ns <= now) {
+        ArcadeSession* session = heapPop();
+        if (__atomic_load_n(&session->status, __ATOMIC_SEQ_CST) == SESSION_DONE) {
+            if (session->reaped) free(session);
+            continue;
+        }
+        scheduleSession(session);
+        session->due_ns = session->start_ns
+                          + ((now - session->start_ns) / session->period_ns + 1) * session->period_ns;
+        heapPush(session);
+    }
+    armTimer();
+}
+
+void armTimer(void) {
+    struct itimerspec spec;
+
+    if (heapCount == 0) return;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = (time_t)(heap[0]->due_ns / 1000000000ull);
+    spec.it_value.tv_nsec = (long)(heap[0]->due_ns % 1000000000ull);
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+// One line of counters for the window since the last request, then start
+// a new window
+void sendStats(int fd) {
+    TickStats lateness;
+    unsigned long ticks = 0, dropped = 0, frames = 0, bytes = 0;
+    uint64_t now = monotonicNs();
+    double cpu = cpuSeconds();
+
+    memset(&lateness, 0, sizeof(lateness));
+    for (int i = 0; i < pool.threads; i++) {
+        ArcadeStats* stats = &workerStats[i];
+        pthread_mutex_lock(&stats->lock);
+        uint64_t* samples = realloc(lateness.samples, (lateness.count + stats->lateness.count + 1) * sizeof(uint64_t));
+        if (samples == NULL) {
+            perror("Unable to collect the statistics");
+            exit(EXIT_FAILURE);
+        }
+        lateness.samples = samples;
+        memcpy(lateness.samples + lateness.count, stats->lateness.samples,
+               stats->lateness.count * sizeof(uint64_t));
+        lateness.count += stats->lateness.count;
+        lateness.capacity = lateness.count;
+        stats->lateness.count = 0;
+        stats->lateness.steps = 0;
+        stats->lateness.total_ns = 0;
+        ticks += stats->ticks;
+        dropped += stats->dropped;
+        frames += stats->frames;
+        bytes += stats->bytes;
+        stats->ticks = stats->dropped = stats->frames = stats->bytes = 0;
+        pthread_mutex_unlock(&stats->lock);
+    }
+    tickStatsSort(&lateness);
+
+    dprintf(fd, "workers %d sessions %lu seconds %.3f cpu %.3f ticks %lu dropped %lu frames %lu bytes %lu"
+            " late_p50_us %.1f late_p99_us %.1f late_max_us %.1f steals %lu\n",
+            pool.threads, liveSessions, (now - windowStart) / 1e9, cpu - windowCpu,
+            ticks, dropped, frames, bytes,
+            tickStatsPercentile(&lateness, 50) / 1e3, tickStatsPercentile(&lateness, 99) / 1e3,
+            tickStatsPercentile(&lateness, 100) / 1e3, workPoolSteals(&pool));
+    tickStatsFree(&lateness);
+    windowStart = now;
+    windowCpu = cpu;
+}
+
+void heapPush(ArcadeSession* session) {
+    if (heapCount == heapCapacity) {
+        size_t capacity = heapCapacity > 0 ? heapCapacity * 2 : 256;
+        ArcadeSession** grown = realloc(heap, capacity * sizeof(ArcadeSession*));
+        if (grown == NULL) {
+            perror("Unable to grow the timer heap");
+            exit(EXIT_FAILURE);
+        }
+        heap = grown;
+        heapCapacity = capacity;
+    }
+
+    size_t i = heapCount++;
+    while (i > 0 && heap[(i - 1) / 2]->due_ns > session->due_ns) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = session;
+    session->in_heap = 1;
+}
+
+ArcadeSession* heapPop(void) {
+    ArcadeSession* top = heap[0];
+    ArcadeSession* last = heap[--heapCount];
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= heapCount) break;
+        if (child + 1 < heapCount && heap[child + 1]->due_ns < heap[child]->due_ns) child++;
+        if (heap[child]->due_ns >= last->due_ns) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (heapCount > 0) heap[i] = last;
+    top->in_heap = 0;
+    return top;
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "tick_loop.h"
+#include "vgc_random.h"
+
+// Load generator for vgc_arcade:
+//
+//   vgc_arcade_load [-s socket] [-g game] [-k keys] [-r keys_per_second]
+//                   [-n sessions] [-m max_sessions] [-d seconds] [-j budget_ms]
+//
+// Opens 'sessions' games (falling stars by default), plays random keys in
+// each and reads every frame, then asks the server for its counters. The
+// step passes when no tick was dropped and the 99th percentile tick lateness
+// (due to run) stays within the budget; the session count then doubles until
+// a step fails or 'max_sessions' is reached. Sessions that end (a snake that
+// crashes) are replaced right away.
+//
+// The report gives, per step, ticks per second, lateness percentiles and the
+// CPU the server used, and at the end the most sessions sustained per
+// worker thread and per core actually busy. Run it on spare cores: the
+// generator is one thread and competes with the server otherwise.
+
+#define LOAD_DEFAULT_GAME "game_falling_stars"
+#define LOAD_MAX_EVENTS 512
+#define LOAD_POLL_MS 5
+
+typedef struct {
+    int fd;                 // -1 when closed
+    uint64_t next_key_ns;
+} LoadSession;
+
+typedef struct {
+    int workers;
+    unsigned long sessions;
+    double seconds, cpu;
+    unsigned long ticks, dropped, frames, bytes, steals;
+    double late_p50_us, late_p99_us, late_max_us;
+} ServerStats;
+
+static const char* socketPath = "/tmp/vgc-arcade.sock";
+static char handshake[256];
+static const char* keys = "ad";
+static double keyRate = 2.0;
+static VgcRandom rng;
+static unsigned long ended = 0;
+
+// Function prototypes
+int connectServer(void);
+int openSession(LoadSession* session, int epollFd);
+int queryStats(ServerStats* stats);
+void runStep(LoadSession* sessions, unsigned long count, int epollFd, double seconds);
+
+int main(int argc, char* argv[]) {
+    const char* game = LOAD_DEFAULT_GAME;
+    unsigned long start = 100, max = 100000;
+    double seconds = 5.0, budgetMs = 5.0;
+    int opt;
+    struct rlimit limit;
+
+    while ((opt = getopt(argc, argv, "s:g:k:r:n:m:d:j:")) != -1) {
+        if (opt == 's') {
+            socketPath = optarg;
+        } else if (opt == 'g') {
+            game = optarg;
+        } else if (opt == 'k' && optarg[0] != '\0') {
+            keys = optarg;
+        } else if (opt == 'r' && atof(optarg) >= 0) {
+            keyRate = atof(optarg);
+        } else if (opt == 'n' && atol(optarg) > 0) {
+            start = (unsigned long)atol(optarg);
+        } else if (opt == 'm' && atol(optarg) > 0) {
+            max = (unsigned long)atol(optarg);
+        } else if (opt == 'd' && atof(optarg) > 0) {
+            seconds = atof(optarg);
+        } else if (opt == 'j' && atof(optarg) > 0) {
+            budgetMs = atof(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-s socket] [-g game] [-k keys] [-r keys_per_second]\n"
+                    "       [-n sessions] [-m max_sessions] [-d seconds] [-j budget_ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    snprintf(handshake, sizeof(handshake), "%s\n", game);
+    vgcRandomSeed(&rng, vgcNewSeed());
+    signal(SIGPIPE, SIG_IGN);
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    LoadSession* sessions = malloc(max * sizeof(LoadSession));
+    if (epollFd == -1 || sessions == NULL) {
+        perror("Unable to set up the load generator");
+        return 1;
+    }
+
+    ServerStats stats;
+    unsigned long open = 0, best = 0;
+    int workers = 0;
+    double bestCores = 0;
+
+    printf("%9s %12s %8s %10s %10s %10s %7s %10s\n", "sessions", "ticks/s", "dropped",
+           "p50 us", "p99 us", "max us", "cores", "KB/s");
+    for (unsigned long count = start < max ? start : max; ; count = count * 2 < max ? count * 2 : max) {
+        for (; open < count; open++) {
+            if (openSession(&sessions[open], epollFd) == -1) {
+                perror("Unable to connect");
+                count = open;
+                break;
+            }
+        }
+        if (count == 0 || queryStats(&stats) == -1) {
+            fprintf(stderr, "No server on %s\n", socketPath);
+            return 1;
+        }
+
+        runStep(sessions, count, epollFd, seconds);
+        if (queryStats(&stats) == -1) {
+            fprintf(stderr, "The server went away\n");
+            return 1;
+        }
+        double cores = stats.seconds > 0 ? stats.cpu / stats.seconds : 0;
+        int passed = stats.dropped == 0 && stats.late_p99_us <= budgetMs * 1000;
+        printf("%9lu %12.0f %8lu %10.1f %10.1f %10.1f %7.2f %10.1f%s\n", count,
+               stats.seconds > 0 ? stats.ticks / stats.seconds : 0.0, stats.dropped,
+               stats.late_p50_us, stats.late_p99_us, stats.late_max_us, cores,
+               stats.seconds > 0 ? stats.bytes / stats.seconds / 1024 : 0.0, passed ? "" : "  over budget");
+        fflush(stdout);
+
+        workers = stats.workers;
+        if (!passed) break;
+        best = count;
+        bestCores = cores;
+        if (count == max) break;
+    }
+
+    if (best == 0) {
+        printf("\nNot even %lu sessions stayed within %.1f ms\n", start, budgetMs);
+    } else {
+        printf("\nSustained %lu sessions within %.1f ms p99 lateness: %.0f per worker thread (%d)",
+               best, budgetMs, (double)best / workers, workers);
+        if (bestCores > 0) printf(", %.0f per busy core (%.2f)", best / bestCores, bestCores);
+        printf("\n");
+    }
+    if (ended > 0) printf("%lu sessions ended and were replaced\n", ended);
+    return 0;
+}
+
+int connectServer(void) {
+    struct sockaddr_un address;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Connect, start the game and watch for its frames
+int openSession(LoadSession* session, int epollFd) {
+    size_t length = strlen(handshake);
+
+    session->fd = connectServer();
+    if (session->fd == -1) {
+        return -1;
+    }
+    if (write(session->fd, handshake, length) != (ssize_t)length) {
+        close(session->fd);
+        session->fd = -1;
+        return -1;
+    }
+    fcntl(session->fd, F_SETFL, O_NONBLOCK);
+    session->next_key_ns = monotonicNs() + vgcRandomRange(&rng, 1000) * 1000000ull;
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = session };
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, session->fd, &event);
+    return 0;
+}
+
+// Ask the server for its counters since the previous request
+int queryStats(ServerStats* stats) {
+    char line[512];
+    size_t length = 0;
+    ssize_t n;
+
+    int fd = connectServer();
+    if (fd == -1) {
+        return -1;
+    }
+    if (write(fd, "stats\n", 6) != 6) {
+        close(fd);
+        return -1;
+    }
+    while (length < sizeof(line) - 1 && (n = read(fd, line + length, sizeof(line) - 1 - length)) > 0) {
+        length += (size_t)n;
+    }
+    close(fd);
+    line[length] = '\0';
+
+    memset(stats, 0, sizeof(*stats));
+    int fields = sscanf(line, "workers %d sessions %lu seconds %lf cpu %lf ticks %lu dropped %lu frames %lu"
+                        " bytes %lu late_p50_us %lf late_p99_us %lf late_max_us %lf steals %lu",
+                        &stats->workers, &stats->sessions, &stats->seconds, &stats->cpu, &stats->ticks,
+                        &stats->dropped, &stats->frames, &stats->bytes, &stats->late_p50_us,
+                        &stats->late_p99_us, &stats->late_max_us, &stats->steals);
+    return fields == 12 ? 0 : -1;
+}
+
+// Play every session for 'seconds': drain frames, send keys at the set rate
+// and replace the sessions that end
+void runStep(LoadSession* sessions, unsigned long count, int epollFd, double seconds) {
+    struct epoll_event events[LOAD_MAX_EVENTS];
+    char buffer[16384];
+    uint64_t keyPeriod = keyRate > 0 ? (uint64_t)(1e9 / keyRate) : 0;
+    uint64_t end = monotonicNs() + (uint64_t)(seconds * 1e9);
+    size_t keyCount = strlen(keys);
+
+    for (;;) {
+        uint64_t now = monotonicNs();
+        if (now >= end) break;
+
+        int ready = epoll_wait(epollFd, events, LOAD_MAX_EVENTS, LOAD_POLL_MS);
+        for (int i = 0; i < ready; i++) {
+            LoadSession* session = events[i].data.ptr;
+            ssize_t n;
+            while ((n = read(session->fd, buffer, sizeof(buffer))) > 0) {
+                // Frames are only drained; the server counts them
+            }
+            if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) {
+                close(session->fd); // Game over; take its place
+                ended++;
+                openSession(session, epollFd);
+            }
+        }
+
+        if (keyPeriod == 0) continue;
+        now = monotonicNs();
+        for (unsigned long i = 0; i < count; i++) {
+            LoadSession* session = &sessions[i];
+            if (session->fd == -1 || session->next_key_ns > now) continue;
+            char key = keys[vgcRandomRange(&rng, (int)keyCount)];
+            if (write(session->fd, &key, 1) == -1 && errno != EAGAIN) {
+                // Ending; the read side notices
+            }
+            session->next_key_ns = now + keyPeriod / 2 + vgcRandomRange(&rng, (int)(keyPeriod / 1000)) * 1000ull;
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tick_loop.h"
+#include "arena_engine.h"
+#include "work_pool.h"
+
+// Core scaling of the snake arena (arena_engine.h):
+//
+//   vgc_arena_scale [-n snakes] [-r rows] [-c cols] [-l max_length] [-t ticks] [-m max_threads] [-s seed]
+//
+// Plays the same seeded arena of bots for 'ticks' ticks on the calling
+// thread, then on pools of 1, 2, 4, ... up to 'max_threads' workers (every
+// core by default), and reports snake moves per second with the speedup
+// and efficiency over the single-threaded run. Every run has to end in the
+// same arena, bit for bit, and pass arenaCheck(); the exit status is 1 if
+// one does not.
+
+#define DEFAULT_SNAKES 20000
+#define DEFAULT_SIZE 1000
+#define DEFAULT_MAX_LENGTH 40
+#define DEFAULT_TICKS 500
+
+static int rows = DEFAULT_SIZE, cols = DEFAULT_SIZE;
+static int snakes = DEFAULT_SNAKES, maxLength = DEFAULT_MAX_LENGTH;
+static int ticks = DEFAULT_TICKS;
+static uint64_t seed = 1;
+
+// Function prototypes
+double runArena(int threads, uint64_t* checksum, unsigned long* moves, const char** broken);
+
+int main(int argc, char* argv[]) {
+    int maxThreads = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:c:l:t:m:s:")) != -1) {
+        if (opt == 'n' && atoi(optarg) > 0 && atoi(optarg) <= ARENA_MAX_SNAKES) {
+            snakes = atoi(optarg);
+        } else if (opt == 'r' && atoi(optarg) > 0) {
+            rows = atoi(optarg);
+        } else if (opt == 'c' && atoi(optarg) > 0) {
+            cols = atoi(optarg);
+        } else if (opt == 'l' && atoi(optarg) > 0) {
+            maxLength = atoi(optarg);
+        } else if (opt == 't' && atoi(optarg) > 0) {
+            ticks = atoi(optarg);
+        } else if (opt == 'm' && atoi(optarg) > 0) {
+            maxThreads = atoi(optarg);
+        } else if (opt == 's') {
+            seed = strtoull(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "Usage: %s [-n snakes] [-r rows] [-c cols] [-l max_length] [-t ticks] "
+                    "[-m max_threads] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if ((long)rows * cols > INT32_MAX / 2 || (long)rows * cols < 2L * snakes) {
+        fprintf(stderr, "The arena needs at least two cells per snake.\n");
+        return 1;
+    }
+    if (maxThreads == 0) maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (maxThreads < 1) maxThreads = 1;
+    if (maxThreads > WORK_POOL_MAX_THREADS) maxThreads = WORK_POOL_MAX_THREADS;
+
+    uint64_t expected;
+    unsigned long moves;
+    const char* broken;
+    int failed = 0;
+
+    printf("%d snakes on %dx%d, %d ticks, seed %llu\n", snakes, rows, cols, ticks, (unsigned long long)seed);
+    double serial = runArena(0, &expected, &moves, &broken);
+    printf("%-8s %10.0f ticks/s %12.0f moves/s\n", "serial", ticks / serial, moves / serial);
+    if (broken != NULL) {
+        printf("  broken arena: %s\n", broken);
+        failed = 1;
+    }
+
+    for (int threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        uint64_t checksum;
+        double seconds = runArena(threads, &checksum, &moves, &broken);
+        char label[16];
+
+        snprintf(label, sizeof(label), "%d thr", threads);
+        printf("%-8s %10.0f ticks/s %12.0f moves/s  speedup %5.2fx  efficiency %3.0f%%\n", label,
+               ticks / seconds, moves / seconds, serial / seconds, 100.0 * serial / seconds / threads);
+        if (checksum != expected) {
+            printf("  arena differs from the serial run: %016llx, expected %016llx\n",
+                   (unsigned long long)checksum, (unsigned long long)expected);
+            failed = 1;
+        }
+        if (broken != NULL) {
+            printf("  broken arena: %s\n", broken);
+            failed = 1;
+        }
+        if (threads == maxThreads) break;
+    }
+    return failed;
+}
+
+// Play the arena on 'threads' workers (0: the calling thread); returns the
+// seconds the ticks took
+double runArena(int threads, uint64_t* checksum, unsigned long* moves, const char** broken) {
+    Arena arena;
+    WorkPool pool;
+
+    if (arenaInit(&arena, rows, cols, snakes, 0, maxLength) == -1) {
+        perror("Unable to allocate the arena");
+        exit(EXIT_FAILURE);
+    }
+    vgcRandomSeed(&arena.rng, seed);
+    arenaPopulate(&arena, rows * cols / 40);
+    if (threads > 0) {
+        if (workPoolStart(&pool, threads) == -1) {
+            perror("Unable to start the workers");
+            exit(EXIT_FAILURE);
+        }
+        arenaUsePool(&arena, &pool);
+    }
+
+    *moves = 0;
+    uint64_t start = monotonicNs();
+    for (int t = 0; t < ticks; t++) {
+        unsigned long deaths = arena.deaths;
+        arenaTick(&arena);
+        *moves += (unsigned long)arena.count - (arena.deaths - deaths);
+    }
+    double seconds = (monotonicNs() - start) / 1e9;
+
+    *checksum = arenaChecksum(&arena);
+    *broken = arenaCheck(&arena);
+    if (threads > 0) workPoolStop(&pool);
+    arenaFree(&arena);
+    return seconds;
+}
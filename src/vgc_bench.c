@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tick_loop.h"
+#include "tick_stats.h"
+#include "snake_engine.h"
+#include "stars_engine.h"
+#include "ttt_engine.h"
+#include "ttt_search.h"
+#include "work_pool.h"
+
+// Micro-benchmarks for the game engines. Runs the same steps the games run
+// each tick, with random input, no terminal and no sleeping, and reports
+// ticks per second, p50/p99/max tick time and heap allocations per tick for
+// several board sizes. The tic-tac-toe computer player is measured in
+// positions searched per second on 1, 2, 4, ... threads up to every core.
+//
+//   gcc -O2 -pthread vgc_bench.c -o vgc_bench
+//   ./vgc_bench [-n ticks] [-g snake|stars|ttt|search]
+
+#define DEFAULT_TICKS 1000000
+#define SEARCH_MS 1000 // Thinking time per search benchmark
+
+// Allocation counter: the benchmark's own malloc family forwards to glibc's
+// and counts every call made while a benchmark is timing ticks
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* ptr);
+
+static unsigned long allocations = 0;
+
+void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    allocations++;
+    return __libc_memalign(alignment, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+// Function prototypes
+void benchSnake(int rows, int cols, unsigned long ticks);
+void benchStars(int rows, int cols, const char* mode, unsigned long ticks);
+void benchTicTacToe(int size, int k, unsigned long ticks);
+void benchSearch(int size, int k, const char* opening);
+uint64_t searchOnce(TttGame* game, int threads, TttSearchResult* result);
+// Search one position for SEARCH_MS on 1, 2, 4, ... threads up to every
+// core. 'opening' holds the moves played first, row and column keys as
+// the game takes them (1-9, a-f), alternating X and O.
+void benchSearch(int size, int k, const char* opening) {
+    static const char keys[] = "123456789abcdef";
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    TttGame game;
+    double single = 0;
+
+    tttInit(&game, size, k);
+    for (int i = 0; opening[i] != '\0' && opening[i + 1] != '\0'; i += 2) {
+        int row = (int)(strchr(keys, opening[i]) - keys), col = (int)(strchr(keys, opening[i + 1]) - keys);
+        tttPlay(&game, 1 + (i / 2) % 2, row * size + col);
+    }
+
+    printf("search %dx%d k=%d after %d moves, %d ms\n", size, size, k, game.moves, SEARCH_MS);
+    for (int threads = 1;; threads = threads * 2 < cores ? threads * 2 : cores) {
+        TttSearchResult result;
+        uint64_t nodes = searchOnce(&game, threads, &result);
+        double perSecond = nodes / (result.ns / 1e9);
+
+        if (threads == 1) single = perSecond;
+        printf("  %3d threads %12.0f nodes/s  speedup %5.2fx  depth %2d  move %c%c\n", threads, perSecond,
+               perSecond / single, result.depth, keys[result.cell / size], keys[result.cell % size]);
+        if (threads >= cores) break;
+    }
+    tttFree(&game);
+}
+
+// One search on a fresh table; returns the positions searched
+uint64_t searchOnce(TttGame* game, int threads, TttSearchResult* result) {
+    WorkPool pool;
+    TttSearch search;
+
+    if (threads > 1 && workPoolStart(&pool, threads) == -1) {
+        perror("Unable to start the search threads");
+        exit(EXIT_FAILURE);
+    }
+    tttSearchInit(&search, TTT_TABLE_BITS, threads > 1 ? &pool : NULL);
+    tttSearchMove(&search, game, 1 + game->moves % 2, 0, SEARCH_MS * 1000000ull, result);
+    tttSearchFree(&search);
+    if (threads > 1) workPoolStop(&pool);
+    return result->nodes;
+}
+
+void printResult(TickStats* stats, const char* label, unsigned long tickAllocations, unsigned long games);
+
+int main(int argc, char* argv[]) {
+    unsigned long ticks = DEFAULT_TICKS;
+    const char* only = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:g:")) != -1) {
+        if (opt == 'n' && strtoul(optarg, NULL, 10) > 0) {
+            ticks = strtoul(optarg, NULL, 10);
+        } else if (opt == 'g') {
+            only = optarg;
+        } else {
+            fprintf(stderr, "Usage: %s [-n ticks] [-g snake|stars|ttt|search]\n", argv[0]);
+            return 1;
+        }
+    }
+    srand(1); // Same input sequence on every run
+
+    if (only == NULL || strcmp(only, "snake") == 0) {
+        benchSnake(15, 15, ticks);
+        benchSnake(100, 100, ticks);
+        benchSnake(1000, 1000, ticks);
+    }
+    if (only == NULL || strcmp(only, "stars") == 0) {
+        benchStars(15, 20, "classic", ticks);
+        benchStars(100, 200, "classic", ticks);
+        benchStars(1000, 1000, "classic", ticks);
+        benchStars(60, 200, "storm", ticks);
+        benchStars(100, 1000, "storm", ticks);
+    }
+    if (only == NULL || strcmp(only, "ttt") == 0) {
+        benchTicTacToe(3, 3, ticks);
+        benchTicTacToe(7, 4, ticks);
+        benchTicTacToe(15, 5, ticks);
+    }
+    if (only == NULL || strcmp(only, "search") == 0) {
+        benchSearch(9, 5, "5556");
+        benchSearch(15, 5, "7788696a5a");
+    }
+    return 0;
+}
+
+// A tick is moveSnake() plus placeBait() after eating. Blocked moves are
+// retried in another direction, as a player would; a dead or full board is
+// set up again outside the timed region.
+void benchSnake(int rows, int cols, unsigned long ticks) {
+    static const char directions[] = "wasd";
+    SnakeGame game;
+    TickStats stats;
+    unsigned long games = 1, outside = 0;
+    char label[64];
+
+    tickStatsInit(&stats, ticks);
+    if (snakeInit(&game, rows, cols) == -1) {
+        perror("Unable to allocate the board");
+        exit(EXIT_FAILURE);
+    }
+    placeBait(&game);
+    unsigned long before = allocations;
+
+    for (unsigned long t = 0; t < ticks; t++) {
+        int first = rand() % 4;
+        int result = SNAKE_BLOCKED, placed = 1;
+
+        uint64_t start = monotonicNs();
+        for (int i = 0; i < 4 && result == SNAKE_BLOCKED; i++) {
+            result = moveSnake(&game, directions[(first + i) % 4]);
+        }
+        if (result == SNAKE_ATE_BAIT) placed = placeBait(&game);
+        tickStatsAdd(&stats, monotonicNs() - start);
+
+        if (result == SNAKE_BLOCKED || !placed) {
+            unsigned long mark = allocations;
+            snakeFree(&game);
+            if (snakeInit(&game, rows, cols) == -1) {
+                perror("Unable to allocate the board");
+                exit(EXIT_FAILURE);
+            }
+            placeBait(&game);
+            outside += allocations - mark;
+            games++;
+        }
+    }
+
+    snprintf(label, sizeof(label), "snake %dx%d", rows, cols);
+    printResult(&stats, label, allocations - before - outside, games);
+    snakeFree(&game);
+    tickStatsFree(&stats);
+}
+
+// A tick is what starsTick() does, with a random paddle move first. The
+// star arrays grow while the first stars fall, which shows in allocs/tick.
+void benchStars(int rows, int cols, const char* mode, unsigned long ticks) {
+    StarsGame game;
+    TickStats stats;
+    char label[64];
+    int most = 0;
+
+    tickStatsInit(&stats, ticks);
+    initializeStars(&game, rows, cols, starsModeFind(mode));
+    vgcRandomSeed(&game.rng, 1);
+    unsigned long before = allocations;
+
+    for (unsigned long t = 0; t < ticks; t++) {
+        char key = "ad."[rand() % 3];
+
+        uint64_t start = monotonicNs();
+        if (key != '.') movePaddle(&game, key);
+        dropStars(&game);
+        game.score += updateStars(&game);
+        tickStatsAdd(&stats, monotonicNs() - start);
+        if (game.count > most) most = game.count;
+    }
+
+    snprintf(label, sizeof(label), "stars %dx%d %s", rows, cols, mode);
+    printResult(&stats, label, allocations - before, 1);
+    printf("  %d stars at most\n", most);
+    freeStars(&game);
+    tickStatsFree(&stats);
+}
+
+// A tick is one move on a random empty cell plus checkWin() and isDraw().
+// Finished games are taken back move by move outside the timed region.
+void benchTicTacToe(int size, int k, unsigned long ticks) {
+    TttGame game;
+    TickStats stats;
+    int history[TTT_MAX_SIZE * TTT_MAX_SIZE];
+    int moves = 0, player = 1;
+    unsigned long games = 1;
+    char label[64];
+
+    tickStatsInit(&stats, ticks);
+    tttInit(&game, size, k);
+    unsigned long before = allocations;
+
+    for (unsigned long t = 0; t < ticks; t++) {
+        int cell;
+        do {
+            cell = rand() % game.cells;
+        } while (!tttIsEmpty(&game, cell));
+
+        uint64_t start = monotonicNs();
+        tttPlay(&game, player, cell);
+        int over = checkWin(&game) || isDraw(&game);
+        tickStatsAdd(&stats, monotonicNs() - start);
+
+        history[moves++] = cell;
+        player = 3 - player;
+        if (over) {
+            while (moves > 0) {
+                player = 3 - player;
+                tttUndo(&game, player, history[--moves]);
+            }
+            player = 1;
+            games++;
+        }
+    }
+
+    snprintf(label, sizeof(label), "ttt %dx%d k=%d", size, size, k);
+    printResult(&stats, label, allocations - before, games);
+    tttFree(&game);
+    tickStatsFree(&stats);
+}
+
+void printResult(TickStats* stats, const char* label, unsigned long tickAllocations, unsigned long games) {
+    tickStatsPrint(stats, label);
+    printf("  %.3f allocs/tick  %lu games\n",
+           stats->count > 0 ? (double)tickAllocations / stats->count : 0.0, games);
+}
@@ -0,0 +1,228 @@
+#define _GNU_SOURCE // memfd_create()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cartridge.h"
+
+// Builds and inspects game cartridges (cartridge.h):
+//
+//   vgc_cart -c games.vcart game_snake game_snake.so ...   build a cartridge
+//   vgc_cart [-v] games.vcart                              list it; -v checks every file
+//   vgc_cart -x games.vcart game [args...]                 run a game from it
+//
+// Files keep their base name; names ending in ".so" are plugins. main_screen
+// takes a cartridge in place of the game directory:
+//
+//   main_screen games.vcart
+
+extern char** environ;
+
+// Function prototypes
+int build(const char* path, int count, char* files[]);
+int list(const char* path, int verify);
+int run(const char* path, const char* name, char* argv[]);
+int compareNames(const void* a, const void* b);
+const char* baseName(const char* path);
+
+static uint64_t clockNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char* argv[]) {
+    const char* create = NULL;
+    const char* execute = NULL;
+    int verify = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+c:x:v")) != -1) {
+        if (opt == 'c') {
+            create = optarg;
+        } else if (opt == 'x') {
+            execute = optarg;
+        } else if (opt == 'v') {
+            verify = 1;
+        } else {
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (create != NULL && optind < argc) {
+        return build(create, argc - optind, argv + optind);
+    } else if (execute != NULL && optind < argc) {
+        return run(execute, argv[optind], argv + optind);
+    } else if (create == NULL && execute == NULL && optind == argc - 1) {
+        return list(argv[optind], verify);
+    }
+    fprintf(stderr, "Usage: %s -c cartridge%s file...\n"
+            "       %s [-v] cartridge%s\n"
+            "       %s -x cartridge%s game [args...]\n",
+            argv[0], CARTRIDGE_EXTENSION, argv[0], CARTRIDGE_EXTENSION, argv[0], CARTRIDGE_EXTENSION);
+    return 1;
+}
+
+const char* baseName(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+int compareNames(const void* a, const void* b) {
+    return strcmp(baseName(*(char* const*)a), baseName(*(char* const*)b));
+}
+
+// Write the header, the index and the files, each on a page boundary, to
+// "<path>.tmp", then rename it over 'path'
+int build(const char* path, int count, char* files[]) {
+    char temporary[MAX_PATH_LENGTH + 4];
+    CartridgeHeader header;
+    size_t indexSize = (size_t)count * sizeof(CartridgeEntry);
+    CartridgeEntry* entries = calloc((size_t)count, sizeof(CartridgeEntry));
+    uint64_t offset = sizeof(CartridgeHeader) + indexSize;
+    int failed = 0;
+
+    if (entries == NULL) {
+        perror("Unable to allocate the index");
+        return 1;
+    }
+    qsort(files, (size_t)count, sizeof(char*), compareNames);
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror("Unable to create the cartridge");
+        free(entries);
+        return 1;
+    }
+
+    for (int i = 0; i < count && !failed; i++) {
+        const char* name = baseName(files[i]);
+        CartridgeEntry* entry = &entries[i];
+        struct stat st;
+
+        if (strlen(name) >= CARTRIDGE_NAME_LENGTH || (i > 0 && strcmp(entries[i - 1].name, name) == 0)) {
+            fprintf(stderr, "%s: name too long or used twice\n", files[i]);
+            failed = 1;
+            break;
+        }
+        int in = open(files[i], O_RDONLY | O_CLOEXEC);
+        if (in == -1 || fstat(in, &st) == -1 || !S_ISREG(st.st_mode)) {
+            fprintf(stderr, "%s: not a readable file\n", files[i]);
+            if (in != -1) close(in);
+            failed = 1;
+            break;
+        }
+
+        size_t length = strlen(name);
+        offset = (offset + CARTRIDGE_ALIGN - 1) / CARTRIDGE_ALIGN * CARTRIDGE_ALIGN;
+        snprintf(entry->name, sizeof(entry->name), "%s", name);
+        entry->kind = length > 3 && strcmp(name + length - 3, ".so") == 0 ? CARTRIDGE_PLUGIN : CARTRIDGE_EXECUTABLE;
+        entry->mode = st.st_mode & 07777;
+        entry->offset = offset;
+        entry->size = (uint64_t)st.st_size;
+        entry->mtime_ns = statMtimeNs(&st);
+
+        void* bytes = st.st_size > 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, in, 0) : NULL;
+        close(in);
+        if (bytes == MAP_FAILED) {
+            perror(files[i]);
+            failed = 1;
+            break;
+        }
+        entry->checksum = cartridgeChecksum(bytes, entry->size);
+        size_t done = 0;
+        while (done < entry->size) {
+            ssize_t n = pwrite(fd, (char*)bytes + done, entry->size - done, (off_t)(offset + done));
+            if (n <= 0) {
+                perror("Unable to write the cartridge");
+                failed = 1;
+                break;
+            }
+            done += (size_t)n;
+        }
+        if (bytes != NULL) munmap(bytes, entry->size);
+        offset += entry->size;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CARTRIDGE_MAGIC, 4);
+    header.version = CARTRIDGE_VERSION;
+    header.count = (uint32_t)count;
+    header.entry_size = sizeof(CartridgeEntry);
+    header.size = offset;
+    header.index_checksum = cartridgeChecksum(entries, indexSize);
+    if (!failed
+        && (ftruncate(fd, (off_t)offset) == -1
+            || pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+            || pwrite(fd, entries, indexSize, sizeof(header)) != (ssize_t)indexSize
+            || fsync(fd) == -1)) {
+        perror("Unable to write the cartridge");
+        failed = 1;
+    }
+    if (close(fd) == -1 || failed || rename(temporary, path) == -1) {
+        if (!failed) perror("Unable to write the cartridge");
+        unlink(temporary);
+        free(entries);
+        return 1;
+    }
+    printf("%s: %d files, %llu bytes\n", path, count, (unsigned long long)offset);
+    free(entries);
+    return 0;
+}
+
+// Print the index; with 'verify', check every file's checksum too
+int list(const char* path, int verify) {
+    Cartridge cart;
+    int corrupt = 0;
+
+    uint64_t start = clockNs();
+    if (cartridgeOpen(&cart, path) == -1) {
+        fprintf(stderr, "Unable to open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    printf("%s: %d files, opened in %.1f us\n", path, cart.count, (clockNs() - start) / 1e3);
+
+    start = clockNs();
+    for (int i = 0; i < cart.count; i++) {
+        const CartridgeEntry* entry = &cart.entries[i];
+        const char* state = "";
+        if (verify) {
+            state = cartridgeVerify(&cart, i) ? "  ok" : "  CORRUPT";
+            corrupt |= cart.checked[i] == CARTRIDGE_CORRUPT;
+        }
+        printf("  %-40s %-10s %10llu bytes  %016llx%s\n", entry->name,
+               entry->kind == CARTRIDGE_PLUGIN ? "plugin" : "executable", (unsigned long long)entry->size,
+               (unsigned long long)entry->checksum, state);
+    }
+    if (verify) printf("Checked every file in %.3f ms\n", (clockNs() - start) / 1e6);
+    cartridgeClose(&cart);
+    return corrupt;
+}
+
+// Replace this process with 'name' from the cartridge
+int run(const char* path, const char* name, char* argv[]) {
+    Cartridge cart;
+
+    if (cartridgeOpen(&cart, path) == -1) {
+        fprintf(stderr, "Unable to open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    int entry = cartridgeFind(&cart, name);
+    if (entry == -1 || cart.entries[entry].kind != CARTRIDGE_EXECUTABLE) {
+        fprintf(stderr, "%s has no game called %s\n", path, name);
+        return 1;
+    }
+    int fd = cartridgeMemfd(&cart, entry);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to load %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+    fexecve(fd, argv, environ);
+    fprintf(stderr, "Unable to run %s: %s\n", name, strerror(errno));
+    return 1;
+}
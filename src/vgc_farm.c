@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tick_loop.h"
+#include "snake_engine.h"
+#include "snake_autopilot.h"
+#include "work_pool.h"
+
+// Self-play soak farm for the snake engine:
+//
+//   vgc_farm [-n games] [-r rows] [-c cols] [-t threads] [-s seed] [-m stall_moves]
+//
+// Plays 'games' complete games with the autopilot of snake_autopilot.h, game
+// i seeded with seed + i exactly as game_snake seeds its bait, spread over
+// every core in batches on the work-stealing pool. Each game ends when the
+// snake fills the board (won), is boxed in (trapped), goes 'stall_moves'
+// moves without eating (stalled), or the engine refuses a move the pilot
+// chose (crashed, a bug). Every finished board is run through snakeCheck().
+//
+// The report aggregates outcomes, final lengths and moves per game, and
+// gives the first seed of every failure so it can be watched with
+//
+//   game_snake -p -r rows -c cols --seed=<seed>
+
+#define FARM_DEFAULT_GAMES 100000
+#define FARM_BATCH 256 // Games per task
+
+enum { FARM_WON, FARM_TRAPPED, FARM_STALLED, FARM_CRASHED, FARM_BROKEN, FARM_OUTCOMES };
+
+static const char* outcomeNames[FARM_OUTCOMES] = { "won", "trapped", "stalled", "crashed", "broken" };
+
+// Totals of one worker; merged once every game has been played
+typedef struct {
+    unsigned long games;
+    unsigned long outcomes[FARM_OUTCOMES];
+    uint64_t first_seed[FARM_OUTCOMES];  // Smallest seed per outcome
+    const char* broken;                  // What snakeCheck() found first
+    unsigned long* lengths;              // Games per final length, cells + 1 entries
+    uint64_t moves;
+    uint64_t max_moves;
+} FarmTotals;
+
+typedef struct {
+    uint64_t first, count;               // Seeds first .. first + count - 1
+} FarmBatch;
+
+static int rows = 15, cols = 15;
+static int stallMoves = 0;
+static FarmTotals totals[WORK_POOL_MAX_THREADS];
+
+// Function prototypes
+void playBatch(void* arg);
+int playGame(SnakeGame* board, SnakeAutopilot* pilot, uint64_t seed, uint64_t* moves, const char** broken);
+void printReport(FarmTotals* all, int threads, double seconds, uint64_t seed);
+
+int main(int argc, char* argv[]) {
+    unsigned long games = FARM_DEFAULT_GAMES;
+    uint64_t seed = 1;
+    int threads = 0;
+    int opt;
+    WorkPool pool;
+
+    while ((opt = getopt(argc, argv, "n:r:c:t:s:m:")) != -1) {
+        if (opt == 'n' && atol(optarg) > 0) {
+            games = (unsigned long)atol(optarg);
+        } else if (opt == 'r' && atoi(optarg) > 0) {
+            rows = atoi(optarg);
+        } else if (opt == 'c' && atoi(optarg) > 0) {
+            cols = atoi(optarg);
+        } else if (opt == 't' && atoi(optarg) > 0) {
+            threads = atoi(optarg);
+        } else if (opt == 's') {
+            seed = strtoull(optarg, NULL, 0);
+        } else if (opt == 'm' && atoi(optarg) > 0) {
+            stallMoves = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-n games] [-r rows] [-c cols] [-t threads] [-s seed] [-m stall_moves]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if ((long)rows * cols < 2 || (long)rows * cols > SNAKE_MAX_CELLS) {
+        fprintf(stderr, "The board needs at least two cells and at most %d.\n", SNAKE_MAX_CELLS);
+        return 1;
+    }
+    if (stallMoves == 0) stallMoves = 4 * rows * cols; // Enough to chase the tail around twice
+
+    if (workPoolStart(&pool, threads) == -1) {
+        perror("Unable to start the workers");
+        workPoolStop(&pool);
+        return 1;
+    }
+    for (int i = 0; i < pool.threads; i++) {
+        totals[i].lengths = calloc((size_t)rows * cols + 1, sizeof(unsigned long));
+        if (totals[i].lengths == NULL) {
+            perror("Unable to allocate the statistics");
+            return 1;
+        }
+        for (int o = 0; o < FARM_OUTCOMES; o++) totals[i].first_seed[o] = UINT64_MAX;
+    }
+
+    unsigned long batchCount = (games + FARM_BATCH - 1) / FARM_BATCH;
+    FarmBatch* batches = malloc(batchCount * sizeof(FarmBatch));
+    if (batches == NULL) {
+        perror("Unable to allocate the batches");
+        return 1;
+    }
+
+    uint64_t start = monotonicNs();
+    for (unsigned long b = 0; b < batchCount; b++) {
+        batches[b].first = seed + b * FARM_BATCH;
+        batches[b].count = b + 1 < batchCount ? FARM_BATCH : games - b * FARM_BATCH;
+        workPoolSubmit(&pool, playBatch, &batches[b]);
+    }
+    workPoolWait(&pool);
+    double seconds = (monotonicNs() - start) / 1e9;
+
+    printReport(totals, pool.threads, seconds, seed);
+    workPoolStop(&pool);
+    free(batches);
+    return 0;
+}
+
+void playBatch(void* arg) {
+    const FarmBatch* batch = arg;
+    FarmTotals* mine = &totals[workPoolCurrent() >= 0 ? workPoolCurrent() : 0];
+    SnakeAutopilot pilot;
+    SnakeGame board;
+
+    if (snakeAutopilotInit(&pilot, rows, cols) == -1) {
+        perror("Unable to allocate the autopilot");
+        exit(EXIT_FAILURE);
+    }
+    for (uint64_t seed = batch->first; seed < batch->first + batch->count; seed++) {
+        uint64_t moves = 0;
+        const char* broken = NULL;
+        int outcome = playGame(&board, &pilot, seed, &moves, &broken);
+
+        mine->games++;
+        mine->outcomes[outcome]++;
+        if (seed < mine->first_seed[outcome]) mine->first_seed[outcome] = seed;
+        if (broken != NULL && mine->broken == NULL) mine->broken = broken;
+        mine->lengths[board.length]++;
+        mine->moves += moves;
+        if (moves > mine->max_moves) mine->max_moves = moves;
+        snakeFree(&board);
+    }
+    snakeAutopilotFree(&pilot);
+}
+
+// Play one game to the end; 'board' is left for the caller to inspect and free
+int playGame(SnakeGame* board, SnakeAutopilot* pilot, uint64_t seed, uint64_t* moves, const char** broken) {
+    int outcome = FARM_WON;
+    int hungry = 0; // Moves since the last bait
+
+    if (snakeInit(board, rows, cols) == -1) { // As game_snake does
+        perror("Unable to allocate the board");
+        exit(EXIT_FAILURE);
+    }
+    vgcRandomSeed(&board->rng, seed);
+    placeBait(board);
+
+    for (;;) {
+        char key = snakeAutopilotMove(pilot, board);
+        if (key == 0) {
+            outcome = FARM_TRAPPED;
+            break;
+        }
+        int result = moveSnake(board, key);
+        (*moves)++;
+        if (result == SNAKE_BLOCKED) {
+            outcome = FARM_CRASHED;
+            break;
+        }
+        if (board->free_count + board->length != board->cells) {
+            break; // snakeCheck() below says what went wrong
+        }
+        if (result == SNAKE_ATE_BAIT) {
+            hungry = 0;
+            if (!placeBait(board)) break; // Won
+        } else if (++hungry >= stallMoves) {
+            outcome = FARM_STALLED;
+            break;
+        }
+    }
+
+    *broken = snakeCheck(board);
+    return *broken != NULL ? FARM_BROKEN : outcome;
+}
+
+static unsigned long lengthPercentile(const unsigned long* lengths, int cells, unsigned long games, double p) {
+    unsigned long rank = (unsigned long)(p / 100.0 * (games - 1)), seen = 0;
+    for (int length = 0; length <= cells; length++) {
+        seen += lengths[length];
+        if (seen > rank) return (unsigned long)length;
+    }
+    return (unsigned long)cells;
+}
+
+void printReport(FarmTotals* all, int threads, double seconds, uint64_t seed) {
+    int cells = rows * cols;
+    FarmTotals sum;
+
+    memset(&sum, 0, sizeof(sum));
+    sum.lengths = calloc((size_t)cells + 1, sizeof(unsigned long));
+    if (sum.lengths == NULL) {
+        perror("Unable to allocate the statistics");
+        exit(EXIT_FAILURE);
+    }
+    for (int o = 0; o < FARM_OUTCOMES; o++) sum.first_seed[o] = UINT64_MAX;
+    for (int i = 0; i < threads; i++) {
+        sum.games += all[i].games;
+        sum.moves += all[i].moves;
+        if (all[i].max_moves > sum.max_moves) sum.max_moves = all[i].max_moves;
+        if (sum.broken == NULL) sum.broken = all[i].broken;
+        for (int o = 0; o < FARM_OUTCOMES; o++) {
+            sum.outcomes[o] += all[i].outcomes[o];
+            if (all[i].first_seed[o] < sum.first_seed[o]) sum.first_seed[o] = all[i].first_seed[o];
+        }
+        for (int length = 0; length <= cells; length++) sum.lengths[length] += all[i].lengths[length];
+    }
+
+    unsigned long shortest = 0, longest = 0;
+    double lengthTotal = 0;
+    for (int length = 0; length <= cells; length++) {
+        if (sum.lengths[length] == 0) continue;
+        if (shortest == 0) shortest = (unsigned long)length;
+        longest = (unsigned long)length;
+        lengthTotal += (double)length * sum.lengths[length];
+    }
+
+    printf("Snake farm: %lu games on %dx%d, seeds %llu.., %d thread%s, %.2f s\n", sum.games, rows, cols,
+           (unsigned long long)seed, threads, threads == 1 ? "" : "s", seconds);
+    printf("  %.0f games/s, %.0f moves/s\n", sum.games / seconds, sum.moves / seconds);
+    for (int o = 0; o < FARM_OUTCOMES; o++) {
+        printf("  %-8s %10lu  %6.2f%%", outcomeNames[o], sum.outcomes[o], 100.0 * sum.outcomes[o] / sum.games);
+        if (o != FARM_WON && sum.outcomes[o] > 0) {
+            printf("  first seed %llu", (unsigned long long)sum.first_seed[o]);
+        }
+        printf("\n");
+    }
+    if (sum.broken != NULL) printf("  engine check failed: %s\n", sum.broken);
+    printf("  length   mean %.1f  p1 %lu  p50 %lu  p99 %lu  min %lu  max %lu of %d\n",
+           lengthTotal / sum.games, lengthPercentile(sum.lengths, cells, sum.games, 1),
+           lengthPercentile(sum.lengths, cells, sum.games, 50),
+           lengthPercentile(sum.lengths, cells, sum.games, 99), shortest, longest, cells);
+    printf("  moves    mean %.1f  max %llu\n", (double)sum.moves / sum.games, (unsigned long long)sum.max_moves);
+    free(sum.lengths);
+}
@@ -0,0 +1,98 @@
+#ifndef VGC_PLUGIN_H
+#define VGC_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "renderer.h"
+
+// Game plugin ABI.
+//
+// Every game describes itself with a VgcGame named "vgc_game". Built as an
+// executable, console_runtime.h drives it from main(); built as a shared
+// object, the console dlopen()s it and drives it inside its own event loop,
+// renderer and terminal session:
+//
+//   gcc -pthread game_snake.c -o game_snake
+//   gcc -pthread -shared -fPIC -DVGC_PLUGIN game_snake.c -o game_snake.so
+//
+// The runtime calls render() before every wait, handle_input() once per key
+// and tick() tick_rate times per second. A game has no global state: all of
+// it hangs off the pointer returned by init(). Headless runs (--headless)
+// skip render() and feed random keys from 'keys' instead of the terminal.
+// save() and resume() back the save states of snapshot.h; result() feeds
+// the high-score store of score_store.h. Arrow keys reach handle_input() as
+// the keys in 'arrows' (see input_queue.h). Games two players can play from
+// two terminals (netplay.h) also fill in seat() and handle_player_input().
+//
+// A game whose moves depend on timing, like a computer player thinking
+// against the clock, hands them to the runtime as keys through own_keys().
+// A recording keeps them at the tick they were played, and a replay hands
+// them back through own_key() at that tick. init() runs with VGC_REPLAY set
+// in the environment when the session is a replay: the game then waits for
+// those keys instead of deciding the moves itself.
+
+#define VGC_PLUGIN_ABI 8
+#define VGC_PLUGIN_SYMBOL "vgc_game"
+#define VGC_REPLAY "VGC_REPLAY"
+
+typedef struct {
+    int abi;                // VGC_PLUGIN_ABI
+    const char* name;
+    double tick_rate;       // Default ticks per second, 0 for input-driven games
+    const char* keys;       // Keys that play the game (not quit), for headless runs
+    uint32_t state_version; // Layout of the save() payload; bump when it changes
+
+    // Parse the arguments and set up a new game; may change '*tick_rate'.
+    // All randomness must come from 'seed' (see vgc_random.h) so recorded
+    // sessions replay exactly. Returns the game state, or NULL (after
+    // printing why) on failure.
+    void* (*init)(int argc, char* argv[], double* tick_rate, uint64_t seed);
+
+    // Advance the simulation one step; returns 0 once the game is over
+    int (*tick)(void* state);
+
+    // Draw the current state; the screen has been cleared
+    void (*render)(void* state, Renderer* screen);
+
+    // React to one key; returns 0 once the game is over
+    int (*handle_input)(void* state, char key);
+
+    // Free the state, leaving a goodbye line (possibly empty) in 'summary'
+    void (*shutdown)(void* state, char* summary, size_t size);
+
+    // Copy the state into 'buffer' in a fixed layout without pointers and
+    // return its size (with a NULL buffer, just the size). Returns 0 when
+    // there is nothing worth resuming, e.g. the game is over.
+    size_t (*save)(void* state, void* buffer, size_t size);
+
+    // Set up a game from a save() payload, which the game may use in place
+    // until it returns; NULL if the payload does not fit
+    void* (*resume)(void* snapshot, size_t size, double* tick_rate);
+
+    // How the finished session ended (SCORE_WON, SCORE_QUIT, ...) and its
+    // score, higher is better; SCORE_NONE records nothing
+    int (*result)(void* state, int64_t* score);
+
+    // Keys the up, down, right and left arrows stand for, '.' for none; NULL
+    // if the arrows do nothing
+    const char* arrows;
+
+    // Say which player, 0 or 1, this terminal plays, for render(); called
+    // after init() and after every resume(). NULL for one-player games.
+    void (*seat)(void* state, int player);
+
+    // React to one key of 'player' like handle_input(); returns -1 without
+    // changing anything when the key is not that player's to press (it is
+    // the other player's turn)
+    int (*handle_player_input)(void* state, int player, char key);
+
+    // Copy the keys the game played by itself since the last call into
+    // 'keys' and return how many; called after every tick of a recorded
+    // session. NULL for games that play none.
+    size_t (*own_keys)(void* state, char* keys, size_t size);
+
+    // Replay one key own_keys() returned; returns 0 once the game is over
+    int (*own_key)(void* state, char key);
+} VgcGame;
+
+#endif
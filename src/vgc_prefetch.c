@@ -0,0 +1,220 @@
+#define _GNU_SOURCE // readahead()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "prefetch.h"
+
+// Reads games ahead the way main_screen does for the highlighted title
+// (prefetch.h), and times launches, to compare cold and warm starts:
+//
+//   vgc_prefetch file...                      read the files and the libraries they need ahead
+//   vgc_prefetch -r file...                   how much of each file is in the page cache
+//   vgc_prefetch -e file...                   drop the files' clean pages from the page cache
+//   vgc_prefetch -t [-n runs] game [args...]  time 'game --headless=1' from fork() until it exits
+//
+// Read-ahead is only started by readahead(), so the first form waits until
+// the files are resident before it reports how long that took. Dropping
+// pages with -e is advice the kernel may ignore for pages in use;
+// prefetch_bench.sh remounts the storage image instead.
+
+#define RESIDENT_WAIT_NS 2000000000ull // How long to wait for read-ahead pages to come in
+#define RESIDENT_POLL_NS 500000L
+
+// Function prototypes
+int prefetchFiles(int argc, char* argv[]);
+int showResident(int argc, char* argv[]);
+int evictFiles(int argc, char* argv[]);
+int timeLaunches(const char* game, char* args[], int runs);
+int residentPages(const char* path, size_t* total);
+double elapsedMs(const struct timespec* start);
+
+int main(int argc, char* argv[]) {
+    int mode = 'p';
+    int runs = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+retn:")) != -1) {
+        if (opt == 'r' || opt == 'e' || opt == 't') {
+            mode = opt;
+        } else if (opt == 'n' && atoi(optarg) > 0) {
+            runs = atoi(optarg);
+        } else {
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind < argc && mode == 'p') {
+        return prefetchFiles(argc - optind, argv + optind);
+    } else if (optind < argc && mode == 'r') {
+        return showResident(argc - optind, argv + optind);
+    } else if (optind < argc && mode == 'e') {
+        return evictFiles(argc - optind, argv + optind);
+    } else if (optind < argc && mode == 't') {
+        return timeLaunches(argv[optind], argv + optind + 1, runs);
+    }
+    fprintf(stderr, "Usage: %s [-r | -e] file...\n       %s -t [-n runs] game [args...]\n", argv[0], argv[0]);
+    return 1;
+}
+
+// Read the files ahead and wait until they are in the page cache
+int prefetchFiles(int argc, char* argv[]) {
+    Prefetcher pf;
+    struct timespec start;
+    int failed = 0;
+
+    prefetchInit(&pf);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < argc; i++) {
+        PrefetchRange range;
+        memset(&range, 0, sizeof(range));
+        int tooLong = snprintf(range.path, sizeof(range.path), "%s", argv[i]) >= (int)sizeof(range.path);
+        if (tooLong || access(argv[i], R_OK) == -1) {
+            fprintf(stderr, "Unable to read %s: %s\n", argv[i], strerror(tooLong ? ENAMETOOLONG : errno));
+            failed = 1;
+            continue;
+        }
+        prefetchRun(&pf, &range, 1, pf.generation);
+    }
+    double issuedMs = elapsedMs(&start);
+
+    // Only the named files are waited for; their libraries are usually cached already
+    size_t resident = 0, total = 0;
+    for (uint64_t waited = 0;; waited += RESIDENT_POLL_NS) {
+        resident = total = 0;
+        for (int i = 0; i < argc; i++) {
+            size_t pages;
+            int count = residentPages(argv[i], &pages);
+            if (count >= 0) {
+                resident += (size_t)count;
+                total += pages;
+            }
+        }
+        if (resident == total || waited >= RESIDENT_WAIT_NS) break;
+        struct timespec pause = { 0, RESIDENT_POLL_NS };
+        nanosleep(&pause, NULL);
+    }
+    printf("%llu KB read ahead, issued in %.3f ms, %zu of %zu pages resident after %.3f ms\n",
+           (unsigned long long)(pf.bytes / 1024), issuedMs, resident, total, elapsedMs(&start));
+    prefetchStop(&pf);
+    return failed;
+}
+
+int showResident(int argc, char* argv[]) {
+    int failed = 0;
+
+    for (int i = 0; i < argc; i++) {
+        size_t total;
+        int resident = residentPages(argv[i], &total);
+        if (resident == -1) {
+            fprintf(stderr, "Unable to check %s: %s\n", argv[i], strerror(errno));
+            failed = 1;
+        } else {
+            printf("%-40s %6d of %6zu pages resident\n", argv[i], resident, total);
+        }
+    }
+    return failed;
+}
+
+int evictFiles(int argc, char* argv[]) {
+    int failed = 0;
+
+    for (int i = 0; i < argc; i++) {
+        int fd = open(argv[i], O_RDONLY | O_CLOEXEC);
+        if (fd == -1 || fdatasync(fd) == -1 || posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0) {
+            fprintf(stderr, "Unable to evict %s: %s\n", argv[i], strerror(errno));
+            failed = 1;
+        }
+        if (fd != -1) close(fd);
+    }
+    return failed;
+}
+
+// Start 'game' headless 'runs' times, each until it exits, and print how
+// long each run took; the first is the cold one if nothing was cached
+int timeLaunches(const char* game, char* args[], int runs) {
+    int argc = 0;
+    while (args[argc] != NULL) argc++;
+    char** argv = calloc((size_t)argc + 3, sizeof(char*));
+    if (argv == NULL) {
+        perror("Unable to allocate the arguments");
+        return 1;
+    }
+    argv[0] = (char*)game;
+    argv[1] = "--headless=1";
+    memcpy(argv + 2, args, (size_t)argc * sizeof(char*));
+
+    int failed = 0;
+    for (int run = 0; run < runs && !failed; run++) {
+        struct timespec start;
+        int status;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pid_t pid = fork();
+        if (pid == 0) {
+            int null = open("/dev/null", O_RDWR);
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+            execv(game, argv);
+            _exit(127);
+        }
+        if (pid == -1 || waitpid(pid, &status, 0) == -1) {
+            perror("Unable to start the game");
+            failed = 1;
+        } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s failed (status %d)\n", game, status);
+            failed = 1;
+        } else {
+            printf("%s: %.3f ms\n", game, elapsedMs(&start));
+        }
+    }
+    free(argv);
+    return failed;
+}
+
+// Pages of 'path' in the page cache, and how many it has in 'total'; -1 if
+// it cannot be checked
+int residentPages(const char* path, size_t* total) {
+    struct stat st;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    int resident = 0;
+
+    *total = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    // Mapping faults nothing in; mincore() only looks
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    *total = ((size_t)st.st_size + page - 1) / page;
+    unsigned char* vector = malloc(*total);
+    if (vector == NULL || mincore(map, (size_t)st.st_size, vector) == -1) {
+        resident = -1;
+    } else {
+        for (size_t i = 0; i < *total; i++) resident += vector[i] & 1;
+    }
+    free(vector);
+    munmap(map, (size_t)st.st_size);
+    return resident;
+}
+
+double elapsedMs(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
@@ -0,0 +1,40 @@
+#ifndef VGC_RANDOM_H
+#define VGC_RANDOM_H
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// Per-game pseudo-random generator (SplitMix64). The whole state is one
+// 64-bit word, so a game can save it, and the same seed always produces the
+// same sequence on every machine, which recordings and replays rely on.
+
+typedef struct {
+    uint64_t state;
+} VgcRandom;
+
+static inline void vgcRandomSeed(VgcRandom* rng, uint64_t seed) {
+    rng->state = seed;
+}
+
+static inline uint64_t vgcRandomNext(VgcRandom* rng) {
+    uint64_t z = (rng->state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform integer in [0, n)
+static inline int vgcRandomRange(VgcRandom* rng, int n) {
+    return (int)(((vgcRandomNext(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+// A fresh seed for a new session
+static inline uint64_t vgcNewSeed(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    VgcRandom mix = { (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec + ((uint64_t)getpid() << 32) };
+    return vgcRandomNext(&mix);
+}
+
+#endif
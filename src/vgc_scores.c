@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "score_store.h"
+#include "vgc_random.h"
+
+// Leaderboards from the command line, and a load generator for the score
+// store:
+//
+//   vgc_scores [-g game] [-k count] [-a sessions] [score_directory]
+//
+// -a appends that many random results (spread over the three games) before
+// the query, to see how appends, index rebuilds and top-k queries hold up
+// with millions of sessions.
+
+static const char* defaultGames[] = { "game_snake", "game_snake_arena", "game_falling_stars", "game_tic_tac_toe" };
+static const char* outcomes[] = { "", "lost", "won", "draw", "quit" };
+
+// Function prototypes
+void appendSessions(const char* dir, unsigned long sessions);
+void printTop(ScoreStore* store, const char* game, size_t k);
+
+int main(int argc, char* argv[]) {
+    const char* game = NULL;
+    unsigned long sessions = 0;
+    size_t k = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:k:a:")) != -1) {
+        if (opt == 'g') {
+            game = optarg;
+        } else if (opt == 'k' && atoi(optarg) > 0) {
+            k = (size_t)atoi(optarg);
+        } else if (opt == 'a') {
+            sessions = strtoul(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [-g game] [-k count] [-a sessions] [score_directory]\n", argv[0]);
+            return 1;
+        }
+    }
+    const char* dir = optind < argc ? argv[optind] : ".";
+
+    if (sessions > 0) {
+        appendSessions(dir, sessions);
+    }
+
+    ScoreStore store;
+    uint64_t start = scoreClockNs();
+    if (scoreStoreOpen(&store, dir) == -1) {
+        perror("Unable to open the score store");
+        return 1;
+    }
+    printf("Opened %llu indexed + %zu new records in %.3f ms\n",
+           (unsigned long long)store.index_count, store.delta_count, (scoreClockNs() - start) / 1e6);
+
+    if (game != NULL) {
+        printTop(&store, game, k);
+    } else {
+        for (size_t i = 0; i < sizeof(defaultGames) / sizeof(defaultGames[0]); i++) {
+            printTop(&store, defaultGames[i], k);
+        }
+    }
+
+    start = scoreClockNs();
+    scoreStoreClose(&store);
+    printf("Closed (index written) in %.3f ms\n", (scoreClockNs() - start) / 1e6);
+    return 0;
+}
+
+void appendSessions(const char* dir, unsigned long sessions) {
+    ScoreLog log;
+    VgcRandom rng;
+
+    if (scoreLogOpen(&log, dir) == -1) {
+        perror("Unable to open the score log");
+        exit(EXIT_FAILURE);
+    }
+    vgcRandomSeed(&rng, (uint64_t)time(NULL));
+
+    uint64_t start = scoreClockNs();
+    for (unsigned long i = 0; i < sessions; i++) {
+        const char* game = defaultGames[vgcRandomRange(&rng, 3)];
+        int outcome = 1 + vgcRandomRange(&rng, 4);
+        int64_t score = vgcRandomRange(&rng, 1000000);
+        scoreLogAppend(&log, game, outcome, score, (uint64_t)vgcRandomRange(&rng, 100000));
+    }
+    scoreLogClose(&log);
+    uint64_t elapsed = scoreClockNs() - start;
+    printf("Appended %lu sessions in %.3f ms (%.0f per second)\n", sessions, elapsed / 1e6,
+           elapsed > 0 ? sessions * 1e9 / elapsed : 0.0);
+}
+
+void printTop(ScoreStore* store, const char* game, size_t k) {
+    ScoreRecord* top = malloc(k * sizeof(ScoreRecord));
+    if (top == NULL) {
+        perror("Unable to allocate the leaderboard");
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t start = scoreClockNs();
+    size_t count = scoreTop(store, game, top, k);
+    uint64_t elapsed = scoreClockNs() - start;
+
+    printf("\n%s: %llu sessions, top %zu in %.1f us\n", game,
+           (unsigned long long)scoreCount(store, game), count, elapsed / 1e3);
+    for (size_t i = 0; i < count; i++) {
+        char date[32];
+        time_t when = (time_t)top[i].time;
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&when));
+        printf("%4zu. %10lld  %-4s  %8llu ticks  %s\n", i + 1, (long long)top[i].score,
+               top[i].outcome <= SCORE_QUIT ? outcomes[top[i].outcome] : "",
+               (unsigned long long)top[i].ticks, date);
+    }
+    free(top);
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "console_runtime.h"
+#include "spectator.h"
+#include "vgc_random.h"
+
+// Watches a game, or the console, from another terminal (spectator.h):
+//
+//   VGC_SPECTATE=lobby ./main_screen          broadcast as "lobby"
+//   vgc_spectate lobby                        watch it; q stops watching
+//   vgc_spectate -b [-f frames] [-n max]      cost of broadcasting
+//
+// A spectator only reads the shared ring, SPECTATE_HZ times a second, so
+// any number can watch. The benchmark presents the same random frames with
+// broadcasting off, then on with 0, 1, 4, ... up to 'max' spectators
+// following in threads, and reports the producer's CPU time per frame; the
+// spectators must all end on the producer's last frame. Build with -pthread.
+
+#define SPECTATE_HZ 60.0
+#define BENCH_FRAMES 20000
+#define BENCH_MAX_SPECTATORS 64
+#define BENCH_ROWS 40
+#define BENCH_COLS 100
+#define BENCH_CHANGES 200 // Cells changed per frame
+
+// Function prototypes
+int watch(const char* name);
+int bench(int frames, int maxSpectators);
+double benchRun(const char* name, int frames, int spectators, int* mismatches, unsigned long* resyncs);
+void* benchFollow(void* arg);
+
+int main(int argc, char* argv[]) {
+    int benchmark = 0;
+    int frames = BENCH_FRAMES;
+    int maxSpectators = BENCH_MAX_SPECTATORS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "bf:n:")) != -1) {
+        if (opt == 'b') {
+            benchmark = 1;
+        } else if (opt == 'f' && atoi(optarg) > 0) {
+            frames = atoi(optarg);
+        } else if (opt == 'n' && atoi(optarg) >= 0) {
+            maxSpectators = atoi(optarg);
+        } else {
+            optind = argc + 1;
+            break;
+        }
+    }
+    unsetenv("VGC_SPECTATE"); // Never broadcast the broadcast
+    if (benchmark && optind == argc) {
+        return bench(frames, maxSpectators);
+    } else if (!benchmark && optind == argc - 1) {
+        return watch(argv[optind]);
+    }
+    fprintf(stderr, "Usage: %s name\n       %s -b [-f frames] [-n max_spectators]\n", argv[0], argv[0]);
+    return 1;
+}
+
+// Follow the broadcast 'name' on this terminal until it ends or q is pressed
+int watch(const char* name) {
+    Spectator spectator;
+    Renderer screen;
+    TickLoop loop;
+    char input[64];
+    size_t inputLength;
+
+    if (spectatorAttach(&spectator, name) == -1) {
+        fprintf(stderr, "Nothing is broadcast as %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+    setInputMode();
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    runtime_title = "vgc_spectate";
+    rendererInit(&screen, 1, 1);
+    runtime_screen = &screen;
+    if (tickLoopInit(&loop, SPECTATE_HZ) == -1) {
+        perror("Unable to start the refresh timer");
+        restoreInputMode();
+        return 1;
+    }
+
+    int ended = 0;
+    while (!ended) {
+        int applied = spectatorFollow(&spectator);
+        ended = applied == -1;
+        if (applied > 0 && spectator.rows > 0) {
+            // The frame goes to this terminal through the usual diff
+            rendererEnsureSize(&screen, spectator.rows + 1, spectator.cols);
+            memcpy(screen.back, spectator.cells, (size_t)spectator.rows * spectator.cols);
+            memset(screen.back + (size_t)spectator.rows * spectator.cols, ' ', (size_t)spectator.cols);
+            rendererText(&screen, spectator.rows, 0, "[watching %s: frame %llu, %lu missed, q to stop]", name,
+                         (unsigned long long)spectator.frame, spectator.skipped);
+            rendererPresent(&screen);
+        }
+
+        tickLoopWait(&loop, STDIN_FILENO, input, sizeof(input), &inputLength);
+        if (memchr(input, 'q', inputLength) != NULL || !loop.input_open) break;
+    }
+
+    tickLoopClose(&loop);
+    rendererFinish(&screen);
+    runtime_screen = NULL;
+    rendererFree(&screen);
+    restoreInputMode();
+    printf("\n%s %s: %lu records, %lu resyncs, %lu frames missed\n", name, ended ? "ended" : "left",
+           spectator.records, spectator.resyncs, spectator.skipped);
+    spectatorDetach(&spectator);
+    return 0;
+}
+
+int bench(int frames, int maxSpectators) {
+    char name[32];
+    int failed = 0;
+
+    snprintf(name, sizeof(name), "bench-%d", (int)getpid());
+    printf("%d frames of %dx%d, %d cells changed per frame\n", frames, BENCH_ROWS, BENCH_COLS, BENCH_CHANGES);
+    double off = benchRun(NULL, frames, 0, NULL, NULL);
+    printf("%-16s %8.2f us/frame\n", "not broadcast", off / 1e3);
+
+    for (int spectators = 0;; spectators = spectators == 0 ? 1 : spectators * 4) {
+        if (spectators > maxSpectators) spectators = maxSpectators;
+        int mismatches;
+        unsigned long resyncs;
+        double ns = benchRun(name, frames, spectators, &mismatches, &resyncs);
+        char label[32];
+
+        snprintf(label, sizeof(label), "%d spectators", spectators);
+        printf("%-16s %8.2f us/frame  %+6.2f us broadcasting  %lu resyncs\n", label, ns / 1e3,
+               (ns - off) / 1e3, resyncs);
+        if (mismatches > 0) {
+            printf("  %d spectators did not end on the last frame\n", mismatches);
+            failed = 1;
+        }
+        if (spectators == maxSpectators) break;
+    }
+    return failed;
+}
+
+// Present 'frames' random frames to /dev/null, broadcast as 'name' unless
+// that is NULL, with 'spectators' following; returns the producer's CPU
+// nanoseconds per frame
+double benchRun(const char* name, int frames, int spectators, int* mismatches, unsigned long* resyncs) {
+    Spectator* followers = calloc((size_t)spectators + 1, sizeof(Spectator));
+    pthread_t* threads = calloc((size_t)spectators + 1, sizeof(pthread_t));
+    Renderer screen;
+    VgcRandom rng;
+
+    if (name != NULL) setenv("VGC_SPECTATE", name, 1);
+    rendererInit(&screen, BENCH_ROWS, BENCH_COLS);
+    unsetenv("VGC_SPECTATE");
+    screen.fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (followers == NULL || threads == NULL || screen.fd == -1 || (name != NULL && screen.spectators == NULL)) {
+        perror("Unable to set up the benchmark");
+        exit(EXIT_FAILURE);
+    }
+    vgcRandomSeed(&rng, 1);
+    for (int i = 0; i < BENCH_ROWS * BENCH_COLS; i++) screen.back[i] = (char)('a' + vgcRandomRange(&rng, 26));
+    rendererPresent(&screen);
+
+    for (int i = 0; i < spectators; i++) {
+        if (spectatorAttach(&followers[i], name) == -1
+            || pthread_create(&threads[i], NULL, benchFollow, &followers[i]) != 0) {
+            perror("Unable to start a spectator");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    for (int f = 0; f < frames; f++) {
+        for (int c = 0; c < BENCH_CHANGES; c++) {
+            screen.back[vgcRandomRange(&rng, BENCH_ROWS * BENCH_COLS)] = (char)('a' + vgcRandomRange(&rng, 26));
+        }
+        rendererPresent(&screen);
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / frames;
+
+    // The spectators catch up with the end of the broadcast, then compare
+    if (screen.spectators != NULL) spectatorEnd(screen.spectators);
+    if (mismatches != NULL) *mismatches = 0;
+    if (resyncs != NULL) *resyncs = 0;
+    for (int i = 0; i < spectators; i++) {
+        Spectator* spectator = &followers[i];
+        pthread_join(threads[i], NULL);
+        if (spectator->rows != BENCH_ROWS || spectator->cols != BENCH_COLS
+            || memcmp(spectator->cells, screen.front, BENCH_ROWS * BENCH_COLS) != 0) {
+            (*mismatches)++;
+        }
+        if (spectator->resyncs > 0) *resyncs += spectator->resyncs - 1; // The first sync is not a resync
+        spectatorDetach(spectator);
+    }
+    close(screen.fd);
+    rendererFree(&screen);
+    free(followers);
+    free(threads);
+    return ns;
+}
+
+// A spectator thread: follow at the display rate until the broadcast ends
+void* benchFollow(void* arg) {
+    Spectator* spectator = arg;
+    struct timespec pause = { 0, (long)(1e9 / SPECTATE_HZ) };
+
+    while (spectatorFollow(spectator) != -1) {
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
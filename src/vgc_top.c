@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include "console_runtime.h"
+
+// Live frame timings of every running game and launcher:
+//
+//   vgc_top
+//
+// Attaches to each probe ring in /dev/shm (see probe.h) and, twice a second,
+// shows per process the frame rate, the busy time per frame (rendering,
+// writing, input and simulation; the time asleep in poll() is left out) as
+// percentiles, an average breakdown, output and syscalls per frame and a
+// histogram of busy times. Rings of processes that died without cleaning up
+// are removed. Press q to quit.
+//
+// Build with -pthread.
+
+#define TOP_MAX_PROBES 32
+#define TOP_REFRESH_HZ 2.0
+#define TOP_ROWS_PER_PROBE 6
+#define TOP_WIDTH 72
+#define TOP_BUCKETS 10 // Under 16 us, under 32 us, ... 4 ms and above
+
+typedef struct {
+    char shm_name[64];
+    ProbeReader reader;
+    ProbeSample samples[PROBE_CAPACITY]; // Frames read since the last refresh
+    int seen;                            // Still present in /dev/shm
+} TopProbe;
+
+static TopProbe probes[TOP_MAX_PROBES];
+static int probeCount = 0;
+
+// Function prototypes
+void scanProbes(void);
+void drawProbe(Renderer* screen, int* row, TopProbe* probe, double seconds);
+int compareBusy(const void* a, const void* b);
+
+static inline uint32_t busyNs(const ProbeSample* sample) {
+    return sample->render_ns + sample->write_ns + sample->input_ns + sample->sim_ns;
+}
+
+int main(void) {
+    Renderer screen;
+    TickLoop loop;
+    char input[64];
+    size_t inputLength;
+    uint64_t last = monotonicNs();
+
+    setInputMode();
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    runtime_title = "vgc_top";
+    rendererInit(&screen, 1, 1);
+    runtime_screen = &screen;
+    if (tickLoopInit(&loop, TOP_REFRESH_HZ) == -1) {
+        perror("Unable to start the refresh timer");
+        restoreInputMode();
+        return 1;
+    }
+
+    for (;;) {
+        uint64_t now = monotonicNs();
+        double seconds = (now - last) / 1e9;
+        int row = 0;
+
+        last = now;
+        scanProbes();
+        rendererEnsureSize(&screen, 1 + probeCount * TOP_ROWS_PER_PROBE, TOP_WIDTH);
+        rendererClear(&screen);
+        rendererText(&screen, row++, 0, "vgc_top: %d probe%s (q to quit)", probeCount,
+                     probeCount == 1 ? "" : "s");
+        for (int i = 0; i < probeCount; i++) {
+            row++;
+            drawProbe(&screen, &row, &probes[i], seconds);
+        }
+        rendererPresent(&screen);
+
+        tickLoopWait(&loop, STDIN_FILENO, input, sizeof(input), &inputLength);
+        if (memchr(input, 'q', inputLength) != NULL || !loop.input_open) break;
+    }
+
+    tickLoopClose(&loop);
+    runtime_screen = NULL;
+    rendererFree(&screen);
+    restoreInputMode();
+    for (int i = 0; i < probeCount; i++) {
+        probeDetach(&probes[i].reader);
+    }
+    return 0;
+}
+
+// Attach to new rings, forget the ones that went away and unlink the ones
+// whose process is gone
+void scanProbes(void) {
+    DIR* dir = opendir(PROBE_SHM_DIR);
+    struct dirent* entry;
+
+    for (int i = 0; i < probeCount; i++) {
+        probes[i].seen = 0;
+    }
+
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        char shmName[64];
+        int pid;
+        int known = 0;
+
+        if (strncmp(entry->d_name, PROBE_PREFIX, strlen(PROBE_PREFIX)) != 0) continue;
+        if (strlen(entry->d_name) >= sizeof(shmName) - 1) continue;
+        snprintf(shmName, sizeof(shmName), "/%.62s", entry->d_name);
+        pid = atoi(entry->d_name + strlen(PROBE_PREFIX));
+        if (pid > 0 && kill(pid, 0) == -1 && errno == ESRCH) {
+            shm_unlink(shmName); // Left behind by a crash
+            continue;
+        }
+
+        for (int i = 0; i < probeCount && !known; i++) {
+            if (strcmp(probes[i].shm_name, shmName) == 0) {
+                probes[i].seen = 1;
+                known = 1;
+            }
+        }
+        if (known || probeCount == TOP_MAX_PROBES) continue;
+
+        TopProbe* probe = &probes[probeCount];
+        if (probeAttach(&probe->reader, shmName) == 0) {
+            snprintf(probe->shm_name, sizeof(probe->shm_name), "%s", shmName);
+            probe->seen = 1;
+            probeCount++;
+        }
+    }
+    if (dir != NULL) closedir(dir);
+
+    // Drop the rings that were unlinked, keeping the rest in order
+    int kept = 0;
+    for (int i = 0; i < probeCount; i++) {
+        if (!probes[i].seen) {
+            probeDetach(&probes[i].reader);
+            continue;
+        }
+        if (kept != i) probes[kept] = probes[i];
+        kept++;
+    }
+    probeCount = kept;
+}
+
+int compareBusy(const void* a, const void* b) {
+    uint32_t x = busyNs(a);
+    uint32_t y = busyNs(b);
+    return (x > y) - (x < y);
+}
+
+void drawProbe(Renderer* screen, int* row, TopProbe* probe, double seconds) {
+    const ProbeHeader* header = &probe->reader.ring->header;
+    static const char levels[] = " .:-=+*#%@";
+    unsigned long buckets[TOP_BUCKETS] = { 0 };
+    double render = 0, write = 0, input = 0, sim = 0, bytes = 0, syscalls = 0;
+    char bars[TOP_BUCKETS + 1];
+    size_t n;
+
+    n = probeRead(&probe->reader, probe->samples, PROBE_CAPACITY);
+    rendererText(screen, (*row)++, 0, "%-24.24s pid %-7d %6.1f fps  lost %lu", header->name,
+                 (int)header->pid, seconds > 0 ? n / seconds : 0.0, probe->reader.lost);
+    if (n == 0) {
+        rendererText(screen, (*row)++, 2, "idle");
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const ProbeSample* sample = &probe->samples[i];
+        uint32_t busy = busyNs(sample) / 8000;
+        int bucket = 0;
+
+        render += sample->render_ns;
+        write += sample->write_ns;
+        input += sample->input_ns;
+        sim += sample->sim_ns;
+        bytes += sample->bytes;
+        syscalls += sample->syscalls;
+        while (busy > 1 && bucket < TOP_BUCKETS - 1) {
+            busy >>= 1;
+            bucket++;
+        }
+        buckets[bucket]++;
+    }
+    qsort(probe->samples, n, sizeof(ProbeSample), compareBusy);
+
+    rendererText(screen, (*row)++, 2, "busy us  p50 %8.1f  p99 %8.1f  max %8.1f",
+                 busyNs(&probe->samples[n / 2]) / 1e3,
+                 busyNs(&probe->samples[(n * 99) / 100]) / 1e3,
+                 busyNs(&probe->samples[n - 1]) / 1e3);
+    rendererText(screen, (*row)++, 2, "avg us   render %.1f  write %.1f  input %.1f  sim %.1f",
+                 render / n / 1e3, write / n / 1e3, input / n / 1e3, sim / n / 1e3);
+    rendererText(screen, (*row)++, 2, "per frame  %.0f bytes  %.2f syscalls", bytes / n, syscalls / n);
+
+    unsigned long most = 1;
+    for (int b = 0; b < TOP_BUCKETS; b++) {
+        if (buckets[b] > most) most = buckets[b];
+    }
+    for (int b = 0; b < TOP_BUCKETS; b++) {
+        bars[b] = levels[buckets[b] == 0 ? 0 : 1 + (buckets[b] * 8) / most];
+    }
+    bars[TOP_BUCKETS] = '\0';
+    rendererText(screen, (*row)++, 2, "<16us [%s] 4ms+", bars);
+}
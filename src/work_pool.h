@@ -0,0 +1,258 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Work-stealing thread pool.
+//
+// Every worker owns a deque of tasks. It takes work from the bottom of its
+// own deque (newest first, while its data is still in cache) and, when that
+// is empty, steals from the top of the others' (oldest first), so a worker
+// stuck with expensive tasks is relieved by the idle ones. Pools serving
+// requests with deadlines set 'fifo' so that workers also take their own
+// oldest task first. Tasks submitted
+// from outside the pool are spread over the deques round-robin; tasks a
+// worker submits go to its own deque. Idle workers sleep on a condition
+// variable and are woken only when work arrives while they sleep.
+//
+// Each deque has its own mutex, held for a few instructions per push, pop
+// or steal, so workers only contend when they actually touch the same deque.
+//
+// Build with -pthread.
+
+#define WORK_POOL_MAX_THREADS 256
+#define WORK_DEQUE_INITIAL 64 // Tasks; deques grow as needed
+
+typedef void (*WorkFn)(void* arg);
+
+typedef struct {
+    WorkFn fn;
+    void* arg;
+} WorkTask;
+
+typedef struct {
+    pthread_mutex_t lock;
+    WorkTask* tasks;          // Ring buffer
+    size_t top, bottom;       // Steal from 'top', push and pop at 'bottom'
+    size_t capacity;          // Power of two
+    unsigned long steals;     // Tasks other workers took from this deque; atomic
+} WorkDeque;
+
+typedef struct WorkPool WorkPool;
+
+typedef struct {
+    WorkPool* pool;
+    int index;
+    pthread_t thread;
+} WorkWorker;
+
+struct WorkPool {
+    int threads;
+    WorkWorker workers[WORK_POOL_MAX_THREADS];
+    WorkDeque deques[WORK_POOL_MAX_THREADS];
+    pthread_mutex_t lock;     // Guards 'sleeping' and 'stop'
+    pthread_cond_t wake;
+    pthread_cond_t idle;      // Signalled when 'pending' drops to 0
+    unsigned long queued;     // Tasks in all deques; updated atomically
+    unsigned long pending;    // Tasks submitted and not finished; atomic
+    unsigned next;            // Round-robin target for outside submissions
+    int fifo;                 // Oldest task first everywhere; set before submitting
+    int sleeping;
+    int stop;
+};
+
+// Index of the worker running the calling thread, or -1 outside the pool
+static __thread int work_pool_worker = -1;
+
+static inline int workPoolCurrent(void) {
+    return work_pool_worker;
+}
+
+static inline void workDequePush(WorkDeque* deque, WorkTask task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        size_t capacity = deque->capacity * 2;
+        WorkTask* tasks = malloc(capacity * sizeof(WorkTask));
+        if (tasks == NULL) {
+            perror("Unable to grow the work queue");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = deque->top; i != deque->bottom; i++) {
+            tasks[i & (capacity - 1)] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+    deque->tasks[deque->bottom++ & (deque->capacity - 1)] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Take the newest task ('oldest' 0) or the oldest one ('oldest' 1); returns
+// 0 if the deque is empty
+static inline int workDequeTake(WorkDeque* deque, WorkTask* task, int oldest) {
+    int found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        if (oldest) {
+            *task = deque->tasks[deque->top++ & (deque->capacity - 1)];
+        } else {
+            *task = deque->tasks[--deque->bottom & (deque->capacity - 1)];
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Next task for worker 'index': its own newest, else the oldest of another
+static inline int workPoolFind(WorkPool* pool, int index, WorkTask* task) {
+    if (workDequeTake(&pool->deques[index], task, pool->fifo)) return 1;
+    for (int i = 1; i < pool->threads; i++) {
+        WorkDeque* victim = &pool->deques[(index + i) % pool->threads];
+        if (workDequeTake(victim, task, 1)) {
+            __atomic_add_fetch(&victim->steals, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline void* workPoolThread(void* arg) {
+    WorkWorker* worker = arg;
+    WorkPool* pool = worker->pool;
+    WorkTask task;
+
+    work_pool_worker = worker->index;
+    for (;;) {
+        if (workPoolFind(pool, worker->index, &task)) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+            task.fn(task.arg);
+            if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->idle);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0) {
+            pool->sleeping++;
+            pthread_cond_wait(&pool->wake, &pool->lock);
+            pool->sleeping--;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+// Queue 'fn(arg)' to run on one of the workers
+static inline void workPoolSubmit(WorkPool* pool, WorkFn fn, void* arg) {
+    WorkTask task = { fn, arg };
+    int index = work_pool_worker;
+
+    if (index < 0) {
+        index = (int)(__atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED) % (unsigned)pool->threads);
+    }
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+    workDequePush(&pool->deques[index], task);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->sleeping > 0) pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Start 'threads' workers (0 for one per online CPU); returns -1 on failure
+static inline int workPoolStart(WorkPool* pool, int threads) {
+    memset(pool, 0, sizeof(*pool));
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+    if (threads > WORK_POOL_MAX_THREADS) threads = WORK_POOL_MAX_THREADS;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    for (int i = 0; i < threads; i++) {
+        WorkDeque* deque = &pool->deques[i];
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->capacity = WORK_DEQUE_INITIAL;
+        deque->tasks = malloc(deque->capacity * sizeof(WorkTask));
+        if (deque->tasks == NULL) {
+            perror("Unable to allocate the work queue");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pool->threads = threads;
+    for (int i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].thread, NULL, workPoolThread, &pool->workers[i]) != 0) {
+            pool->threads = i;
+            return -1; // The caller stops the ones that did start
+        }
+    }
+    return 0;
+}
+
+// Wait until every task submitted so far, and every task those submitted,
+// has finished
+static inline void workPoolWait(WorkPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) > 0) {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Tasks taken from one worker by another since the start
+static inline unsigned long workPoolSteals(WorkPool* pool) {
+    unsigned long steals = 0;
+    for (int i = 0; i < pool->threads; i++) {
+        steals += __atomic_load_n(&pool->deques[i].steals, __ATOMIC_RELAXED);
+    }
+    return steals;
+}
+
+// Let the workers finish the queued tasks, then stop them
+static inline void workPoolStop(WorkPool* pool) {
+    WorkTask task;
+
+    // Run what is left on the calling thread so nothing is lost
+    while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) > 0) {
+        for (int i = 0; i < pool->threads; i++) {
+            if (workDequeTake(&pool->deques[i], &task, 1)) {
+                __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+                task.fn(task.arg);
+                __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->idle);
+}
+
+#endif